@@ -3,8 +3,11 @@
  *@brief SPI Resource Lock
  *@details Since the DFR1195 screen occupies the SPI pins, operating SPI peripherals in multithreaded 
            programming may cause errors. Therefore, we have built-in an SPI resource lock "SPI_MUTEX" 
-           in this project to ensure thread safety. This example demonstrates how to use SPI when 
-           implementing multithreaded programming in the project.
+           in this project to ensure thread safety. The LoRa radio takes the same lock, with priority
+           over the screen and your tasks, so keep your SPI transfers short. SPI_MUTEX is a recursive
+           mutex: take it with xSemaphoreTakeRecursive and give it back with xSemaphoreGiveRecursive from
+           the same task. While holding it, the task may still draw on the screen. This example demonstrates
+           how to use SPI when implementing multithreaded programming in the project.
  *@copyright Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
  *@licence The MIT License (MIT)
  *@author [Martin](Martin@dfrobot.com)
@@ -41,12 +44,12 @@
  {
      while (1)
      {
-         if (xSemaphoreTake(SPI_MUTEX, portMAX_DELAY) == pdTRUE)
+         if (xSemaphoreTakeRecursive(SPI_MUTEX, portMAX_DELAY) == pdTRUE)
          {   
              // Operate your SPI peripherals here
  
              printf("User Get SPI_MUTEX\n");
-             xSemaphoreGive(SPI_MUTEX);
+             xSemaphoreGiveRecursive(SPI_MUTEX);
          }
          delay(300);     // Add some delay to allow the display to acquire SPI_MUTEX
      }
@@ -0,0 +1,95 @@
+/*!
+ *@file UplinkQueue.ino
+ *@brief Node joins the network via OTAA and packs many small readings into few uplinks.
+ *@details The node joins the network using the OTAA (Over-The-Air Activation) method.
+           After successfully joining the network, it queues a 4-byte reading every 5 seconds.
+           The queue sends a frame when it is full at the current data rate, or when the oldest
+           reading is 60 seconds old. Each reading is preceded by its length byte in the frame,
+           so the application server can split the frame back into readings.
+ *@copyright Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ *@licence The MIT License (MIT)
+ *@author [Martin](Martin@dfrobot.com)
+ *@version V0.0.1
+ *@date 2025-2-24
+ *@url https://github.com/DFRobot/DFRobot_LoRaWAN
+ */
+
+#include "DFRobot_LoRaWAN.h"
+// Reading interval
+#define APP_INTERVAL_MS 5000
+// Longest time a reading waits in the queue
+#define APP_MAX_AGE_MS 60000
+// LoRaWAN DevEUI
+const uint8_t DevEUI[8] = {0xDF, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11};
+// LoRaWAN AppEUI/JoinEUI
+const uint8_t AppEUI[8] = {0xDF, 0xB7, 0xB7, 0xB7, 0xB7, 0x00, 0x00, 0x00};
+// LoRaWAN AppKEY
+const uint8_t AppKey[16] = {
+  0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+  0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10};
+
+// Application port number
+uint8_t port = 2;
+
+LoRaWAN_Node node(DevEUI, AppEUI, AppKey);
+TimerEvent_t appTimer;
+volatile bool readingDue = false;
+
+void joinCb(bool isOk, int16_t rssi, int8_t snr)
+{
+    if(isOk){
+        printf("JOIN SUCCESS\n");
+        printf("JoinAccept Packet rssi = %d snr = %d\n", rssi, snr);
+        TimerSetValue(&appTimer, APP_INTERVAL_MS);
+        TimerStart(&appTimer);
+    }else{
+        printf("OTAA join error\n");
+        delay(5000);
+        printf("Restart Join Request Packet\n");
+        node.join(joinCb);      // Rejoin the LoRaWAN network
+    }
+}
+
+// Runs in the timer task, which also opens the receive windows: only flag the reading for loop()
+void userReadingDue(void)
+{
+    TimerSetValue(&appTimer, APP_INTERVAL_MS);
+    TimerStart(&appTimer);
+    readingDue = true;
+}
+
+// Send data callback function
+void txCb(bool isconfirm, int8_t datarate, int8_t txeirp, uint8_t Channel)
+{
+    printf("Frame sent, datarate: %d, %d readings left\n", datarate, node.getQueuedRecords());
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    delay(5000); // Open the serial port within 5 seconds after uploading to view full print output
+
+    if(!(node.init(/*dataRate=*/DR_4, /*txEirp=*/16))){     // Initialize the LoRaWAN node, set the data rate and Tx Eirp
+        printf("LoRaWAN Init Failed!\nPlease Check: DR or Region\n");
+        while(1);
+    }
+    node.setUplinkQueue(port, /*confirmed=*/false, /*maxAgeMs=*/APP_MAX_AGE_MS);
+    TimerInit(&appTimer, userReadingDue);               // Initialize timer event
+    node.setTxCB(txCb);                                 // Set the callback function for sending data
+    node.join(joinCb);                                  // Join the LoRaWAN network
+    printf("Join Request Packet\n");
+}
+
+void loop()
+{
+    if(readingDue){
+        readingDue = false;
+        uint32_t reading = millis();
+        if(node.queueRecord(&reading, /*size=*/sizeof(reading))){
+            printf("Reading queued, %d waiting\n", node.getQueuedRecords());
+        }else{
+            printf("Queue full\n");
+        }
+    }
+    delay(100);
+}
@@ -0,0 +1,85 @@
+/*!
+ *@file CryptoBenchmark.ino
+ *@brief Checks and times the AES backend used by the LoRaWAN stack.
+ *@details The stack encrypts frames and computes their MIC with aes.c/cmac.c by default. Build the
+           library with SOFT_SE_AES_BACKEND set to SOFT_SE_AES_ESP32 or SOFT_SE_AES_MBEDTLS to use the
+           AES peripheral of the ESP32 or mbedTLS instead, see soft-se-aes.h. With the software
+           backend, AES_T_TABLES selects the faster 32-bit table version of aes.c.
+           This example checks the selected backend against the FIPS-197 and RFC 4493 test vectors,
+           then prints the time of a key setup, of one block, of the MIC of a 32-byte frame and of
+           the encryption of a 51-byte payload, with the CPU cycles per byte.
+ *@copyright Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ *@licence The MIT License (MIT)
+ *@author [Martin](Martin@dfrobot.com)
+ *@version V0.0.1
+ *@date 2025-2-24
+ *@url https://github.com/DFRobot/DFRobot_LoRaWAN
+ */
+
+#include "DFRobot_LoRaWAN.h"
+#include "mac/LoRaMacCrypto.h"
+#include "system/crypto/soft-se-aes.h"
+
+// Number of runs of each operation
+#define BENCH_ITERATIONS 2000
+
+const uint8_t key[16] = {
+  0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+  0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10};
+
+SoftSeAesKey_t aesKey;
+uint8_t frame[64];
+uint8_t out[64];
+
+void printTime(const char *name, uint32_t startUs, uint16_t bytes)
+{
+    float us = (float)(micros() - startUs) / BENCH_ITERATIONS;
+    printf("%-16s %.2f us  %.1f cycles/byte\n", name, us, us * getCpuFrequencyMhz() / bytes);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    delay(1000);
+
+    printf("AES backend: %s\n", SoftSeAesGetBackendName());
+    printf("Test vectors: %s\n", SoftSeAesSelfTest() ? "ok" : "FAILED");
+    if(!SoftSeAesSetKey(&aesKey, key)){
+        printf("Key setup FAILED\n");
+        return;
+    }
+
+    for(uint8_t i = 0; i < sizeof(frame); i++){
+        frame[i] = i;
+    }
+
+    uint32_t start = micros();
+    for(uint32_t i = 0; i < BENCH_ITERATIONS; i++){
+        SoftSeAesSetKey(&aesKey, key);
+    }
+    printTime("key setup", start, 16);
+
+    start = micros();
+    for(uint32_t i = 0; i < BENCH_ITERATIONS; i++){
+        SoftSeAesEncrypt(&aesKey, frame, out);
+    }
+    printTime("block", start, 16);
+
+    // B0 block followed by the frame, as for an uplink MIC
+    start = micros();
+    for(uint32_t i = 0; i < BENCH_ITERATIONS; i++){
+        SoftSeAesCmac(&aesKey, frame + 32, frame, 32, out);
+    }
+    printTime("mic 32 bytes", start, 48);
+
+    start = micros();
+    for(uint32_t i = 0; i < BENCH_ITERATIONS; i++){
+        LoRaMacPayloadEncryptPrekeyed(frame, 51, &aesKey, 0x26011234, 0, i, out);
+    }
+    printTime("payload 51 bytes", start, 51);
+}
+
+void loop()
+{
+    delay(1000);
+}
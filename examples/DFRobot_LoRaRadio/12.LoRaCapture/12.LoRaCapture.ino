@@ -0,0 +1,56 @@
+/*!
+ *@file LoRaCapture.ino
+ *@brief Capture every LoRa frame on a channel.
+ *@details Keeps the radio in continuous reception. Frames are queued in the ring buffer of the
+           library together with their RSSI, SNR and timestamp, and printed from loop() at its own pace.
+ *@copyright Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ *@licence The MIT License (MIT)
+ *@author [Martin](Martin@dfrobot.com)
+ *@version V0.0.1
+ *@date 2025-3-12
+ *@url https://github.com/DFRobot/DFRobot_LoRaWAN
+ */
+#include "DFRobot_LoRaRadio.h"
+
+/*
+* Region | Spreading Factor
+* -------------------------
+*  EU868 |    SF7 ~ SF12
+*  US915 |    SF8 ~ SF12
+*/  
+#ifdef REGION_EU868
+#define RF_FREQUENCY 868000000  // Hz
+#endif
+#ifdef REGION_US915
+#define RF_FREQUENCY 915000000  // Hz
+#endif
+#define LORA_SPREADING_FACTOR 7
+
+DFRobot_LoRaRadio radio;
+sLoRaRxPacket_t packet;
+
+void setup()
+{
+    Serial.begin(115200);       // Initialize serial communication with a baud rate of 115200
+    delay(5000);                                  // Open the serial port within 5 seconds after uploading to view full print output
+    radio.init();                                 // Initialize the LoRa node with a default bandwidth of 125 KHz    
+    radio.setFreq(RF_FREQUENCY);                  // Set the communication frequency
+    radio.setSF(LORA_SPREADING_FACTOR);           // Set the spreading factor
+    radio.setBW(BW_125);                          // Set the bandwidth
+    radio.startCapture();                         // Start continuous reception into the ring buffer
+}
+
+void loop()
+{
+    while(radio.readPacket(packet)){
+        printf("[%llu us] size=%d Rssi=%d Snr=%d Data={", packet.timestampUs, packet.size, packet.rssi, packet.snr);
+        for(uint8_t i = 0; i < packet.size; i++){
+            printf("0x%02x%s", packet.payload[i], (i + 1 < packet.size) ? ", " : "");
+        }
+        printf("}\n");
+    }
+
+    sLoRaRxStats_t stats = radio.getRxStats();
+    printf("received %lu, overflows %lu, crc errors %lu\n", stats.received, stats.overflows, stats.crcErrors);
+    delay(1000);
+}
@@ -0,0 +1,293 @@
+/*!
+ * \file      lorawan-host-aes.c
+ *
+ * \brief     Compares the byte oriented and the T-table lora_aes_encrypt
+ *
+ * \remark    aes.c is built twice, without and with AES_T_TABLES, the
+ *            functions of each copy renamed with an aes_bytes_ or aes_ttable_
+ *            prefix (see CMakeLists.txt). Both are checked against the
+ *            FIPS-197 vector and against each other on random keys and
+ *            blocks, then timed on a block, on the CMAC of a 64 bytes frame
+ *            (subkeys already derived, as the soft secure element keeps them)
+ *            and on the CTR decryption of a FUOTA fragment.
+ *
+ *            On x86 the figures are also given in time stamp counter cycles
+ *            per byte.
+ *
+ *            Usage: lorawan-host-aes [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "system/crypto/aes.h"
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+#define HOST_AES_DEFAULT_ITERATIONS                 200000
+#define HOST_AES_RANDOM_KEYS                        1000
+#define HOST_AES_CMAC_SIZE                          64
+#define HOST_AES_FRAGMENT_SIZE                      240
+
+typedef return_type ( *HostAesSetKey_t )( const uint8_t key[], length_type keylen, aes_context ctx[1] );
+typedef return_type ( *HostAesEncrypt_t )( const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK], const aes_context ctx[1] );
+
+return_type aes_bytes_set_key( const uint8_t key[], length_type keylen, aes_context ctx[1] );
+return_type aes_bytes_encrypt( const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK], const aes_context ctx[1] );
+return_type aes_ttable_set_key( const uint8_t key[], length_type keylen, aes_context ctx[1] );
+return_type aes_ttable_encrypt( const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK], const aes_context ctx[1] );
+
+typedef struct sHostAesImplementation
+{
+    const char *Name;
+    HostAesSetKey_t SetKey;
+    HostAesEncrypt_t Encrypt;
+}HostAesImplementation_t;
+
+static const HostAesImplementation_t Implementations[] =
+{
+    { "bytes", aes_bytes_set_key, aes_bytes_encrypt },
+    { "t-table", aes_ttable_set_key, aes_ttable_encrypt },
+};
+
+/*!
+ * Keeps the benchmarked calls from being optimized out
+ */
+static volatile uint8_t Sink = 0;
+
+static uint8_t Key[16];
+static uint8_t Message[HOST_AES_FRAGMENT_SIZE];
+
+/*!
+ * Time and, where there is one, time stamp counter of a measurement
+ */
+typedef struct sHostAesTime
+{
+    double Ns;
+    uint64_t Cycles;
+}HostAesTime_t;
+
+static void HostAesTimeGet( HostAesTime_t *time )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    time->Ns = ts.tv_sec * 1e9 + ts.tv_nsec;
+#if defined( __x86_64__ ) || defined( __i386__ )
+    time->Cycles = __rdtsc( );
+#else
+    time->Cycles = 0;
+#endif
+}
+
+static void HostAesTimeSince( HostAesTime_t *time, uint32_t iterations )
+{
+    HostAesTime_t now;
+
+    HostAesTimeGet( &now );
+    time->Ns = ( now.Ns - time->Ns ) / iterations;
+    time->Cycles = ( now.Cycles - time->Cycles ) / iterations;
+}
+
+static void HostAesRandom( uint8_t *buffer, uint16_t size )
+{
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        buffer[i] = ( uint8_t )rand( );
+    }
+}
+
+/*!
+ * \brief Checks both implementations against FIPS-197 appendix C.1 and
+ *        against each other
+ *
+ * \retval Number of mismatches
+ */
+static uint32_t HostAesCheck( void )
+{
+    static const uint8_t key[16] =
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+    };
+    static const uint8_t plain[16] =
+    {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+    };
+    static const uint8_t cipher[16] =
+    {
+        0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A
+    };
+    aes_context bytes;
+    aes_context ttable;
+    uint8_t expected[16];
+    uint8_t out[16];
+    uint32_t errors = 0;
+
+    for( uint8_t i = 0; i < 2; i++ )
+    {
+        aes_context ctx;
+
+        Implementations[i].SetKey( key, 16, &ctx );
+        Implementations[i].Encrypt( plain, out, &ctx );
+        if( memcmp( out, cipher, 16 ) != 0 )
+        {
+            printf( "%s: FIPS-197 vector mismatch\n", Implementations[i].Name );
+            errors++;
+        }
+    }
+
+    for( uint32_t k = 0; k < HOST_AES_RANDOM_KEYS; k++ )
+    {
+        HostAesRandom( Key, sizeof( Key ) );
+        aes_bytes_set_key( Key, 16, &bytes );
+        aes_ttable_set_key( Key, 16, &ttable );
+
+        for( uint8_t b = 0; b < 16; b++ )
+        {
+            HostAesRandom( Message, 16 );
+            aes_bytes_encrypt( Message, expected, &bytes );
+            aes_ttable_encrypt( Message, out, &ttable );
+            if( memcmp( out, expected, 16 ) != 0 )
+            {
+                printf( "t-table mismatch, key %u block %u\n", k, b );
+                errors++;
+            }
+            // In place, as the CMAC does
+            aes_ttable_encrypt( Message, Message, &ttable );
+            if( memcmp( Message, expected, 16 ) != 0 )
+            {
+                printf( "t-table in place mismatch, key %u block %u\n", k, b );
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+static void HostAesBenchBlock( const HostAesImplementation_t *aes, const aes_context *ctx, uint32_t iterations,
+                               HostAesTime_t *time )
+{
+    uint8_t block[16] = { 0 };
+
+    HostAesTimeGet( time );
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        aes->Encrypt( block, block, ctx );
+    }
+    HostAesTimeSince( time, iterations );
+    Sink = block[0];
+}
+
+/*!
+ * \brief CBC-MAC part of an AES-CMAC, the last block XORed with a fixed subkey
+ */
+static void HostAesBenchCmac( const HostAesImplementation_t *aes, const aes_context *ctx, uint32_t iterations,
+                              HostAesTime_t *time )
+{
+    static const uint8_t k1[16] = { 0x55 };
+    uint8_t x[16];
+
+    HostAesTimeGet( time );
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        memset( x, 0, sizeof( x ) );
+        for( uint16_t block = 0; block < HOST_AES_CMAC_SIZE; block += 16 )
+        {
+            for( uint8_t j = 0; j < 16; j++ )
+            {
+                x[j] ^= Message[block + j];
+            }
+            if( ( block + 16 ) == HOST_AES_CMAC_SIZE )
+            {
+                for( uint8_t j = 0; j < 16; j++ )
+                {
+                    x[j] ^= k1[j];
+                }
+            }
+            aes->Encrypt( x, x, ctx );
+        }
+        Sink = x[0];
+    }
+    HostAesTimeSince( time, iterations );
+}
+
+/*!
+ * \brief Counter mode decryption of a fragment, as LoRaMacPayloadEncrypt does
+ */
+static void HostAesBenchCtr( const HostAesImplementation_t *aes, const aes_context *ctx, uint32_t iterations,
+                             HostAesTime_t *time )
+{
+    uint8_t aBlock[16] = { 0x01 };
+    uint8_t sBlock[16];
+    uint8_t fragment[HOST_AES_FRAGMENT_SIZE];
+
+    HostAesTimeGet( time );
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        aBlock[10] = ( uint8_t )i;
+        for( uint16_t block = 0; block < HOST_AES_FRAGMENT_SIZE; block += 16 )
+        {
+            aBlock[15] = ( uint8_t )( ( block >> 4 ) + 1 );
+            aes->Encrypt( aBlock, sBlock, ctx );
+            for( uint8_t j = 0; j < 16; j++ )
+            {
+                fragment[block + j] = Message[block + j] ^ sBlock[j];
+            }
+        }
+        Sink = fragment[0];
+    }
+    HostAesTimeSince( time, iterations );
+}
+
+static void HostAesPrint( const char *name, uint16_t bytes, const HostAesTime_t *time )
+{
+    printf( "  %-14s %6.0f ns", name, time->Ns );
+    if( time->Cycles != 0 )
+    {
+        printf( "  %5.1f cycles/byte", ( double )time->Cycles / bytes );
+    }
+    printf( "\n" );
+}
+
+int main( int argc, char *argv[] )
+{
+    uint32_t iterations = HOST_AES_DEFAULT_ITERATIONS;
+    uint32_t errors;
+    HostAesTime_t times[2][3];
+
+    if( argc > 1 )
+    {
+        iterations = strtoul( argv[1], NULL, 0 );
+    }
+    if( iterations == 0 )
+    {
+        iterations = 1;
+    }
+    srand( 1 );
+
+    errors = HostAesCheck( );
+    printf( "equivalence     %s (%u errors)\n", ( errors == 0 ) ? "ok" : "FAILED", errors );
+
+    HostAesRandom( Key, sizeof( Key ) );
+    HostAesRandom( Message, sizeof( Message ) );
+    for( uint8_t i = 0; i < 2; i++ )
+    {
+        const HostAesImplementation_t *aes = &Implementations[i];
+        aes_context ctx;
+
+        aes->SetKey( Key, 16, &ctx );
+        HostAesBenchBlock( aes, &ctx, iterations, &times[i][0] );
+        HostAesBenchCmac( aes, &ctx, iterations, &times[i][1] );
+        HostAesBenchCtr( aes, &ctx, iterations / 4 + 1, &times[i][2] );
+
+        printf( "%s\n", aes->Name );
+        HostAesPrint( "block", 16, &times[i][0] );
+        HostAesPrint( "cmac 64 B", HOST_AES_CMAC_SIZE, &times[i][1] );
+        HostAesPrint( "ctr 240 B", HOST_AES_FRAGMENT_SIZE, &times[i][2] );
+    }
+    printf( "speedup         block x%.1f, cmac x%.1f, ctr x%.1f\n", times[0][0].Ns / times[1][0].Ns,
+            times[0][1].Ns / times[1][1].Ns, times[0][2].Ns / times[1][2].Ns );
+
+    return ( errors == 0 ) ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+/*!
+ * \file      lorawan-host-crc32.c
+ *
+ * \brief     Checks the Crc32 kernel of utilities.c against the bitwise
+ *            reference and measures both
+ *
+ * \remark    Every length up to 1400 bytes (the whole MAC context) is checked
+ *            from every start alignment, in one call and split over
+ *            Crc32Update calls. The benchmark runs over the sizes of the NVM
+ *            groups LoRaMacHandleNvm checks on each idle pass.
+ *
+ *            Usage: lorawan-host-crc32 [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mac/LoRaMac.h"
+#include "system/utilities.h"
+
+#define HOST_CRC32_DEFAULT_ITERATIONS               20000
+#define HOST_CRC32_MAX_LENGTH                       1400
+
+static uint8_t Buffer[HOST_CRC32_MAX_LENGTH + 8];
+
+/*!
+ * Keeps the benchmarked calls from being optimized out
+ */
+static volatile uint32_t Sink = 0;
+
+/*!
+ * \brief Bit by bit implementation the stack used before the table driven one
+ */
+static uint32_t Crc32UpdateReference( uint32_t crc, const uint8_t *buffer, uint16_t length )
+{
+    // The CRC calculation follows CCITT - 0x04C11DB7
+    const uint32_t reversedPolynom = 0xEDB88320;
+
+    for( uint16_t i = 0; i < length; ++i )
+    {
+        crc ^= ( uint32_t )buffer[i];
+        for( uint16_t j = 0; j < 8; j++ )
+        {
+            crc = ( crc >> 1 ) ^ ( reversedPolynom & ~( ( crc & 0x01 ) - 1 ) );
+        }
+    }
+    return crc;
+}
+
+static uint32_t Crc32Reference( const uint8_t *buffer, uint16_t length )
+{
+    return ~Crc32UpdateReference( 0xFFFFFFFF, buffer, length );
+}
+
+static double HostCrc32TimeNs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint32_t HostCrc32Check( void )
+{
+    uint32_t errors = 0;
+    uint8_t check[] = "123456789";
+
+    if( ( Crc32( check, 9 ) != 0xCBF43926 ) || ( Crc32Reference( check, 9 ) != 0xCBF43926 ) )
+    {
+        printf( "check value mismatch: 0x%08X\n", Crc32( check, 9 ) );
+        errors++;
+    }
+    if( Crc32( NULL, 4 ) != 0 )
+    {
+        errors++;
+    }
+
+    for( uint16_t length = 0; length <= HOST_CRC32_MAX_LENGTH; length++ )
+    {
+        for( uint8_t offset = 0; offset < 8; offset++ )
+        {
+            uint8_t *data = Buffer + offset;
+            uint32_t expected = Crc32Reference( data, length );
+            uint16_t split = ( uint16_t )( ( length * 7 + offset ) % ( length + 1 ) );
+            uint32_t crc;
+
+            if( Crc32( data, length ) != expected )
+            {
+                printf( "Crc32 mismatch, length %u offset %u\n", length, offset );
+                errors++;
+            }
+
+            crc = Crc32Init( );
+            crc = Crc32Update( crc, data, split );
+            crc = Crc32Update( crc, data + split, length - split );
+            if( Crc32Finalize( crc ) != expected )
+            {
+                printf( "Crc32Update mismatch, length %u split %u\n", length, split );
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+/*!
+ * \brief Runs a CRC over the NVM group sizes
+ *
+ * \retval Nanoseconds per pass over all the groups
+ */
+static double HostCrc32Bench( bool reference, uint32_t iterations )
+{
+    static const uint16_t sizes[] =
+    {
+        sizeof( LoRaMacCryptoNvmData_t ), sizeof( LoRaMacNvmDataGroup1_t ), sizeof( LoRaMacNvmDataGroup2_t ),
+        sizeof( SecureElementNvmData_t ), sizeof( RegionNvmDataGroup1_t ), sizeof( RegionNvmDataGroup2_t ),
+        sizeof( LoRaMacClassBNvmData_t ),
+    };
+    double start = HostCrc32TimeNs( );
+
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        uint16_t offset = 0;
+
+        Buffer[0] = ( uint8_t )i;
+        for( uint8_t g = 0; g < sizeof( sizes ) / sizeof( sizes[0] ); g++ )
+        {
+            uint16_t length = sizes[g] - sizeof( uint32_t );
+
+            Sink = ( reference == true ) ? Crc32Reference( Buffer + offset, length ) : Crc32( Buffer + offset, length );
+            offset += sizes[g];
+        }
+    }
+    return ( HostCrc32TimeNs( ) - start ) / iterations;
+}
+
+int main( int argc, char *argv[] )
+{
+    uint32_t iterations = HOST_CRC32_DEFAULT_ITERATIONS;
+    uint32_t errors;
+    double referenceNs;
+    double kernelNs;
+
+    if( argc > 1 )
+    {
+        iterations = strtoul( argv[1], NULL, 0 );
+    }
+    if( iterations == 0 )
+    {
+        iterations = 1;
+    }
+
+    srand( 1 );
+    for( uint16_t i = 0; i < sizeof( Buffer ); i++ )
+    {
+        Buffer[i] = ( uint8_t )rand( );
+    }
+
+    errors = HostCrc32Check( );
+    printf( "equivalence     %s (%u errors)\n", ( errors == 0 ) ? "ok" : "FAILED", errors );
+
+    referenceNs = HostCrc32Bench( true, iterations );
+    kernelNs = HostCrc32Bench( false, iterations );
+    printf( "nvm groups      %u bytes per pass\n", ( uint32_t )sizeof( LoRaMacNvmData_t ) );
+    printf( "bitwise         %.0f ns per pass\n", referenceNs );
+    printf( "table           %.0f ns per pass (x%.1f)\n", kernelNs, referenceNs / kernelNs );
+
+    return ( errors == 0 ) ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+/*!
+ * \file      lorawan-host-crypto.c
+ *
+ * \brief     Checks the AES backend of the soft secure element and measures it
+ *
+ * \remark    The backend is the one the host library was built with, see
+ *            LORAWAN_AES_BACKEND in CMakeLists.txt. It is checked against the
+ *            FIPS-197 and RFC 4493 vectors, then against aes.c and cmac.c on
+ *            random keys and messages, with and without a Bx block. The
+ *            benchmark runs the operations a LoRaWAN frame goes through.
+ *
+ *            Usage: lorawan-host-crypto [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "system/crypto/aes.h"
+#include "system/crypto/cmac.h"
+#include "system/crypto/soft-se-aes.h"
+#include "mac/LoRaMacCrypto.h"
+
+#define HOST_CRYPTO_DEFAULT_ITERATIONS              200000
+#define HOST_CRYPTO_RANDOM_KEYS                     64
+#define HOST_CRYPTO_MAX_LENGTH                      80
+
+/*!
+ * Keeps the benchmarked calls from being optimized out
+ */
+static volatile uint8_t Sink = 0;
+
+static uint8_t Key[16];
+static uint8_t Message[256];
+
+static double HostCryptoTimeNs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void HostCryptoRandom( uint8_t *buffer, uint16_t size )
+{
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        buffer[i] = ( uint8_t )rand( );
+    }
+}
+
+/*!
+ * \brief Compares the backend with aes.c and cmac.c
+ *
+ * \retval Number of mismatches
+ */
+static uint32_t HostCryptoCheck( void )
+{
+    static SoftSeAesKey_t aesKey;
+    uint32_t errors = 0;
+
+    for( uint16_t k = 0; k < HOST_CRYPTO_RANDOM_KEYS; k++ )
+    {
+        aes_context reference;
+        uint8_t expected[16];
+        uint8_t out[16];
+
+        HostCryptoRandom( Key, sizeof( Key ) );
+        HostCryptoRandom( Message, sizeof( Message ) );
+        SoftSeAesSetKey( &aesKey, Key );
+        aes_set_key( Key, 16, &reference );
+
+        lora_aes_encrypt( Message, expected, &reference );
+        SoftSeAesEncrypt( &aesKey, Message, out );
+        if( memcmp( out, expected, 16 ) != 0 )
+        {
+            printf( "block mismatch, key %u\n", k );
+            errors++;
+        }
+
+        for( uint16_t length = 0; length <= HOST_CRYPTO_MAX_LENGTH; length++ )
+        {
+            AES_CMAC_CTX cmacCtx;
+
+            AES_CMAC_Init( &cmacCtx );
+            AES_CMAC_SetKey( &cmacCtx, Key );
+            AES_CMAC_Update( &cmacCtx, Message, length );
+            AES_CMAC_Final( expected, &cmacCtx );
+            SoftSeAesCmac( &aesKey, NULL, Message, length, out );
+            if( memcmp( out, expected, 16 ) != 0 )
+            {
+                printf( "cmac mismatch, key %u length %u\n", k, length );
+                errors++;
+            }
+
+            // Bx block followed by the message, as for the frame MICs
+            AES_CMAC_Init( &cmacCtx );
+            AES_CMAC_SetKey( &cmacCtx, Key );
+            AES_CMAC_Update( &cmacCtx, Message + 128, 16 );
+            AES_CMAC_Update( &cmacCtx, Message, length );
+            AES_CMAC_Final( expected, &cmacCtx );
+            SoftSeAesCmac( &aesKey, Message + 128, Message, length, out );
+            if( memcmp( out, expected, 16 ) != 0 )
+            {
+                printf( "cmac with bx mismatch, key %u length %u\n", k, length );
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+/*!
+ * \brief Times the key setup of the backend
+ *
+ * \retval Nanoseconds per key
+ */
+static double HostCryptoBenchKey( uint32_t iterations )
+{
+    static SoftSeAesKey_t aesKey;
+    double start = HostCryptoTimeNs( );
+
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        Key[0] = ( uint8_t )i;
+        SoftSeAesSetKey( &aesKey, Key );
+    }
+    return ( HostCryptoTimeNs( ) - start ) / iterations;
+}
+
+/*!
+ * \brief Times the encryption of one block
+ *
+ * \retval Nanoseconds per block
+ */
+static double HostCryptoBenchBlock( SoftSeAesKey_t *aesKey, uint32_t iterations )
+{
+    uint8_t block[16] = { 0 };
+    double start = HostCryptoTimeNs( );
+
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        SoftSeAesEncrypt( aesKey, block, block );
+    }
+    Sink = block[0];
+    return ( HostCryptoTimeNs( ) - start ) / iterations;
+}
+
+/*!
+ * \brief Times the MIC of an uplink: B0 block and a frame of the given size
+ *
+ * \retval Nanoseconds per MIC
+ */
+static double HostCryptoBenchMic( SoftSeAesKey_t *aesKey, uint16_t size, uint32_t iterations )
+{
+    uint8_t cmac[16];
+    double start = HostCryptoTimeNs( );
+
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        Message[0] = ( uint8_t )i;
+        SoftSeAesCmac( aesKey, Message + 128, Message, size, cmac );
+        Sink = cmac[0];
+    }
+    return ( HostCryptoTimeNs( ) - start ) / iterations;
+}
+
+/*!
+ * \brief Times the payload encryption of a frame of the given size
+ *
+ * \retval Nanoseconds per frame
+ */
+static double HostCryptoBenchPayload( SoftSeAesKey_t *aesKey, uint16_t size, uint32_t iterations )
+{
+    uint8_t frame[256];
+    double start = HostCryptoTimeNs( );
+
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        LoRaMacPayloadEncryptPrekeyed( Message, size, aesKey, 0x26011234, 0, i, frame );
+        Sink = frame[0];
+    }
+    return ( HostCryptoTimeNs( ) - start ) / iterations;
+}
+
+/*!
+ * \brief Times what a join accept costs: key setup, decryption of 32 bytes
+ *        and the CMAC of the 29 decrypted bytes
+ *
+ * \retval Nanoseconds per join accept
+ */
+static double HostCryptoBenchJoinAccept( uint32_t iterations )
+{
+    static SoftSeAesKey_t aesKey;
+    uint8_t plain[32];
+    uint8_t cmac[16];
+    double start = HostCryptoTimeNs( );
+
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        Key[0] = ( uint8_t )i;
+        SoftSeAesSetKey( &aesKey, Key );
+        SoftSeAesEncrypt( &aesKey, Message, plain );
+        SoftSeAesEncrypt( &aesKey, Message + 16, plain + 16 );
+        SoftSeAesCmac( &aesKey, NULL, plain, 29, cmac );
+        Sink = cmac[0];
+    }
+    return ( HostCryptoTimeNs( ) - start ) / iterations;
+}
+
+int main( int argc, char *argv[] )
+{
+    static SoftSeAesKey_t aesKey;
+    uint32_t iterations = HOST_CRYPTO_DEFAULT_ITERATIONS;
+    uint32_t errors = 0;
+    bool selfTest;
+    double blockNs;
+
+    if( argc > 1 )
+    {
+        iterations = strtoul( argv[1], NULL, 0 );
+    }
+    if( iterations == 0 )
+    {
+        iterations = 1;
+    }
+    srand( 1 );
+
+    selfTest = SoftSeAesSelfTest( );
+    printf( "backend         %s\n", SoftSeAesGetBackendName( ) );
+    printf( "vectors         %s\n", ( selfTest == true ) ? "ok" : "FAILED" );
+    errors = HostCryptoCheck( );
+    printf( "equivalence     %s (%u errors)\n", ( errors == 0 ) ? "ok" : "FAILED", errors );
+
+    HostCryptoRandom( Key, sizeof( Key ) );
+    HostCryptoRandom( Message, sizeof( Message ) );
+    SoftSeAesSetKey( &aesKey, Key );
+
+    blockNs = HostCryptoBenchBlock( &aesKey, iterations );
+    printf( "key setup       %.0f ns\n", HostCryptoBenchKey( iterations ) );
+    printf( "block           %.0f ns (%.1f MB/s)\n", blockNs, 16e3 / blockNs );
+    printf( "mic 32 bytes    %.0f ns\n", HostCryptoBenchMic( &aesKey, 32, iterations ) );
+    printf( "payload 51 B    %.0f ns\n", HostCryptoBenchPayload( &aesKey, 51, iterations ) );
+    printf( "join accept     %.0f ns\n", HostCryptoBenchJoinAccept( iterations ) );
+
+    return ( ( selfTest == true ) && ( errors == 0 ) ) ? 0 : 1;
+}
@@ -0,0 +1,1023 @@
+/*!
+ * \file      lorawan-host-fleet.c
+ *
+ * \brief     Multi-node air channel simulator with a network server stand-in
+ *
+ * \remark    Every node runs its own copy of the LoRaWAN stack: the shared
+ *            object built by the host CMake project is loaded once per node
+ *            from an anonymous memory file, so each node gets private MAC,
+ *            timer and virtual radio globals. A single virtual clock drives
+ *            all copies in time order.
+ *
+ *            The air channel records every transmission with the time on air
+ *            given by the virtual radio (same computation as RadioTimeOnAir in
+ *            radio/sx126x/radio.c). Frames overlapping on the same channel and
+ *            spreading factor are lost, frames below the demodulation floor of
+ *            their spreading factor are lost too. Duty-cycle is enforced by the
+ *            MAC layer itself (RegionCommonUpdateBandTimeOff).
+ *
+ *            The network server handles OTAA joins, acknowledges confirmed
+ *            uplinks and runs a basic ADR algorithm (LinkADRReq in FOpts).
+ *            Downlinks are always delivered: gateway TX/RX half-duplex and
+ *            downlink collisions are not modelled. The server side is written
+ *            for EU868 (3 default channels, DR0..DR5 = SF12..SF7).
+ *
+ *            Nodes power on at random times within the power-on window and
+ *            join before sending an uplink every period (+/- 50%).
+ *
+ *            Usage: lorawan-host-fleet [-t seconds] [-p period] [-w power-on window]
+ *                                      [-l library] [-s seed] [nodes...]
+ */
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include "system/crypto/aes.h"
+#include "system/crypto/cmac.h"
+#include "mac/LoRaMac.h"
+#include "LmHandler.h"
+#include "packages/LmhpCompliance.h"
+#include "radio/virtual/radio-virtual.h"
+
+#define FLEET_DEFAULT_DURATION                      3600
+#define FLEET_DEFAULT_PERIOD                        120
+#define FLEET_DEFAULT_POWER_ON_WINDOW               300
+#define FLEET_APP_PORT                              2
+#define FLEET_APP_PAYLOAD_SIZE                      10
+#define FLEET_NET_ID                                0x000013
+#define FLEET_DEV_ADDR_BASE                         0x26000000
+
+/*!
+ * Every n-th uplink of a node is confirmed
+ */
+#define FLEET_CONFIRMED_PERIOD                      8
+
+/*!
+ * Delay before retrying a failed join [ms]
+ */
+#define FLEET_JOIN_RETRY_MIN                        5000
+#define FLEET_JOIN_RETRY_MAX                        30000
+
+/*!
+ * Number of uplinks the ADR algorithm looks at before deciding
+ */
+#define FLEET_ADR_HISTORY                           20
+
+/*!
+ * ADR installation margin [dB]
+ */
+#define FLEET_ADR_MARGIN                            10
+
+/*!
+ * Node link budget range [dB]
+ */
+#define FLEET_SNR_MIN                               -18
+#define FLEET_SNR_MAX                               8
+
+#define FLEET_TIME_NEVER                            TIMERTIME_T_MAX
+
+/*!
+ * Entry points of one private copy of the stack
+ */
+typedef struct FleetStack_s
+{
+    int Fd;
+    void *Handle;
+    LmHandlerErrorStatus_t ( *LmHandlerInit )( LmHandlerCallbacks_t *callbacks, LmHandlerParams_t *handlerParams );
+    void ( *LmHandlerProcess )( void );
+    LmHandlerErrorStatus_t ( *LmHandlerSend )( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed );
+    void ( *LmHandlerJoin )( void );
+    LmHandlerErrorStatus_t ( *LmHandlerPackageRegister )( uint8_t id, void *params );
+    void ( *HostBoardInit )( uint32_t seed );
+    TimerTime_t ( *HostTimerGetNextDeadline )( void );
+    void ( *HostTimerAdvance )( TimerTime_t milliseconds );
+    TimerTime_t ( *TimerGetCurrentTime )( void );
+    void ( *VirtualRadioSetTxHook )( VirtualRadioTxHook_t hook, void *context );
+    bool ( *VirtualRadioInjectRx )( const uint8_t *buffer, uint8_t size, int16_t rssi, int8_t snr );
+}FleetStack_t;
+
+typedef enum FleetNodeState_e
+{
+    FLEET_NODE_JOINING,
+    FLEET_NODE_IDLE,
+    FLEET_NODE_SENDING,
+}FleetNodeState_t;
+
+/*!
+ * End-device side of a node
+ */
+typedef struct FleetNode_s
+{
+    FleetStack_t Stack;
+    uint32_t Index;
+    FleetNodeState_t State;
+    int8_t Snr;
+    uint8_t DevEui[8];
+    uint8_t JoinEui[8];
+    uint8_t AppKey[16];
+    uint8_t NwkSKey[16];
+    uint8_t AppSKey[16];
+    uint8_t AppData[242];
+    LmHandlerParams_t Params;
+    TimerTime_t NextAction;
+    TimerTime_t JoinStart;
+    TimerTime_t JoinTime;
+    uint32_t JoinAttempts;
+    uint32_t Uplinks;
+}FleetNode_t;
+
+/*!
+ * Network server side of a node
+ */
+typedef struct FleetDevice_s
+{
+    bool Joined;
+    uint32_t DevAddr;
+    uint8_t NwkSKey[16];
+    uint8_t AppSKey[16];
+    uint32_t FCntDown;
+    bool HasFCntUp;
+    uint16_t LastFCntUp;
+    uint8_t AdrCount;
+    int8_t AdrMaxSnr;
+}FleetDevice_t;
+
+/*!
+ * Transmission on the air channel
+ */
+typedef struct FleetFrame_s
+{
+    FleetNode_t *Node;
+    TimerTime_t Start;
+    TimerTime_t End;
+    uint32_t Freq;
+    uint32_t Sf;
+    bool Handled;
+    bool Collided;
+    uint8_t Size;
+    uint8_t Payload[255];
+}FleetFrame_t;
+
+typedef struct FleetStats_s
+{
+    uint32_t Frames;
+    uint32_t Collisions;
+    uint32_t BelowSensitivity;
+    uint32_t JoinAccepts;
+    uint32_t Delivered;
+    uint32_t DeliveredBytes;
+    uint32_t Acks;
+    uint32_t AdrCommands;
+    uint32_t DutyCycleRestricted;
+}FleetStats_t;
+
+static uint8_t AppKey[] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+
+/*!
+ * Demodulation floor per spreading factor, SF7 to SF12 [dB]
+ */
+static const int8_t RequiredSnr[] = { -8, -10, -13, -15, -18, -20 };
+
+static const char *LibraryPath = LORAWAN_HOST_SHARED_LIBRARY;
+static void *LibraryImage = NULL;
+static size_t LibraryImageSize = 0;
+
+static TimerTime_t Now = 0;
+static uint32_t Seed = 1;
+static FleetNode_t *CurrentNode = NULL;
+
+static FleetNode_t *Nodes = NULL;
+static FleetDevice_t *Devices = NULL;
+static uint32_t NodeCount = 0;
+static FleetFrame_t *Frames = NULL;
+static uint32_t FrameCount = 0;
+static uint32_t AppNonce = 0;
+static FleetStats_t Stats;
+
+static TimerTime_t Period = FLEET_DEFAULT_PERIOD * 1000;
+static TimerTime_t PowerOnWindow = FLEET_DEFAULT_POWER_ON_WINDOW * 1000;
+
+static LmhpComplianceParams_t LmhpComplianceParams =
+{
+    .AdrEnabled = true,
+    .DutyCycleEnabled = true,
+    .StopPeripherals = NULL,
+    .StartPeripherals = NULL,
+};
+
+static uint32_t FleetRandom( void )
+{
+    // xorshift32, kept apart from the C library generator used by the stacks
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static uint32_t FleetRandomRange( uint32_t min, uint32_t max )
+{
+    return min + FleetRandom( ) % ( max - min + 1 );
+}
+
+/*
+ *=============================================================================
+ * END-DEVICE APPLICATION
+ *=============================================================================
+ */
+
+static uint8_t OnGetBatteryLevel( void )
+{
+    return 0;
+}
+
+static uint32_t OnGetRandomSeed( void )
+{
+    return FleetRandom( );
+}
+
+static void OnMacProcessNotify( void )
+{
+}
+
+static void OnNetworkParametersChange( CommissioningParams_t *params )
+{
+}
+
+static void OnMacMcpsRequest( LoRaMacStatus_t status, McpsReq_t *mcpsReq, TimerTime_t nextTxDelay )
+{
+    if( status == LORAMAC_STATUS_OK )
+    {
+        return;
+    }
+    // The wait time is only meaningful when the request hit the duty-cycle
+    if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
+    {
+        Stats.DutyCycleRestricted++;
+    }
+    else
+    {
+        nextTxDelay = 0;
+    }
+    CurrentNode->State = FLEET_NODE_IDLE;
+    // Random back-off, nodes restricted together would otherwise retry together
+    CurrentNode->NextAction = Now + nextTxDelay + FleetRandomRange( 1000, 5000 );
+}
+
+static void OnMacMlmeRequest( LoRaMacStatus_t status, MlmeReq_t *mlmeReq, TimerTime_t nextTxDelay )
+{
+    if( status == LORAMAC_STATUS_OK )
+    {
+        return;
+    }
+    // The wait time is only meaningful when the request hit the duty-cycle
+    if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
+    {
+        Stats.DutyCycleRestricted++;
+    }
+    else
+    {
+        nextTxDelay = 0;
+    }
+    // Random back-off, nodes restricted together would otherwise retry together
+    CurrentNode->NextAction = Now + nextTxDelay + FleetRandomRange( 1000, 5000 );
+}
+
+static void OnJoinRequest( LmHandlerJoinParams_t *params )
+{
+    if( params->Status == LORAMAC_HANDLER_SUCCESS )
+    {
+        CurrentNode->State = FLEET_NODE_IDLE;
+        CurrentNode->JoinTime = Now - CurrentNode->JoinStart;
+        CurrentNode->NextAction = Now + FleetRandomRange( 0, Period );
+    }
+    else
+    {
+        CurrentNode->NextAction = Now + FleetRandomRange( FLEET_JOIN_RETRY_MIN, FLEET_JOIN_RETRY_MAX );
+    }
+}
+
+static void OnTxData( LmHandlerTxParams_t *params )
+{
+    if( ( params->IsMcpsConfirm == 0 ) || ( CurrentNode->State != FLEET_NODE_SENDING ) )
+    {
+        return;
+    }
+    CurrentNode->State = FLEET_NODE_IDLE;
+    CurrentNode->NextAction = Now + FleetRandomRange( Period / 2, Period + Period / 2 );
+}
+
+static void OnRxData( LmHandlerAppData_t *appData, LmHandlerRxParams_t *params )
+{
+}
+
+static void OnClassChange( DeviceClass_t deviceClass )
+{
+}
+
+static LmHandlerCallbacks_t LmHandlerCallbacks =
+{
+    .GetBatteryLevel = OnGetBatteryLevel,
+    .GetTemperature = NULL,
+    .GetRandomSeed = OnGetRandomSeed,
+    .OnMacProcess = OnMacProcessNotify,
+    .OnNvmDataChange = NULL,
+    .OnNetworkParametersChange = OnNetworkParametersChange,
+    .OnMacMcpsRequest = OnMacMcpsRequest,
+    .OnMacMlmeRequest = OnMacMlmeRequest,
+    .OnJoinRequest = OnJoinRequest,
+    .OnTxData = OnTxData,
+    .OnRxData = OnRxData,
+    .OnClassChange = OnClassChange,
+    .OnBeaconStatusChange = NULL,
+    .OnSysTimeUpdate = NULL,
+};
+
+static void FleetNodeAction( FleetNode_t *node )
+{
+    if( node->State == FLEET_NODE_JOINING )
+    {
+        if( node->JoinAttempts++ == 0 )
+        {
+            node->JoinStart = Now;
+        }
+        node->NextAction = FLEET_TIME_NEVER;
+        node->Stack.LmHandlerJoin( );
+    }
+    else if( node->State == FLEET_NODE_IDLE )
+    {
+        LmHandlerAppData_t appData;
+
+        memset( node->AppData, ( uint8_t )node->Uplinks, FLEET_APP_PAYLOAD_SIZE );
+        appData.Port = FLEET_APP_PORT;
+        appData.BufferSize = FLEET_APP_PAYLOAD_SIZE;
+        appData.Buffer = node->AppData;
+
+        node->State = FLEET_NODE_SENDING;
+        node->NextAction = FLEET_TIME_NEVER;
+        node->Stack.LmHandlerSend( &appData, ( ( ++node->Uplinks % FLEET_CONFIRMED_PERIOD ) == 0 ) ?
+                                   LORAMAC_HANDLER_CONFIRMED_MSG : LORAMAC_HANDLER_UNCONFIRMED_MSG );
+    }
+}
+
+/*!
+ * \brief Brings a node up to the current time and runs its pending work
+ */
+static void FleetNodeRun( FleetNode_t *node )
+{
+    CurrentNode = node;
+    do
+    {
+        node->Stack.HostTimerAdvance( Now - node->Stack.TimerGetCurrentTime( ) );
+        if( node->NextAction <= Now )
+        {
+            FleetNodeAction( node );
+        }
+        node->Stack.LmHandlerProcess( );
+    }while( ( node->Stack.HostTimerGetNextDeadline( ) <= Now ) || ( node->NextAction <= Now ) );
+    CurrentNode = NULL;
+}
+
+/*
+ *=============================================================================
+ * STACK COPIES
+ *=============================================================================
+ */
+
+static bool FleetLoadLibraryImage( void )
+{
+    FILE *file = fopen( LibraryPath, "rb" );
+
+    if( file == NULL )
+    {
+        perror( LibraryPath );
+        return false;
+    }
+    fseek( file, 0, SEEK_END );
+    LibraryImageSize = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    LibraryImage = malloc( LibraryImageSize );
+    if( ( LibraryImage == NULL ) || ( fread( LibraryImage, 1, LibraryImageSize, file ) != LibraryImageSize ) )
+    {
+        fclose( file );
+        return false;
+    }
+    fclose( file );
+    return true;
+}
+
+#define FLEET_BIND( stack, symbol )                                                 \
+    do                                                                              \
+    {                                                                               \
+        *( void ** )( &( stack )->symbol ) = dlsym( ( stack )->Handle, #symbol );  \
+        if( ( stack )->symbol == NULL )                                             \
+        {                                                                           \
+            fprintf( stderr, "missing symbol %s\n", #symbol );                      \
+            return false;                                                           \
+        }                                                                           \
+    }while( 0 )
+
+/*!
+ * \brief Loads a private copy of the stack
+ *
+ * \remark The dynamic loader shares objects by file name and identity, each
+ *         copy is therefore loaded from its own anonymous memory file, kept
+ *         open while the copy is in use so that no two copies share a path.
+ */
+static bool FleetStackLoad( FleetStack_t *stack )
+{
+    char path[64];
+
+    stack->Fd = memfd_create( "lorawan-host-node", MFD_CLOEXEC );
+    if( stack->Fd < 0 )
+    {
+        perror( "memfd_create" );
+        return false;
+    }
+    if( write( stack->Fd, LibraryImage, LibraryImageSize ) != ( ssize_t )LibraryImageSize )
+    {
+        return false;
+    }
+    snprintf( path, sizeof( path ), "/proc/self/fd/%d", stack->Fd );
+    stack->Handle = dlopen( path, RTLD_NOW | RTLD_LOCAL );
+    if( stack->Handle == NULL )
+    {
+        fprintf( stderr, "%s\n", dlerror( ) );
+        return false;
+    }
+
+    FLEET_BIND( stack, LmHandlerInit );
+    FLEET_BIND( stack, LmHandlerProcess );
+    FLEET_BIND( stack, LmHandlerSend );
+    FLEET_BIND( stack, LmHandlerJoin );
+    FLEET_BIND( stack, LmHandlerPackageRegister );
+    FLEET_BIND( stack, HostBoardInit );
+    FLEET_BIND( stack, HostTimerGetNextDeadline );
+    FLEET_BIND( stack, HostTimerAdvance );
+    FLEET_BIND( stack, TimerGetCurrentTime );
+    FLEET_BIND( stack, VirtualRadioSetTxHook );
+    FLEET_BIND( stack, VirtualRadioInjectRx );
+    return true;
+}
+
+/*
+ *=============================================================================
+ * NETWORK SERVER
+ *=============================================================================
+ */
+
+static void FleetPutUint32( uint8_t *buffer, uint32_t value )
+{
+    buffer[0] = value & 0xFF;
+    buffer[1] = ( value >> 8 ) & 0xFF;
+    buffer[2] = ( value >> 16 ) & 0xFF;
+    buffer[3] = ( value >> 24 ) & 0xFF;
+}
+
+static void FleetDeriveSessionKey( uint8_t type, const uint8_t *appNonceNetId, const uint8_t *devNonce, uint8_t *key )
+{
+    aes_context aesCtx;
+    uint8_t block[16] = { 0 };
+
+    block[0] = type;
+    memcpy( block + 1, appNonceNetId, 6 );
+    memcpy( block + 7, devNonce, 2 );
+    memset( &aesCtx, 0, sizeof( aesCtx ) );
+    aes_set_key( AppKey, 16, &aesCtx );
+    lora_aes_encrypt( block, key, &aesCtx );
+}
+
+/*!
+ * \brief Answers a join request with a join accept
+ *
+ * \retval size Join accept size, 0 if the request is not for this network
+ */
+static uint8_t FleetServerJoin( const FleetFrame_t *frame, FleetDevice_t **device, uint8_t *accept )
+{
+    aes_context aesCtx;
+    AES_CMAC_CTX cmacCtx;
+    uint8_t mic[16];
+    uint8_t plain[16];
+    uint32_t index;
+
+    if( frame->Size != 23 )
+    {
+        return 0;
+    }
+    // DevEUI is sent LSB first, the node index is kept in its two low bytes
+    index = frame->Payload[9] | ( frame->Payload[10] << 8 );
+    if( index >= NodeCount )
+    {
+        return 0;
+    }
+    *device = &Devices[index];
+
+    AppNonce++;
+    plain[0] = AppNonce & 0xFF;
+    plain[1] = ( AppNonce >> 8 ) & 0xFF;
+    plain[2] = ( AppNonce >> 16 ) & 0xFF;
+    plain[3] = FLEET_NET_ID & 0xFF;
+    plain[4] = ( FLEET_NET_ID >> 8 ) & 0xFF;
+    plain[5] = ( FLEET_NET_ID >> 16 ) & 0xFF;
+    FleetPutUint32( plain + 6, FLEET_DEV_ADDR_BASE | index );
+    plain[10] = 0x00;  // RX1DRoffset 0, RX2 DR0
+    plain[11] = 0x01;  // RxDelay 1 s
+
+    ( *device )->Joined = true;
+    ( *device )->DevAddr = FLEET_DEV_ADDR_BASE | index;
+    ( *device )->FCntDown = 0;
+    ( *device )->HasFCntUp = false;
+    ( *device )->AdrCount = 0;
+    ( *device )->AdrMaxSnr = -128;
+    FleetDeriveSessionKey( 0x01, plain, frame->Payload + 17, ( *device )->NwkSKey );
+    FleetDeriveSessionKey( 0x02, plain, frame->Payload + 17, ( *device )->AppSKey );
+
+    accept[0] = 0x20;
+    AES_CMAC_Init( &cmacCtx );
+    AES_CMAC_SetKey( &cmacCtx, AppKey );
+    AES_CMAC_Update( &cmacCtx, accept, 1 );
+    AES_CMAC_Update( &cmacCtx, plain, 12 );
+    AES_CMAC_Final( mic, &cmacCtx );
+    memcpy( plain + 12, mic, 4 );
+
+    // The end-device decrypts the join accept with an AES encryption
+    memset( &aesCtx, 0, sizeof( aesCtx ) );
+    aes_set_key( AppKey, 16, &aesCtx );
+    aes_decrypt( plain, accept + 1, &aesCtx );
+    return 17;
+}
+
+/*!
+ * \brief Builds a data downlink without application payload
+ */
+static uint8_t FleetServerBuildDownlink( FleetDevice_t *device, bool ack, const uint8_t *fOpts, uint8_t fOptsLen, uint8_t *frame )
+{
+    AES_CMAC_CTX cmacCtx;
+    uint8_t block[16] = { 0 };
+    uint8_t mic[16];
+    uint8_t size = 0;
+
+    device->FCntDown++;
+    frame[size++] = 0x60;
+    FleetPutUint32( frame + size, device->DevAddr );
+    size += 4;
+    frame[size++] = ( ack ? 0x20 : 0x00 ) | fOptsLen;
+    frame[size++] = device->FCntDown & 0xFF;
+    frame[size++] = ( device->FCntDown >> 8 ) & 0xFF;
+    memcpy( frame + size, fOpts, fOptsLen );
+    size += fOptsLen;
+
+    block[0] = 0x49;
+    block[5] = 0x01;
+    FleetPutUint32( block + 6, device->DevAddr );
+    FleetPutUint32( block + 10, device->FCntDown );
+    block[15] = size;
+    AES_CMAC_Init( &cmacCtx );
+    AES_CMAC_SetKey( &cmacCtx, device->NwkSKey );
+    AES_CMAC_Update( &cmacCtx, block, 16 );
+    AES_CMAC_Update( &cmacCtx, frame, size );
+    AES_CMAC_Final( mic, &cmacCtx );
+    memcpy( frame + size, mic, 4 );
+    return size + 4;
+}
+
+/*!
+ * \brief Handles a data uplink, returns the downlink size or 0
+ */
+static uint8_t FleetServerUplink( const FleetFrame_t *frame, FleetDevice_t **devicePtr, uint8_t *downlink )
+{
+    const uint8_t *payload = frame->Payload;
+    uint32_t devAddr;
+    uint8_t fCtrl;
+    uint8_t fOptsLen;
+    uint16_t fCnt;
+    uint8_t fOpts[5];
+    uint8_t newOptsLen = 0;
+    bool confirmed = ( ( payload[0] >> 5 ) == 0x04 );
+    FleetDevice_t *device;
+
+    if( frame->Size < 12 )
+    {
+        return 0;
+    }
+    devAddr = payload[1] | ( payload[2] << 8 ) | ( payload[3] << 16 ) | ( ( uint32_t )payload[4] << 24 );
+    if( ( ( devAddr & 0xFF000000 ) != FLEET_DEV_ADDR_BASE ) || ( ( devAddr & 0x00FFFFFF ) >= NodeCount ) )
+    {
+        return 0;
+    }
+    device = &Devices[devAddr & 0x00FFFFFF];
+    *devicePtr = device;
+    if( device->Joined == false )
+    {
+        return 0;
+    }
+    fCtrl = payload[5];
+    fOptsLen = fCtrl & 0x0F;
+    fCnt = payload[6] | ( payload[7] << 8 );
+
+    // Retransmissions keep the frame counter, they are delivered once
+    if( ( device->HasFCntUp == false ) || ( device->LastFCntUp != fCnt ) )
+    {
+        int32_t appSize = frame->Size - 8 - fOptsLen - 4 - 1;
+
+        device->HasFCntUp = true;
+        device->LastFCntUp = fCnt;
+        Stats.Delivered++;
+        Stats.DeliveredBytes += ( appSize > 0 ) ? appSize : 0;
+    }
+
+    // ADR: raise the datarate once enough uplinks show a link margin
+    if( ( fCtrl & 0x80 ) != 0 )
+    {
+        if( frame->Node->Snr > device->AdrMaxSnr )
+        {
+            device->AdrMaxSnr = frame->Node->Snr;
+        }
+        if( ++device->AdrCount >= FLEET_ADR_HISTORY )
+        {
+            int32_t dr = 12 - frame->Sf;
+            int32_t steps = ( device->AdrMaxSnr - RequiredSnr[frame->Sf - 7] - FLEET_ADR_MARGIN ) / 3;
+
+            if( ( steps > 0 ) && ( dr < DR_5 ) )
+            {
+                dr = ( dr + steps > DR_5 ) ? DR_5 : dr + steps;
+                fOpts[0] = 0x03;                // LinkADRReq
+                fOpts[1] = ( dr << 4 ) | 0x00;  // Datarate, max TX power
+                fOpts[2] = 0x07;                // Channels 0..2
+                fOpts[3] = 0x00;
+                fOpts[4] = 0x01;                // ChMaskCntl 0, NbTrans 1
+                newOptsLen = 5;
+                Stats.AdrCommands++;
+            }
+            device->AdrCount = 0;
+            device->AdrMaxSnr = -128;
+        }
+    }
+
+    if( ( confirmed == false ) && ( ( fCtrl & 0x40 ) == 0 ) && ( newOptsLen == 0 ) )
+    {
+        return 0;
+    }
+    if( confirmed == true )
+    {
+        Stats.Acks++;
+    }
+    return FleetServerBuildDownlink( device, confirmed, fOpts, newOptsLen, downlink );
+}
+
+static void FleetServerReceive( const FleetFrame_t *frame )
+{
+    FleetDevice_t *device = NULL;
+    uint8_t downlink[64];
+    uint8_t size = 0;
+    uint8_t mType = frame->Payload[0] >> 5;
+
+    if( mType == 0x00 )
+    {
+        size = FleetServerJoin( frame, &device, downlink );
+        if( size != 0 )
+        {
+            Stats.JoinAccepts++;
+        }
+    }
+    else if( ( mType == 0x02 ) || ( mType == 0x04 ) )
+    {
+        size = FleetServerUplink( frame, &device, downlink );
+    }
+    if( size != 0 )
+    {
+        frame->Node->Stack.VirtualRadioInjectRx( downlink, size, -100, frame->Node->Snr );
+    }
+}
+
+/*
+ *=============================================================================
+ * AIR CHANNEL
+ *=============================================================================
+ */
+
+static void OnRadioTx( const uint8_t *buffer, uint8_t size, uint32_t freq, uint32_t datarate, uint32_t airTime, void *context )
+{
+    FleetFrame_t *frame = &Frames[FrameCount++];
+
+    frame->Node = ( FleetNode_t * )context;
+    frame->Start = Now;
+    frame->End = Now + airTime;
+    frame->Freq = freq;
+    frame->Sf = datarate;
+    frame->Handled = false;
+    frame->Collided = false;
+    frame->Size = size;
+    memcpy( frame->Payload, buffer, size );
+    Stats.Frames++;
+}
+
+static TimerTime_t FleetChannelGetNextEnd( void )
+{
+    TimerTime_t next = FLEET_TIME_NEVER;
+
+    for( uint32_t i = 0; i < FrameCount; i++ )
+    {
+        if( ( Frames[i].Handled == false ) && ( Frames[i].End < next ) )
+        {
+            next = Frames[i].End;
+        }
+    }
+    return next;
+}
+
+/*!
+ * \brief Delivers the frames ending now to the network server
+ */
+static void FleetChannelProcess( void )
+{
+    TimerTime_t oldestStart = FLEET_TIME_NEVER;
+    uint32_t kept = 0;
+
+    for( uint32_t i = 0; i < FrameCount; i++ )
+    {
+        FleetFrame_t *frame = &Frames[i];
+
+        if( ( frame->Handled == true ) || ( frame->End > Now ) )
+        {
+            continue;
+        }
+        frame->Handled = true;
+        for( uint32_t j = 0; j < FrameCount; j++ )
+        {
+            FleetFrame_t *other = &Frames[j];
+
+            if( ( j != i ) && ( other->Freq == frame->Freq ) && ( other->Sf == frame->Sf ) &&
+                ( other->Start < frame->End ) && ( other->End > frame->Start ) )
+            {
+                frame->Collided = true;
+                break;
+            }
+        }
+        if( frame->Collided == true )
+        {
+            Stats.Collisions++;
+        }
+        else if( ( frame->Sf < 7 ) || ( frame->Sf > 12 ) || ( frame->Node->Snr < RequiredSnr[frame->Sf - 7] ) )
+        {
+            Stats.BelowSensitivity++;
+        }
+        else
+        {
+            FleetServerReceive( frame );
+        }
+    }
+
+    // Frames still on air may collide with frames already delivered
+    for( uint32_t i = 0; i < FrameCount; i++ )
+    {
+        if( ( Frames[i].Handled == false ) && ( Frames[i].Start < oldestStart ) )
+        {
+            oldestStart = Frames[i].Start;
+        }
+    }
+    for( uint32_t i = 0; i < FrameCount; i++ )
+    {
+        if( ( Frames[i].Handled == false ) || ( Frames[i].End > oldestStart ) )
+        {
+            if( kept != i )
+            {
+                Frames[kept] = Frames[i];
+            }
+            kept++;
+        }
+    }
+    FrameCount = kept;
+}
+
+/*
+ *=============================================================================
+ * SIMULATION
+ *=============================================================================
+ */
+
+static bool FleetNodeInit( FleetNode_t *node, uint32_t index )
+{
+    node->Index = index;
+    node->State = FLEET_NODE_JOINING;
+    node->Snr = ( int8_t )FleetRandomRange( 0, FLEET_SNR_MAX - FLEET_SNR_MIN ) + FLEET_SNR_MIN;
+    node->NextAction = FleetRandomRange( 0, PowerOnWindow );
+    node->JoinTime = FLEET_TIME_NEVER;
+    memset( node->DevEui, 0, sizeof( node->DevEui ) );
+    node->DevEui[0] = 0x70;
+    node->DevEui[6] = ( index >> 8 ) & 0xFF;
+    node->DevEui[7] = index & 0xFF;
+    memset( node->JoinEui, 0, sizeof( node->JoinEui ) );
+    memcpy( node->AppKey, AppKey, sizeof( AppKey ) );
+
+    node->Params.Region = LORAMAC_REGION_EU868;
+    node->Params.AdrEnable = true;
+    node->Params.TxDatarate = DR_0;
+    node->Params.PublicNetworkEnable = true;
+    node->Params.DutyCycleEnabled = true;
+    node->Params.DataBufferMaxSize = sizeof( node->AppData );
+    node->Params.DataBuffer = node->AppData;
+    node->Params.TxEirp = 16;
+    node->Params.joinType = ACTIVATION_TYPE_OTAA;
+    node->Params.DevEui = node->DevEui;
+    node->Params.JoinEui = node->JoinEui;
+    node->Params.AppKey = node->AppKey;
+    node->Params.DevAddr = 0;
+    node->Params.AppSKey = node->AppSKey;
+    node->Params.NwkSKey = node->NwkSKey;
+    node->Params.NbTrials = 1;
+    node->Params.Class = CLASS_A;
+
+    if( FleetStackLoad( &node->Stack ) == false )
+    {
+        return false;
+    }
+    CurrentNode = node;
+    node->Stack.HostBoardInit( FleetRandom( ) );
+    node->Stack.VirtualRadioSetTxHook( OnRadioTx, node );
+    if( node->Stack.LmHandlerInit( &LmHandlerCallbacks, &node->Params ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        return false;
+    }
+    node->Stack.LmHandlerPackageRegister( PACKAGE_ID_COMPLIANCE, &LmhpComplianceParams );
+    CurrentNode = NULL;
+    return true;
+}
+
+static double FleetCpuTime( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool FleetRun( uint32_t nodeCount, TimerTime_t duration )
+{
+    double cpuStart = FleetCpuTime( );
+    uint32_t joined = 0;
+    uint64_t joinTimeTotal = 0;
+    TimerTime_t joinTimeMax = 0;
+    uint32_t joinAttempts = 0;
+    bool ok = true;
+
+    NodeCount = nodeCount;
+    Nodes = calloc( nodeCount, sizeof( FleetNode_t ) );
+    Devices = calloc( nodeCount, sizeof( FleetDevice_t ) );
+    Frames = calloc( nodeCount, sizeof( FleetFrame_t ) * 2 );
+    FrameCount = 0;
+    Now = 0;
+    memset( &Stats, 0, sizeof( Stats ) );
+    if( ( Nodes == NULL ) || ( Devices == NULL ) || ( Frames == NULL ) )
+    {
+        return false;
+    }
+
+    for( uint32_t i = 0; ( i < nodeCount ) && ( ok == true ); i++ )
+    {
+        ok = FleetNodeInit( &Nodes[i], i );
+    }
+
+    while( ok == true )
+    {
+        TimerTime_t next = FleetChannelGetNextEnd( );
+
+        for( uint32_t i = 0; i < nodeCount; i++ )
+        {
+            TimerTime_t deadline = Nodes[i].Stack.HostTimerGetNextDeadline( );
+
+            next = ( deadline < next ) ? deadline : next;
+            next = ( Nodes[i].NextAction < next ) ? Nodes[i].NextAction : next;
+        }
+        if( ( next == FLEET_TIME_NEVER ) || ( next > duration ) )
+        {
+            break;
+        }
+        Now = next;
+
+        FleetChannelProcess( );
+        for( uint32_t i = 0; i < nodeCount; i++ )
+        {
+            if( ( Nodes[i].Stack.HostTimerGetNextDeadline( ) <= Now ) || ( Nodes[i].NextAction <= Now ) )
+            {
+                FleetNodeRun( &Nodes[i] );
+            }
+        }
+    }
+
+    for( uint32_t i = 0; i < nodeCount; i++ )
+    {
+        joinAttempts += Nodes[i].JoinAttempts;
+        if( Nodes[i].JoinTime != FLEET_TIME_NEVER )
+        {
+            joined++;
+            joinTimeTotal += Nodes[i].JoinTime;
+            joinTimeMax = ( Nodes[i].JoinTime > joinTimeMax ) ? Nodes[i].JoinTime : joinTimeMax;
+        }
+    }
+
+    if( ok == true )
+    {
+        printf( "%6u %8u %8u %7.1f%% %9u %10.2f %7u/%-6u %9.1f %9.1f %7u %9.2f\n",
+                nodeCount, Stats.Frames, Stats.Delivered,
+                ( Stats.Frames != 0 ) ? 100.0 * Stats.Collisions / Stats.Frames : 0.0,
+                Stats.BelowSensitivity,
+                ( double )Stats.DeliveredBytes * 1000 / duration,
+                joined, joinAttempts,
+                ( joined != 0 ) ? joinTimeTotal / 1000.0 / joined : 0.0, joinTimeMax / 1000.0,
+                Stats.AdrCommands, FleetCpuTime( ) - cpuStart );
+    }
+
+    for( uint32_t i = 0; i < nodeCount; i++ )
+    {
+        if( Nodes[i].Stack.Handle != NULL )
+        {
+            dlclose( Nodes[i].Stack.Handle );
+        }
+        if( Nodes[i].Stack.Fd > 0 )
+        {
+            close( Nodes[i].Stack.Fd );
+        }
+    }
+    free( Nodes );
+    free( Devices );
+    free( Frames );
+    return ok;
+}
+
+int main( int argc, char *argv[] )
+{
+    static const uint32_t defaultNodeCounts[] = { 10, 50, 100, 200 };
+    TimerTime_t duration = FLEET_DEFAULT_DURATION * 1000;
+    struct rlimit limit;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "t:p:w:l:s:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 't':
+            duration = strtoul( optarg, NULL, 0 ) * 1000;
+            break;
+        case 'p':
+            Period = strtoul( optarg, NULL, 0 ) * 1000;
+            break;
+        case 'w':
+            PowerOnWindow = strtoul( optarg, NULL, 0 ) * 1000;
+            break;
+        case 'l':
+            LibraryPath = optarg;
+            break;
+        case 's':
+            Seed = strtoul( optarg, NULL, 0 ) | 1;
+            break;
+        default:
+            fprintf( stderr, "usage: %s [-t seconds] [-p period] [-w power-on window] [-l library] [-s seed] [nodes...]\n", argv[0] );
+            return 1;
+        }
+    }
+    if( FleetLoadLibraryImage( ) == false )
+    {
+        return 1;
+    }
+    // One descriptor per node
+    if( getrlimit( RLIMIT_NOFILE, &limit ) == 0 )
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit( RLIMIT_NOFILE, &limit );
+    }
+
+    printf( "simulated %u s, uplink period %u s, power-on window %u s, EU868, duty-cycle on, ADR on\n",
+            duration / 1000, Period / 1000, PowerOnWindow / 1000 );
+    printf( "%6s %8s %8s %8s %9s %10s %14s %9s %9s %7s %9s\n",
+            "nodes", "frames", "deliv", "collide", "below-snr", "app B/s", "joined/tries",
+            "join avg", "join max", "adr", "cpu s" );
+
+    if( optind < argc )
+    {
+        for( int i = optind; i < argc; i++ )
+        {
+            if( FleetRun( strtoul( argv[i], NULL, 0 ), duration ) == false )
+            {
+                return 1;
+            }
+        }
+    }
+    else
+    {
+        for( uint32_t i = 0; i < sizeof( defaultNodeCounts ) / sizeof( defaultNodeCounts[0] ); i++ )
+        {
+            if( FleetRun( defaultNodeCounts[i], duration ) == false )
+            {
+                return 1;
+            }
+        }
+    }
+    free( LibraryImage );
+    return 0;
+}
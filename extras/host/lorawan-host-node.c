@@ -0,0 +1,383 @@
+/*!
+ * \file      lorawan-host-node.c
+ *
+ * \brief     Runs the LoRaWAN stack on the host against the virtual radio
+ *
+ * \remark    An ABP end-device sends uplinks through LmHandlerSend. The
+ *            transmission hook plays the network server: it answers uplinks
+ *            with valid downlinks (MIC and encryption computed with the same
+ *            AES/CMAC code as the stack) which are received in RX1. Some
+ *            downlinks are corrupted to exercise the RxError/RX2 path.
+ *
+ *            The virtual clock runs as fast as the events allow, so the CPU
+ *            time reported per uplink/downlink cycle is the cost of the MAC,
+ *            region and crypto code alone.
+ *
+ *            With a directory the MAC context is stored there as it changes
+ *            and a later run resumes the session from it.
+ *
+ *            Usage: lorawan-host-node [cycles] [nvm directory]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "system/crypto/aes.h"
+#include "system/crypto/cmac.h"
+#include "mac/LoRaMac.h"
+#include "LmHandler.h"
+#include "packages/LmhpCompliance.h"
+#include "boards/mcu/board.h"
+#include "boards/mcu/posix/host-board.h"
+#include "radio/virtual/radio-virtual.h"
+
+#define HOST_NODE_DEFAULT_CYCLES                    1000
+#define HOST_NODE_APP_PORT                          2
+#define HOST_NODE_DEV_ADDR                          0x260B1234
+
+/*!
+ * Every n-th uplink is confirmed
+ */
+#define HOST_NODE_CONFIRMED_PERIOD                  4
+/*!
+ * One unconfirmed uplink out of n gets a downlink with a bad CRC
+ */
+#define HOST_NODE_CRC_ERROR_PERIOD                  8
+
+static uint8_t DevEui[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static uint8_t JoinEui[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+static uint8_t AppKey[] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+static uint8_t NwkSKey[] = { 0x3C, 0x8F, 0x26, 0x27, 0x39, 0xBF, 0xE3, 0xB7, 0xBC, 0x08, 0x26, 0x99, 0x1A, 0xD0, 0x50, 0x4D };
+static uint8_t AppSKey[] = { 0x4D, 0x90, 0x37, 0x38, 0x4A, 0xC0, 0xF4, 0xC8, 0xCD, 0x19, 0x37, 0xAA, 0x2B, 0xE1, 0x61, 0x5E };
+
+static uint8_t AppDataBuffer[242];
+
+/*!
+ * Network server side state
+ */
+static uint32_t FCntDown = 0;
+static uint32_t UplinkCount = 0;
+static bool CycleDone = false;
+
+/*!
+ * Counters checked at the end of the run
+ */
+static uint32_t TxConfirmCount = 0;
+static uint32_t AckCount = 0;
+static uint32_t RxDataCount = 0;
+static uint32_t RxDataErrors = 0;
+static uint32_t NvmStoreCount = 0;
+static uint32_t NvmStoreBytes = 0;
+static bool NvmRestored = false;
+
+static void OnMacProcessNotify( void )
+{
+}
+
+static void OnNvmDataChange( LmHandlerNvmContextStates_t state, uint16_t size )
+{
+    if( state == LORAMAC_HANDLER_NVM_RESTORE )
+    {
+        NvmRestored = true;
+        return;
+    }
+    NvmStoreCount++;
+    NvmStoreBytes += size;
+}
+
+static void OnNetworkParametersChange( CommissioningParams_t *params )
+{
+}
+
+static void OnMacMcpsRequest( LoRaMacStatus_t status, McpsReq_t *mcpsReq, TimerTime_t nextTxDelay )
+{
+}
+
+static void OnMacMlmeRequest( LoRaMacStatus_t status, MlmeReq_t *mlmeReq, TimerTime_t nextTxDelay )
+{
+}
+
+static void OnJoinRequest( LmHandlerJoinParams_t *params )
+{
+}
+
+static void OnTxData( LmHandlerTxParams_t *params )
+{
+    if( params->IsMcpsConfirm == 0 )
+    {
+        return;
+    }
+    TxConfirmCount++;
+    if( params->AckReceived != 0 )
+    {
+        AckCount++;
+    }
+    CycleDone = true;
+}
+
+static void OnRxData( LmHandlerAppData_t *appData, LmHandlerRxParams_t *params )
+{
+    if( ( appData == NULL ) || ( appData->Port != HOST_NODE_APP_PORT ) )
+    {
+        return;
+    }
+    // The downlink payload echoes the low byte of its frame counter
+    if( ( appData->BufferSize != 1 ) || ( appData->Buffer[0] != ( uint8_t )params->DownlinkCounter ) )
+    {
+        RxDataErrors++;
+    }
+    RxDataCount++;
+}
+
+static void OnClassChange( DeviceClass_t deviceClass )
+{
+}
+
+static LmHandlerCallbacks_t LmHandlerCallbacks =
+{
+    .GetBatteryLevel = BoardGetBatteryLevel,
+    .GetTemperature = NULL,
+    .GetRandomSeed = BoardGetRandomSeed,
+    .OnMacProcess = OnMacProcessNotify,
+    .OnNvmDataChange = OnNvmDataChange,
+    .OnNetworkParametersChange = OnNetworkParametersChange,
+    .OnMacMcpsRequest = OnMacMcpsRequest,
+    .OnMacMlmeRequest = OnMacMlmeRequest,
+    .OnJoinRequest = OnJoinRequest,
+    .OnTxData = OnTxData,
+    .OnRxData = OnRxData,
+    .OnClassChange = OnClassChange,
+    .OnBeaconStatusChange = NULL,
+    .OnSysTimeUpdate = NULL,
+};
+
+static LmHandlerParams_t LmHandlerParams =
+{
+    .Region = LORAMAC_REGION_EU868,
+    .AdrEnable = false,
+    .TxDatarate = DR_5,
+    .PublicNetworkEnable = true,
+    .DutyCycleEnabled = false,
+    .DataBufferMaxSize = sizeof( AppDataBuffer ),
+    .DataBuffer = AppDataBuffer,
+    .TxEirp = 16,
+    .joinType = ACTIVATION_TYPE_ABP,
+    .DevEui = DevEui,
+    .JoinEui = JoinEui,
+    .AppKey = AppKey,
+    .DevAddr = HOST_NODE_DEV_ADDR,
+    .AppSKey = AppSKey,
+    .NwkSKey = NwkSKey,
+    .NbTrials = 1,
+    .Class = CLASS_A
+};
+
+static LmhpComplianceParams_t LmhpComplianceParams =
+{
+    .AdrEnabled = false,
+    .DutyCycleEnabled = false,
+    .StopPeripherals = NULL,
+    .StartPeripherals = NULL,
+};
+
+/*!
+ * \brief Builds the LoRaWAN 1.0.x B0 / Ai block for a downlink
+ */
+static void HostNodeBuildBlock( uint8_t *block, uint8_t first, uint32_t devAddr, uint32_t fCnt, uint8_t last )
+{
+    memset( block, 0, 16 );
+    block[0] = first;
+    block[5] = 0x01;  // Downlink
+    block[6] = devAddr & 0xFF;
+    block[7] = ( devAddr >> 8 ) & 0xFF;
+    block[8] = ( devAddr >> 16 ) & 0xFF;
+    block[9] = ( devAddr >> 24 ) & 0xFF;
+    block[10] = fCnt & 0xFF;
+    block[11] = ( fCnt >> 8 ) & 0xFF;
+    block[12] = ( fCnt >> 16 ) & 0xFF;
+    block[13] = ( fCnt >> 24 ) & 0xFF;
+    block[15] = last;
+}
+
+/*!
+ * \brief Builds an unconfirmed data downlink carrying one application byte
+ *
+ * \retval size Frame size
+ */
+static uint8_t HostNodeBuildDownlink( uint8_t *frame, uint32_t devAddr, uint32_t fCnt, bool ack )
+{
+    aes_context aesCtx;
+    AES_CMAC_CTX cmacCtx;
+    uint8_t block[16];
+    uint8_t stream[16];
+    uint8_t mic[16];
+    uint8_t size = 0;
+
+    frame[size++] = 0x60;  // Unconfirmed data down
+    frame[size++] = devAddr & 0xFF;
+    frame[size++] = ( devAddr >> 8 ) & 0xFF;
+    frame[size++] = ( devAddr >> 16 ) & 0xFF;
+    frame[size++] = ( devAddr >> 24 ) & 0xFF;
+    frame[size++] = ( ack == true ) ? 0x20 : 0x00;
+    frame[size++] = fCnt & 0xFF;
+    frame[size++] = ( fCnt >> 8 ) & 0xFF;
+    frame[size++] = HOST_NODE_APP_PORT;
+
+    // FRMPayload, encrypted with the application session key
+    memset( &aesCtx, 0, sizeof( aesCtx ) );
+    aes_set_key( AppSKey, 16, &aesCtx );
+    HostNodeBuildBlock( block, 0x01, devAddr, fCnt, 1 );
+    lora_aes_encrypt( block, stream, &aesCtx );
+    frame[size++] = ( uint8_t )fCnt ^ stream[0];
+
+    HostNodeBuildBlock( block, 0x49, devAddr, fCnt, size );
+    AES_CMAC_Init( &cmacCtx );
+    AES_CMAC_SetKey( &cmacCtx, NwkSKey );
+    AES_CMAC_Update( &cmacCtx, block, 16 );
+    AES_CMAC_Update( &cmacCtx, frame, size );
+    AES_CMAC_Final( mic, &cmacCtx );
+    memcpy( frame + size, mic, 4 );
+
+    return size + 4;
+}
+
+/*!
+ * \brief Network server: answers the uplinks seen on air
+ */
+static void OnRadioTx( const uint8_t *buffer, uint8_t size, uint32_t freq, uint32_t datarate, uint32_t airTime, void *context )
+{
+    uint8_t frame[32];
+    uint8_t mType = buffer[0] >> 5;
+    bool confirmed = ( mType == 0x04 );
+    uint32_t devAddr;
+
+    if( ( size < 12 ) || ( ( mType != 0x02 ) && ( confirmed == false ) ) )
+    {
+        return;
+    }
+    devAddr = ( uint32_t )buffer[1] | ( ( uint32_t )buffer[2] << 8 ) | ( ( uint32_t )buffer[3] << 16 ) | ( ( uint32_t )buffer[4] << 24 );
+    UplinkCount++;
+
+    if( ( confirmed == false ) && ( ( UplinkCount % 2 ) != 0 ) )
+    {
+        // No downlink, both reception windows time out
+        return;
+    }
+    if( ( confirmed == false ) && ( ( UplinkCount % HOST_NODE_CRC_ERROR_PERIOD ) == 2 ) )
+    {
+        VirtualRadioInjectCrcError( );
+    }
+    else
+    {
+        FCntDown++;
+    }
+    VirtualRadioInjectRx( frame, HostNodeBuildDownlink( frame, devAddr, FCntDown, confirmed ), -60, 8 );
+}
+
+static double HostNodeCpuTimeUs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &ts );
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double HostNodeWallTimeUs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main( int argc, char *argv[] )
+{
+    uint32_t cycles = HOST_NODE_DEFAULT_CYCLES;
+    uint8_t payload[16] = { 0 };
+    LmHandlerAppData_t appData = { .Port = HOST_NODE_APP_PORT, .BufferSize = sizeof( payload ), .Buffer = payload };
+    MibRequestConfirm_t mibReq;
+    VirtualRadioStats_t stats;
+    double cpuMin = 1e12, cpuMax = 0, cpuTotal = 0;
+    TimerTime_t start;
+    double initStart;
+    double initUs;
+
+    if( argc > 1 )
+    {
+        cycles = strtoul( argv[1], NULL, 0 );
+    }
+    if( argc > 2 )
+    {
+        HostNvmmSetDirectory( argv[2] );
+    }
+
+    HostBoardInit( 1 );
+    VirtualRadioSetTxHook( OnRadioTx, NULL );
+
+    initStart = HostNodeWallTimeUs( );
+    if( LmHandlerInit( &LmHandlerCallbacks, &LmHandlerParams ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        printf( "LmHandlerInit failed\n" );
+        return 1;
+    }
+    initUs = HostNodeWallTimeUs( ) - initStart;
+    if( NvmRestored == true )
+    {
+        mibReq.Type = MIB_NVM_CTXS;
+        LoRaMacMibGetRequestConfirm( &mibReq );
+        // The network server carries on from the last downlink the node saw
+        FCntDown = mibReq.Param.Contexts->Crypto.FCntList.FCntDown;
+        printf( "nvm             session restored in %.1f us, uplink counter %u, downlink counter %u\n",
+                initUs, mibReq.Param.Contexts->Crypto.FCntList.FCntUp, FCntDown );
+    }
+    LmHandlerPackageRegister( PACKAGE_ID_COMPLIANCE, &LmhpComplianceParams );
+
+    mibReq.Type = MIB_NETWORK_ACTIVATION;
+    mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    start = TimerGetCurrentTime( );
+    for( uint32_t i = 0; i < cycles; i++ )
+    {
+        double cpuStart = HostNodeCpuTimeUs( );
+        double cpu;
+
+        payload[0] = ( uint8_t )i;
+        CycleDone = false;
+        while( LmHandlerSend( &appData, ( ( i % HOST_NODE_CONFIRMED_PERIOD ) == HOST_NODE_CONFIRMED_PERIOD - 1 ) ?
+                              LORAMAC_HANDLER_CONFIRMED_MSG : LORAMAC_HANDLER_UNCONFIRMED_MSG ) != LORAMAC_HANDLER_SUCCESS )
+        {
+            // MAC busy or no channel free yet
+            HostTimerAdvance( 100 );
+            LmHandlerProcess( );
+        }
+        do
+        {
+            LmHandlerProcess( );
+        }while( ( CycleDone == false ) && ( HostTimerRunNext( ) == true ) );
+        LmHandlerProcess( );
+
+        cpu = HostNodeCpuTimeUs( ) - cpuStart;
+        cpuTotal += cpu;
+        cpuMin = ( cpu < cpuMin ) ? cpu : cpuMin;
+        cpuMax = ( cpu > cpuMax ) ? cpu : cpuMax;
+    }
+
+    VirtualRadioGetStats( &stats );
+    printf( "cycles          %u (virtual time %u ms)\n", cycles, TimerGetElapsedTime( start ) );
+    printf( "confirms        %u, acks %u\n", TxConfirmCount, AckCount );
+    printf( "downlinks       %u received, %u payload errors\n", RxDataCount, RxDataErrors );
+    printf( "radio           tx %u, rx %u, rx error %u, rx timeout %u, air time %u ms\n",
+            stats.TxDone, stats.RxDone, stats.RxError, stats.RxTimeout, stats.AirTime );
+    if( argc > 2 )
+    {
+        printf( "nvm             %u stores, %u bytes, full context %u bytes\n",
+                NvmStoreCount, NvmStoreBytes, ( uint32_t )sizeof( LoRaMacNvmData_t ) );
+    }
+    if( cycles != 0 )
+    {
+        printf( "cpu per cycle   avg %.1f us, min %.1f us, max %.1f us\n", cpuTotal / cycles, cpuMin, cpuMax );
+    }
+
+    return ( ( TxConfirmCount == cycles ) && ( RxDataErrors == 0 ) && ( RxDataCount != 0 ) ) ? 0 : 1;
+}
@@ -13,24 +13,95 @@
 #include "radio/radio.h"
 #include "radio/sx126x/sx126x.h"
 #include "boards/sx126x-board.h"
+#include "boards/mcu/board.h"
 #include "mac/LoRaMacCrypto.h"
 #include <Arduino.h>
 #include <driver/rtc_io.h>
 
+#if (LORARADIO_RX_RING_SIZE & (LORARADIO_RX_RING_SIZE - 1)) != 0
+#error "LORARADIO_RX_RING_SIZE must be a power of two"
+#endif
+
 static RadioEvents_t radioEvent;            // radio层驱动回调
-extern SemaphoreHandle_t loraIntSem;
-extern TaskHandle_t loraTaskHandle;
 
 static rxCB *rxEncryptiondone = NULL;
+static rxErrorCB *rxErrorUser = NULL;
+static radioFaultCB *faultUser = NULL;
+
+// Capture ring buffer, written by the LoRa task and read by the application.
+// The indexes only grow, each side updates its own one.
+static sLoRaRxPacket_t rxRing[LORARADIO_RX_RING_SIZE];
+static uint32_t rxRingHead = 0;
+static uint32_t rxRingTail = 0;
+static bool rxCapture = false;
+static sLoRaRxStats_t rxStats;
+
+// Sniff mode windows in 15.625 us steps, 0 when not sniffing
+static uint32_t sniffRxSteps = 0;
+static uint32_t sniffSleepSteps = 0;
+
+/**
+ * @brief Re-enters the sniff mode, the radio leaves it after each frame
+ */
+static void sniffResume(void)
+{
+    if(sniffSleepSteps != 0)
+    {
+        Radio2.SetRxDutyCycle(sniffRxSteps, sniffSleepSteps);
+    }
+}
+
+static void rxRingPush(const uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
+{
+    uint32_t head = rxRingHead;
+    uint32_t tail = __atomic_load_n(&rxRingTail, __ATOMIC_ACQUIRE);
+
+    if((head - tail) >= LORARADIO_RX_RING_SIZE)
+    {
+        BoardDisableIrq();
+        rxStats.overflows++;
+        BoardEnableIrq();
+        return;
+    }
+    sLoRaRxPacket_t *packet = &rxRing[head & (LORARADIO_RX_RING_SIZE - 1)];
+    memcpy(packet->payload, payload, size);
+    packet->size = size;
+    packet->rssi = rssi;
+    packet->snr = snr;
+    // DIO1 interrupt of the RxDone, the LoRa task may take the frame much later
+    packet->timestampUs = Radio2.GetIrqTimeUs();
+    __atomic_store_n(&rxRingHead, head + 1, __ATOMIC_RELEASE);
+    BoardDisableIrq();
+    rxStats.received++;
+    BoardEnableIrq();
+}
 
 uint8_t  isEncryption = false;      // 是否加密传输
-uint8_t  dataKey[16];               // 数据密钥
+static SoftSeAesKey_t dataKey;      // 数据密钥，setEncryptKey 中展开一次
+static bool dataKeyValid = false;   // 密钥展开失败时不收发明文，数据直接丢弃
+static uint8_t txPacket[255];       // 加密发送缓冲，避免每包 malloc
 
 void loraRxCb(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
 {
+    if(isEncryption == true && dataKeyValid == false)
+    {
+        sniffResume();
+        return;
+    }
+    if(rxCapture == true)
+    {
+        if(isEncryption == true)
+        {
+            LoRaMacPayloadEncryptPrekeyed(payload, size, &dataKey, 0xDFDFDFDF, 1, 0X66, payload);
+        }
+        rxRingPush(payload, size, rssi, snr);
+        sniffResume();
+        return;
+    }
     if(rxEncryptiondone == NULL)
     {
         printf("rxEncryptiondone NULL");
+        sniffResume();
         return;
     }
     
@@ -40,83 +111,182 @@ void loraRxCb(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
     } 
     else
     {
-        uint8_t* dataread = (uint8_t*)malloc(sizeof(uint8_t)*size+1);
-        LoRaMacPayloadDecrypt(payload,
+        // Decrypt in place, payload is the radio's static receive buffer
+        LoRaMacPayloadEncryptPrekeyed(payload,
                             size,
-                            dataKey,
+                            &dataKey,
                             0xDFDFDFDF,
                             1,
                             0X66,
-                            dataread);
-        rxEncryptiondone(dataread,size,rssi,snr);
-        free(dataread);
+                            payload);
+        rxEncryptiondone(payload,size,rssi,snr);
     }
+    sniffResume();
 }
 
-DFRobot_LoRaRadio::DFRobot_LoRaRadio(){
+void loraRxErrorCb(void)
+{
+    if(rxCapture == true)
+    {
+        BoardDisableIrq();
+        rxStats.crcErrors++;
+        BoardEnableIrq();
+    }
+    if(rxErrorUser != NULL)
+    {
+        rxErrorUser();
+    }
+    sniffResume();
 }
 
-void loraRadioTask(void *pvParameters)
+void loraFaultCb(RadioFault_t fault)
 {
-    //printf("LoRa Task started\n");
-    while (1)
+    // The radio may have missed the command that started the reception, re-arm it before the user runs
+    if(rxCapture == true)
     {
-        if (xSemaphoreTake(loraIntSem, portMAX_DELAY) == pdTRUE)
-        {
-            // Handle Radio2 events
-            Radio2.BgIrqProcess();
-        }
+        Radio2.Rx(0);
+    }
+    else
+    {
+        sniffResume();
+    }
+    if(faultUser != NULL)
+    {
+        faultUser(fault);
     }
 }
 
-bool lorataskLoad(void)
+DFRobot_LoRaRadio::DFRobot_LoRaRadio(){
+    _config.freq = 0;
+    _config.eirp = 16;
+    _config.SF = 7;
+    _config.BW = BW_125;
+    _config.CR = 1;
+    _config.preambleLen = 8;
+    _config.fixLen = false;
+    _config.payloadLen = 0;
+    _config.crcOn = true;
+}
+
+// Handle Radio2 events, returns the frames waiting in the capture ring buffer
+static uint16_t loraRadioTaskProcess(void)
 {
-    // Create the LoRaWan event semaphore
-    //二值 信号量用于同步
-    loraIntSem = xSemaphoreCreateBinary();
+    Radio2.BgIrqProcess();
+    return (uint16_t)(rxRingHead - __atomic_load_n(&rxRingTail, __ATOMIC_ACQUIRE));
+}
 
-    xSemaphoreGive(loraIntSem);
-    xSemaphoreTake(loraIntSem, 10);
-    //xTaskCreateUniversal(loraRadioTask, "LORA", 8192, NULL, 1, &loraTaskHandle, ARDUINO_RUNNING_CORE);
-    if (!xTaskCreate(loraRadioTask, "LORA", 8192, NULL, 2, &loraTaskHandle))
-    {
-        return false;
-    }
-    return true;
+bool lorataskLoad(void)
+{
+    return LoRaTaskStart(loraRadioTaskProcess);
 }
 
 void DFRobot_LoRaRadio::init()
 {
+    BoardInitMcu();
     SX126xIOInit();
     uint16_t readSyncWord = 0;
     SX126xReadRegisters(REG_LR_SYNCWORD, (uint8_t*)&readSyncWord, 2);
     printf("SyncWord = %04X\n", readSyncWord);
     
     lorataskLoad();  
+    radioEvent.Fault = loraFaultCb;
     Radio2.Init(&radioEvent);
+    // The radio was reset, program everything again on the next change
+    _configured = false;
+    _config.freq = 0;
+}
+
+bool DFRobot_LoRaRadio::setTaskConfig(int8_t core, uint8_t priority, uint32_t stackSize)
+{
+    sLoRaTaskConfig_t config;
+    config.core = core;
+    config.priority = priority;
+    config.stackSize = stackSize;
+    return LoRaTaskSetConfig(&config);
+}
+
+sLoRaTaskStats_t DFRobot_LoRaRadio::getTaskStats()
+{
+    sLoRaTaskStats_t stats;
+    LoRaTaskGetStats(&stats);
+    return stats;
+}
+
+void DFRobot_LoRaRadio::resetTaskStats()
+{
+    LoRaTaskResetStats();
+}
+
+sRadioLatencyStats_t DFRobot_LoRaRadio::getLatencyStats(eRadioLatencyStage_t stage)
+{
+    sRadioLatencyStats_t stats;
+    RadioLatencyGetStats(stage, &stats);
+    return stats;
+}
+
+void DFRobot_LoRaRadio::resetLatencyStats()
+{
+    RadioLatencyReset();
+}
+
+sLoRaRadioConfig_t DFRobot_LoRaRadio::getConfig(void)
+{
+    return _config;
+}
+
+void DFRobot_LoRaRadio::apply(const sLoRaRadioConfig_t &config)
+{
+    bool modemChanged = (_configured == false) ||
+                        (config.SF != _config.SF) || (config.BW != _config.BW) ||
+                        (config.CR != _config.CR) || (config.preambleLen != _config.preambleLen) ||
+                        (config.fixLen != _config.fixLen) || (config.payloadLen != _config.payloadLen) ||
+                        (config.crcOn != _config.crcOn);
+
+    // The radio only gets the commands whose values changed
+    if((config.freq != 0) && (config.freq != _config.freq))
+    {
+        Radio2.SetChannel(config.freq);
+    }
+    if(modemChanged)
+    {
+        Radio2.SetTxConfig(MODEM_LORA, config.eirp, 0, (uint32_t)config.BW, config.SF, config.CR, config.preambleLen,
+                           config.fixLen, config.crcOn, 0, 0, false, 3000);
+        Radio2.SetRxConfig(MODEM_LORA, (uint32_t)config.BW, config.SF, config.CR, 0, config.preambleLen, 0,
+                           config.fixLen, config.payloadLen, config.crcOn, 0, 0, false, true);
+    }
+    else if(config.eirp != _config.eirp)
+    {
+        SX126xSetRfTxPower(config.eirp);
+    }
+
+    uint32_t freq = _config.freq;
+    _config = config;
+    if(config.freq == 0)
+    {
+        _config.freq = freq;
+    }
+    _configured = true;
 }
 
 void DFRobot_LoRaRadio::setBW(eBandwidths_t BW)
 {
-    _bandwidth = BW;
-    Radio2.SetTxConfig(MODEM_LORA, _txeirp, 0,(uint32_t)_bandwidth, _SF, 1, 8, false, true, 0, 0, false, 3000);
-    Radio2.SetRxConfig(MODEM_LORA,(uint32_t)_bandwidth, _SF, 1, 0, 8, 0, false, 0, true, 0, 0, false, true);
-    delay(10);
+    sLoRaRadioConfig_t config = _config;
+    config.BW = BW;
+    apply(config);
 }
 
 void DFRobot_LoRaRadio::setEIRP(int8_t EIRP)
 {
-    _txeirp = EIRP;
-    Radio2.SetTxConfig(MODEM_LORA, _txeirp, 0,(uint32_t)_bandwidth, _SF, 1, 8, false, true, 0, 0, false, 3000);
-    delay(10);
+    sLoRaRadioConfig_t config = _config;
+    config.eirp = EIRP;
+    apply(config);
 }
 
 void DFRobot_LoRaRadio::setSF(uint8_t SF)
 {
-    _SF = SF;
-    Radio2.SetTxConfig(MODEM_LORA, _txeirp, 0,(uint32_t)_bandwidth, _SF, 1, 8, false, true, 0, 0, false, 3000);
-    Radio2.SetRxConfig(MODEM_LORA,(uint32_t)_bandwidth, _SF, 1, 0, 8, 0, false, 0, true, 0, 0, false, true);
-    delay(10);
+    sLoRaRadioConfig_t config = _config;
+    config.SF = SF;
+    apply(config);
 }
 
 void DFRobot_LoRaRadio::setSync(uint16_t sync)
@@ -135,17 +305,29 @@ void DFRobot_LoRaRadio::setSync(uint16_t sync)
 void DFRobot_LoRaRadio::setFreq(uint32_t freq)
 {
     //SX126xSetRfFrequency(freq);
-    Radio2.SetChannel(freq);
+    if(_configured == false)
+    {
+        // Keep the modem untouched until a link parameter is set
+        Radio2.SetChannel(freq);
+        _config.freq = freq;
+        return;
+    }
+    sLoRaRadioConfig_t config = _config;
+    config.freq = freq;
+    apply(config);
 }
 
 void DFRobot_LoRaRadio::sendData(const void *data, uint8_t size)
 {
+    if(isEncryption == true && dataKeyValid == false)
+    {
+       return;
+    }
     if(isEncryption == true)
     {
-       uint8_t* dataSend = (uint8_t*)malloc(sizeof(uint8_t)*size + 1);
-       LoRaMacPayloadEncrypt((uint8_t *)data, size, dataKey, 0xDFDFDFDF, 1, 0X66, dataSend);
-       Radio2.Send((uint8_t*)dataSend, size);
-       free(dataSend);
+       // Send copies the packet into the radio, so txPacket can be reused right away
+       LoRaMacPayloadEncryptPrekeyed((const uint8_t *)data, size, &dataKey, 0xDFDFDFDF, 1, 0X66, txPacket);
+       Radio2.Send(txPacket, size);
     } 
     else 
     {
@@ -169,14 +351,137 @@ void DFRobot_LoRaRadio::setRxCB(rxCB cb)
 
 void DFRobot_LoRaRadio::startRx()
 { 
+    rxCapture = false;
+    sniffSleepSteps = 0;
     Radio2.Rx(0xFFFFFF);
 }
 
 void DFRobot_LoRaRadio::stopRx()
 {
+    rxCapture = false;
+    sniffSleepSteps = 0;
     Radio2.Standby();
 }
 
+void DFRobot_LoRaRadio::startCapture()
+{
+    radioEvent.RxDone  = loraRxCb;
+    radioEvent.RxError = loraRxErrorCb;
+    reInitEvent(&radioEvent);
+    if(_configured == false)
+    {
+        // Program the default link, which also selects continuous reception
+        apply(_config);
+    }
+    rxCapture = true;
+    sniffSleepSteps = 0;
+    // Continuous reception without the driver timeout timer
+    Radio2.Rx(0);
+}
+
+uint32_t DFRobot_LoRaRadio::symbolTimeUs()
+{
+    static const uint32_t bandwidthsHz[] = {125000, 250000, 500000, 62500, 41670, 31250, 20830, 15630, 10420, 7810};
+    uint32_t bw = bandwidthsHz[(_config.BW <= BW_007) ? _config.BW : BW_125];
+    return (uint32_t)(((uint64_t)1000000 << _config.SF) / bw);
+}
+
+uint16_t DFRobot_LoRaRadio::getSniffPreambleLen(uint32_t sleepUs, uint32_t rxUs)
+{
+    uint32_t symbolUs = symbolTimeUs();
+    if(rxUs == 0)
+    {
+        rxUs = symbolUs * LORARADIO_SNIFF_RX_SYMBOLS;
+    }
+    // The preamble has to span a whole sleep period plus a listen window on
+    // each side, so one window always falls inside it. The radio adds 4.25
+    // symbols on the air, which leaves room for the detection itself.
+    uint32_t symbols = (sleepUs + 2 * rxUs + symbolUs - 1) / symbolUs;
+    if(symbols < 8)
+    {
+        symbols = 8;
+    }
+    return (symbols > 0xFFFF) ? 0xFFFF : (uint16_t)symbols;
+}
+
+uint32_t DFRobot_LoRaRadio::timeOnAir(uint8_t size)
+{
+    return Radio2.TimeOnAir(MODEM_LORA, (uint32_t)_config.BW, _config.SF, _config.CR, _config.preambleLen,
+                            _config.fixLen, size, _config.crcOn);
+}
+
+void DFRobot_LoRaRadio::startSniff(uint32_t sleepUs, uint32_t rxUs)
+{
+    if(rxUs == 0)
+    {
+        rxUs = symbolTimeUs() * LORARADIO_SNIFF_RX_SYMBOLS;
+    }
+    if(_configured == false)
+    {
+        apply(_config);
+    }
+    radioEvent.RxDone  = loraRxCb;
+    radioEvent.RxError = loraRxErrorCb;
+    reInitEvent(&radioEvent);
+    // The radio counts both periods in 15.625 us steps, on 24 bits
+    sniffRxSteps = ((uint64_t)rxUs * 64 + 999) / 1000;
+    sniffSleepSteps = ((uint64_t)sleepUs * 64 + 999) / 1000;
+    if(sniffRxSteps > 0xFFFFFF)
+    {
+        sniffRxSteps = 0xFFFFFF;
+    }
+    if(sniffSleepSteps > 0xFFFFFF)
+    {
+        sniffSleepSteps = 0xFFFFFF;
+    }
+    if(sniffSleepSteps == 0)
+    {
+        sniffSleepSteps = 1;
+    }
+    sniffResume();
+}
+
+bool DFRobot_LoRaRadio::readPacket(sLoRaRxPacket_t &packet)
+{
+    uint32_t tail = rxRingTail;
+    uint32_t head = __atomic_load_n(&rxRingHead, __ATOMIC_ACQUIRE);
+
+    if(head == tail)
+    {
+        return false;
+    }
+    const sLoRaRxPacket_t *slot = &rxRing[tail & (LORARADIO_RX_RING_SIZE - 1)];
+    memcpy(packet.payload, slot->payload, slot->size);
+    packet.size = slot->size;
+    packet.rssi = slot->rssi;
+    packet.snr = slot->snr;
+    packet.timestampUs = slot->timestampUs;
+    __atomic_store_n(&rxRingTail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint8_t DFRobot_LoRaRadio::available()
+{
+    return (uint8_t)(__atomic_load_n(&rxRingHead, __ATOMIC_ACQUIRE) - rxRingTail);
+}
+
+sLoRaRxStats_t DFRobot_LoRaRadio::getRxStats()
+{
+    sLoRaRxStats_t stats;
+    // The LoRa task updates the counters, copy them as one set
+    BoardDisableIrq();
+    stats = rxStats;
+    BoardEnableIrq();
+    return stats;
+}
+
+void DFRobot_LoRaRadio::resetRxStats()
+{
+    BoardDisableIrq();
+    memset(&rxStats, 0, sizeof(rxStats));
+    BoardEnableIrq();
+}
+
 void DFRobot_LoRaRadio::setCadCB(cadDoneCB cb)
 {   
     radioEvent.CadDone  = cb;
@@ -185,10 +490,16 @@ void DFRobot_LoRaRadio::setCadCB(cadDoneCB cb)
 
 void DFRobot_LoRaRadio::setRxErrorCB(rxErrorCB cb)
 {
-    radioEvent.RxError  = cb;
+    rxErrorUser = cb;
+    radioEvent.RxError  = loraRxErrorCb;
     reInitEvent(&radioEvent);
 }
 
+void DFRobot_LoRaRadio::setFaultCB(radioFaultCB cb)
+{
+    faultUser = cb;
+}
+
 void DFRobot_LoRaRadio::startCad(RadioLoRaCadSymbols_t cadSymbolNum, uint8_t cadDetPeak, uint8_t cadDetMin)
 {
     // printf("startCad\n");
@@ -214,10 +525,11 @@ void DFRobot_LoRaRadio::deepSleepMs(uint32_t timesleep)
     esp_deep_sleep_start();
 }
 
-void DFRobot_LoRaRadio::setEncryptKey(const uint8_t *key)
+bool DFRobot_LoRaRadio::setEncryptKey(const uint8_t *key)
 {
     isEncryption = true;
-    memcpy(dataKey,key,16);
+    dataKeyValid = SoftSeAesSetKey(&dataKey, key);
+    return dataKeyValid;
 }
 
 void DFRobot_LoRaRadio::dumpRegisters()
@@ -17,9 +17,11 @@
 #include <string.h>
 #include "radio/sx126x/sx126x.h"
 #include "boards/mcu/timer.h"
+#include "boards/lora-task.h"
+#include "radio/radio-latency.h"
 
 #define LCD_OnBoard LoRaWAN::DFRobot_ST7735_80x160_HW_SPI ///< The type of screen on the development board
-#define SPI_MUTEX LoRaWAN::spimutex
+#define SPI_MUTEX LoRaWAN::spimutex ///< Recursive SPI bus mutex, see spi-arbiter.h
 
 
 /**
@@ -43,6 +45,61 @@ typedef enum
       BW_007 = 9,   /**<7k HZ>*/
 } eBandwidths_t;
 
+/**
+ * @struct sLoRaRadioConfig_t
+ * @brief Link parameters of the LoRa radio, programmed together by DFRobot_LoRaRadio::apply.
+ */
+typedef struct
+{
+      uint32_t freq;          /**<Carrier frequency(Hz), 0 leaves the channel unchanged>*/
+      int8_t eirp;            /**<Tx power(dBm)>*/
+      uint8_t SF;             /**<Spreading factor>*/
+      eBandwidths_t BW;       /**<Bandwidth>*/
+      uint8_t CR;             /**<Coding rate, 1: 4/5, 2: 4/6, 3: 4/7, 4: 4/8>*/
+      uint16_t preambleLen;   /**<Preamble length in symbols>*/
+      bool fixLen;            /**<Implicit header, every packet has payloadLen bytes>*/
+      uint8_t payloadLen;     /**<Payload length used with an implicit header>*/
+      bool crcOn;             /**<Payload CRC>*/
+} sLoRaRadioConfig_t;
+
+/**
+ * @brief Number of frames the capture ring buffer holds, must be a power of two.
+ */
+#ifndef LORARADIO_RX_RING_SIZE
+#define LORARADIO_RX_RING_SIZE 8
+#endif
+
+/**
+ * @brief Default listen window of the sniff mode, in symbols.
+ */
+#ifndef LORARADIO_SNIFF_RX_SYMBOLS
+#define LORARADIO_SNIFF_RX_SYMBOLS 4
+#endif
+
+/**
+ * @struct sLoRaRxPacket_t
+ * @brief A frame received in capture mode.
+ */
+typedef struct
+{
+      uint8_t payload[255];   /**<Frame payload, decrypted when an encryption key is set>*/
+      uint8_t size;           /**<Payload size>*/
+      int16_t rssi;           /**<Signal strength(dBm)>*/
+      int8_t snr;             /**<Signal-to-noise ratio(dB)>*/
+      uint64_t timestampUs;   /**<Time the radio signalled the reception(us since boot)>*/
+} sLoRaRxPacket_t;
+
+/**
+ * @struct sLoRaRxStats_t
+ * @brief Counters of the capture mode.
+ */
+typedef struct
+{
+      uint32_t received;      /**<Frames stored in the ring buffer>*/
+      uint32_t overflows;     /**<Frames lost because the ring buffer was full>*/
+      uint32_t crcErrors;     /**<Frames dropped for a bad CRC>*/
+} sLoRaRxStats_t;
+
 /**
  * @fn txCB
  * @brief Callback function for when data transmission is completed.
@@ -72,6 +129,13 @@ typedef void cadDoneCB(bool cadResult);
  */
 typedef void rxErrorCB(void);
 
+/**
+ * @fn radioFaultCB
+ * @brief Callback function for when the radio driver detects a fault.
+ * @param fault The fault, RADIO_FAULT_BUSY_TIMEOUT when the radio kept its BUSY line high too long.
+ */
+typedef void radioFaultCB(RadioFault_t fault);
+
 /**
  * @brief Class for interfacing with a LoRa radio module using the Semtech SX126x chip.
  */
@@ -94,6 +158,47 @@ public:
        */
       void init();
 
+      /**
+       * @fn setTaskConfig
+       * @brief Set where the LoRa task handling the radio events runs, call it before init().
+       * @param core Core the task is pinned to, -1 lets the scheduler choose
+       * @param priority FreeRTOS priority of the task
+       * @param stackSize Stack size of the task(bytes)
+       * @return Whether the setting was successful
+       */
+      bool setTaskConfig(int8_t core, uint8_t priority = LORA_TASK_PRIORITY, uint32_t stackSize = LORA_TASK_STACK_SIZE);
+
+      /**
+       * @fn getTaskStats
+       * @brief Gets the run-time statistics of the LoRa task.
+       * @n The queue depth counts the frames waiting in the capture ring buffer.
+       * @return Statistics, of type sLoRaTaskStats_t
+       */
+      sLoRaTaskStats_t getTaskStats();
+
+      /**
+       * @fn resetTaskStats
+       * @brief Clears the duration and queue depth statistics of the LoRa task.
+       * @return None
+       */
+      void resetTaskStats();
+
+      /**
+       * @fn getLatencyStats
+       * @brief Gets the latency from the radio interrupt to one stage of its handling.
+       * @n Only measured when RADIO_LATENCY_ENABLE is set to 1 in radio/radio-latency.h.
+       * @param stage Stage, of type eRadioLatencyStage_t
+       * @return Count, min, average, 99th percentile and max latency(us), all 0 when not measured
+       */
+      sRadioLatencyStats_t getLatencyStats(eRadioLatencyStage_t stage);
+
+      /**
+       * @fn resetLatencyStats
+       * @brief Clears the latency histograms of all the stages.
+       * @return None
+       */
+      void resetLatencyStats();
+
       /**
        * @fn setEIRP
        * @brief Sets the transmission power of the LoRa radio module.
@@ -126,6 +231,23 @@ public:
        */
       void setFreq(uint32_t freq);
 
+      /**
+       * @fn getConfig
+       * @brief Gets the link parameters currently programmed in the radio.
+       * @n Modify the copy and pass it to apply() to change several parameters at once.
+       * @return Copy of the current parameters
+       */
+      sLoRaRadioConfig_t getConfig(void);
+
+      /**
+       * @fn apply
+       * @brief Programs a set of link parameters in one go.
+       * @n Only the parameters that differ from the current ones are written to the radio.
+       * @param config The new parameters.
+       * @return None
+       */
+      void apply(const sLoRaRadioConfig_t &config);
+
       /**
        * @fn setTxCB
        * @brief Sets the callback function for when data transmission is completed.
@@ -146,6 +268,8 @@ public:
       /**
        * @fn setRxCB
        * @brief Sets the callback function for when data reception is completed.
+       * @n The payload points into the receive buffer of the library and is only valid
+       * @n until the callback returns, copy it to keep it.
        * @param cb The callback function.
        * @return None
        */
@@ -159,6 +283,17 @@ public:
        */
       void setRxErrorCB(rxErrorCB cb);
 
+      /**
+       * @fn setFaultCB
+       * @brief Sets the callback function for when the radio driver detects a fault.
+       * @n The transmission or reception in progress may not complete, the capture and
+       * @n sniff modes are restarted before the callback.
+       * @n Like the other callbacks of this class, it runs in the LoRa task and must not block.
+       * @param cb The callback function.
+       * @return None
+       */
+      void setFaultCB(radioFaultCB cb);
+
       /**
        * @fn startRx
        * @brief Starts receiving data using the LoRa radio module.
@@ -168,11 +303,81 @@ public:
 
       /**
        * @fn stopRx
-       * @brief LoRa radio module stops receiving data.
+       * @brief LoRa radio module stops receiving data, capture and sniff modes included.
        * @return None
        */
       void stopRx();
 
+      /**
+       * @fn startCapture
+       * @brief Starts continuous reception into the capture ring buffer.
+       * @n Received frames are queued with their RSSI, SNR and timestamp instead of
+       * @n being passed to the rx callback. Read them with readPacket().
+       * @return None
+       */
+      void startCapture();
+
+      /**
+       * @fn readPacket
+       * @brief Takes the oldest frame out of the capture ring buffer.
+       * @param packet Receives the frame.
+       * @return Whether a frame was available
+       */
+      bool readPacket(sLoRaRxPacket_t &packet);
+
+      /**
+       * @fn available
+       * @brief Gets the number of frames waiting in the capture ring buffer.
+       * @return Number of frames
+       */
+      uint8_t available();
+
+      /**
+       * @fn getRxStats
+       * @brief Gets the counters of the capture mode.
+       * @return Copy of the counters
+       */
+      sLoRaRxStats_t getRxStats();
+
+      /**
+       * @fn resetRxStats
+       * @brief Clears the counters of the capture mode.
+       * @return None
+       */
+      void resetRxStats();
+
+      /**
+       * @fn startSniff
+       * @brief Starts the wake-on-radio sniff mode.
+       * @n The radio listens for a preamble during rxUs, then sleeps for sleepUs, and repeats
+       * @n until a frame is received. Frames are handled as with startRx() or startCapture(),
+       * @n and the sniff mode resumes afterwards. Call startCapture() first to queue them.
+       * @n The senders need a preamble of at least
+       * @n getSniffPreambleLen() symbols, see apply().
+       * @param sleepUs Sleep period between two listen windows(us).
+       * @param rxUs Listen window(us), 0 selects LORARADIO_SNIFF_RX_SYMBOLS symbols.
+       * @return None
+       */
+      void startSniff(uint32_t sleepUs, uint32_t rxUs = 0);
+
+      /**
+       * @fn getSniffPreambleLen
+       * @brief Computes the preamble a sender needs to be detected by a sniffing receiver.
+       * @n Uses the current spreading factor and bandwidth.
+       * @param sleepUs Sleep period of the receiver(us).
+       * @param rxUs Listen window of the receiver(us), 0 selects LORARADIO_SNIFF_RX_SYMBOLS symbols.
+       * @return Preamble length in symbols
+       */
+      uint16_t getSniffPreambleLen(uint32_t sleepUs, uint32_t rxUs = 0);
+
+      /**
+       * @fn timeOnAir
+       * @brief Computes how long a frame stays on the air with the current parameters.
+       * @param size Payload size of the frame(byte).
+       * @return Time on air(ms)
+       */
+      uint32_t timeOnAir(uint8_t size);
+
       /**
        * @fn setCadCB
        * @brief Sets the callback function for when channel activity detection is completed.
@@ -202,10 +407,11 @@ public:
       /**
        * @fn setEncryptKey
        * @brief Set the encryption key for the radio.
+       * @n If the key cannot be set up, nothing is sent or received until a valid key is set.
        * @param key Pointer to the encryption key (unsigned 8-bit integer array).
-       * @return None
+       * @return Whether the key was set up
        */
-      void setEncryptKey(const uint8_t *key);
+      bool setEncryptKey(const uint8_t *key);
 
       /**
        * @fn dumpRegisters
@@ -223,9 +429,14 @@ public:
       void setSync(uint16_t sync);
 
       private:
-      eBandwidths_t _bandwidth = BW_125; /**< The bandwidth of the LoRa radio module. */
-      uint8_t _txeirp = 16;
-      uint8_t _SF = 7;
+      sLoRaRadioConfig_t _config;   /**< Parameters programmed in the radio. */
+      bool _configured = false;     /**< The modem and power have been programmed once. */
+
+      /**
+       * @fn symbolTimeUs
+       * @brief Duration of one LoRa symbol with the current link parameters(us).
+       */
+      uint32_t symbolTimeUs();
       
       protected:
      };
@@ -17,6 +17,7 @@
 #include <rom/rtc.h>
 #include <driver/rtc_io.h>
 #include "apps/LoRaMac/common/LmHandler/LmHandler.h"
+#include "apps/LoRaMac/common/NvmDataMgmt.h"
 #include "mac/secure-element.h"
 
 // 信号量
@@ -24,12 +25,16 @@ SemaphoreHandle_t loraIntSem = NULL;
 SemaphoreHandle_t loraStateSem = NULL;
 
 // lora任务接口
-TaskHandle_t loraTaskHandle;
+TaskHandle_t loraTaskHandle = NULL;
 
 // 定义回调函数变量
-static joinCallback loraJoinCb = NULL;
-static rxCB rxCb = NULL;
-static txCB txCb = NULL;
+// 不带context的回调以函数指针作为context，经由下面的转接函数调用
+static joinCtxCallback loraJoinCb = NULL;
+static void *loraJoinCtx = NULL;
+static rxCtxCB rxCb = NULL;
+static void *rxCbCtx = NULL;
+static txCtxCB txCb = NULL;
+static void *txCbCtx = NULL;
 
 // 频道掩码相关变量，存放到非易失RTC缓存
 RTC_DATA_ATTR uint16_t ChannelsMask[6];
@@ -58,11 +63,204 @@ static void OnJoinRequest( LmHandlerJoinParams_t* params );
 static void OnTxData( LmHandlerTxParams_t* params );
 static void OnRxData( LmHandlerAppData_t* appData, LmHandlerRxParams_t* params );
 static void OnClassChange( DeviceClass_t deviceClass );
+static void OnRadioFault( RadioFault_t fault );
 
 static void startDeepSleep( void );
+static void uplinkQueueProcess( void );
+static void msgProcess( void );
 
 static uint8_t AppDataBuffer[256];                  // 数据包Buffer
 
+// 上行队列：记录按 [长度][数据] 连续存放，队首的若干条记录就是一帧的FRMPayload
+static uint8_t uplinkQueue[LORAWAN_UPLINK_QUEUE_SIZE];
+static uint16_t uplinkQueueLen = 0;                 // 已用字节数
+static uint16_t uplinkQueueRecords = 0;
+static uint32_t uplinkQueueDropped = 0;
+static uint8_t uplinkQueuePort = 2;
+static bool uplinkQueueConfirmed = false;
+static uint32_t uplinkQueueMaxAge = 0;              // ms，0表示只在满帧时发送
+static volatile bool uplinkQueueFlush = false;
+static SemaphoreHandle_t uplinkQueueMutex = NULL;
+static TimerEvent_t uplinkQueueTimer;
+
+// sendAsync消息表：消息发送完成前一直占用槽位，结果可用句柄查询
+typedef struct {
+    uint32_t handle;                // 0表示槽位从未使用
+    eLoRaWANMsgStatus_t status;
+    uint8_t port;
+    bool confirmed;
+    uint8_t size;
+    TimerTime_t queuedAt;
+    uint32_t timeout;               // ms，0表示不过期
+    uint8_t data[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+} sLoRaWANMsg_t;
+
+static sLoRaWANMsg_t msgSlots[LORAWAN_MSG_SLOTS];
+static uint32_t msgNextHandle = 1;
+static int8_t msgInFlight = -1;                     // 已交给MAC、等待McpsConfirm的槽位
+static msgCB msgCb = NULL;
+static void *msgCbContext = NULL;
+static faultCB faultCb = NULL;
+static void *faultCbContext = NULL;
+static SemaphoreHandle_t msgMutex = NULL;
+static TimerEvent_t msgTimer;
+
+// getNextTxDelay请求：信道选择会临时改写MAC的频段状态，查询交给LoRa任务执行
+static SemaphoreHandle_t txDelayMutex = NULL;
+static SemaphoreHandle_t txDelayDone = NULL;
+static volatile bool txDelayRequested = false;
+static uint8_t txDelaySize = 0;
+static TimerTime_t txDelayResult = TIMERTIME_T_MAX;
+
+#if (LORAWAN_EVENT_QUEUE_SIZE & (LORAWAN_EVENT_QUEUE_SIZE - 1)) != 0
+#error "LORAWAN_EVENT_QUEUE_SIZE must be a power of two"
+#endif
+
+// 用户回调事件：LoRa任务是唯一的生产者，事件任务（或应用调用processEvents）是唯一的消费者
+enum {
+    LORAWAN_EVENT_JOIN,
+    LORAWAN_EVENT_TX,
+    LORAWAN_EVENT_RX,
+    LORAWAN_EVENT_MSG,
+    LORAWAN_EVENT_FAULT,
+};
+
+typedef struct {
+    uint8_t type;
+    union {
+        struct { bool isOk; int16_t rssi; int8_t snr; } join;
+        struct { bool isconfirm; int8_t datarate; int8_t txeirp; uint8_t channel; } tx;
+        struct {
+            uint16_t size; uint8_t port; int16_t rssi; int8_t snr; bool ackReceived;
+            uint16_t uplinkCounter; uint16_t downlinkCounter;
+            uint8_t buffer[LORAWAN_APP_DATA_BUFFER_MAX_SIZE + 1];   // 多一个字节放结束符
+        } rx;
+        struct { uint32_t handle; eLoRaWANMsgStatus_t status; } msg;
+        struct { RadioFault_t fault; } fault;
+    };
+} sLoRaWANEvent_t;
+
+static sLoRaWANEvent_t eventRing[LORAWAN_EVENT_QUEUE_SIZE];
+static uint32_t eventRingHead = 0;
+static uint32_t eventRingTail = 0;
+static uint32_t eventDropped = 0;
+static SemaphoreHandle_t eventSem = NULL;
+TaskHandle_t loraEventTaskHandle = NULL;
+
+// 取一个空槽位填写事件，队列满时返回NULL并计数
+static sLoRaWANEvent_t *eventAlloc(uint8_t type)
+{
+    // 没有注册对应回调的事件不入队
+    if ((type == LORAWAN_EVENT_JOIN && loraJoinCb == NULL) || (type == LORAWAN_EVENT_TX && txCb == NULL) ||
+        (type == LORAWAN_EVENT_RX && rxCb == NULL) || (type == LORAWAN_EVENT_MSG && msgCb == NULL) ||
+        (type == LORAWAN_EVENT_FAULT && faultCb == NULL)) {
+        return NULL;
+    }
+    uint32_t head = eventRingHead;
+    uint32_t tail = __atomic_load_n(&eventRingTail, __ATOMIC_ACQUIRE);
+    if (head - tail >= LORAWAN_EVENT_QUEUE_SIZE) {
+        eventDropped++;
+        return NULL;
+    }
+    sLoRaWANEvent_t *event = &eventRing[head & (LORAWAN_EVENT_QUEUE_SIZE - 1)];
+    event->type = type;
+    return event;
+}
+
+// 发布eventAlloc填好的事件
+static void eventCommit(void)
+{
+    __atomic_store_n(&eventRingHead, eventRingHead + 1, __ATOMIC_RELEASE);
+    if (eventSem != NULL) {
+        xSemaphoreGive(eventSem);
+    }
+}
+
+static void eventPostMsg(uint32_t handle, eLoRaWANMsgStatus_t status)
+{
+    sLoRaWANEvent_t *event = eventAlloc(LORAWAN_EVENT_MSG);
+    if (event != NULL) {
+        event->msg.handle = handle;
+        event->msg.status = status;
+        eventCommit();
+    }
+}
+
+static void eventPostJoin(bool isOk, int16_t rssi, int8_t snr)
+{
+    sLoRaWANEvent_t *event = eventAlloc(LORAWAN_EVENT_JOIN);
+    if (event != NULL) {
+        event->join.isOk = isOk;
+        event->join.rssi = rssi;
+        event->join.snr = snr;
+        eventCommit();
+    }
+}
+
+static void joinPlainCb(void *context, bool isOk, int16_t rssi, int8_t snr)
+{
+    ((joinCallback)context)(isOk, rssi, snr);
+}
+
+static void rxPlainCb(void *context, void *buffer, uint16_t size, uint8_t port, int16_t rssi, int8_t snr, bool ackReceived, uint16_t uplinkCounter, uint16_t downlinkCounter)
+{
+    ((rxCB)context)(buffer, size, port, rssi, snr, ackReceived, uplinkCounter, downlinkCounter);
+}
+
+static void txPlainCb(void *context, bool isconfirm, int8_t datarate, int8_t TxEirp, uint8_t Channel)
+{
+    ((txCB)context)(isconfirm, datarate, TxEirp, Channel);
+}
+
+// 依次调用已排队事件的用户回调，回调返回后才释放槽位，rx数据在回调期间有效
+static uint16_t eventDispatch(uint32_t timeoutMs)
+{
+    uint16_t handled = 0;
+
+    if (eventSem == NULL) {
+        return 0;
+    }
+    if (eventRingTail == __atomic_load_n(&eventRingHead, __ATOMIC_ACQUIRE) && timeoutMs != 0) {
+        xSemaphoreTake(eventSem, (timeoutMs == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs));
+    }
+    while (eventRingTail != __atomic_load_n(&eventRingHead, __ATOMIC_ACQUIRE)) {
+        sLoRaWANEvent_t *event = &eventRing[eventRingTail & (LORAWAN_EVENT_QUEUE_SIZE - 1)];
+        switch (event->type) {
+        case LORAWAN_EVENT_JOIN:
+            if (loraJoinCb != NULL) {
+                loraJoinCb(loraJoinCtx, event->join.isOk, event->join.rssi, event->join.snr);
+            }
+            break;
+        case LORAWAN_EVENT_TX:
+            if (txCb != NULL) {
+                txCb(txCbCtx, event->tx.isconfirm, event->tx.datarate, event->tx.txeirp, event->tx.channel);
+            }
+            break;
+        case LORAWAN_EVENT_RX:
+            if (rxCb != NULL) {
+                rxCb(rxCbCtx, event->rx.buffer, event->rx.size, event->rx.port, event->rx.rssi, event->rx.snr,
+                     event->rx.ackReceived, event->rx.uplinkCounter, event->rx.downlinkCounter);
+            }
+            break;
+        case LORAWAN_EVENT_MSG:
+            if (msgCb != NULL) {
+                msgCb(event->msg.handle, event->msg.status, msgCbContext);
+            }
+            break;
+        case LORAWAN_EVENT_FAULT:
+            if (faultCb != NULL) {
+                faultCb(event->fault.fault, faultCbContext);
+            }
+            break;
+        default:
+            break;
+        }
+        __atomic_store_n(&eventRingTail, eventRingTail + 1, __ATOMIC_RELEASE);
+        handled++;
+    }
+    return handled;
+}
+
 static LmHandlerCallbacks_t LmHandlerCallbacks = 
 {
     .GetBatteryLevel = BoardGetBatteryLevel,
@@ -79,6 +277,7 @@ static LmHandlerCallbacks_t LmHandlerCallbacks =
     .OnClassChange = OnClassChange,
     .OnBeaconStatusChange = NULL,
     .OnSysTimeUpdate = NULL,
+    .OnRadioFault = OnRadioFault,
 };
 
 static uint8_t DevEui_Default[] = LORAWAN_DEVICE_EUI;
@@ -143,9 +342,10 @@ static void OnMacMlmeRequest( LoRaMacStatus_t status, MlmeReq_t *mlmeReq, TimerT
         if( status != LORAMAC_STATUS_OK )
         {
             printf("\n\n-----------OTAA Send JOIN Req FAIL!------------\n\n");
+            // 在调用join()的任务中执行，直接回调
             if (loraJoinCb != NULL) 
             { 
-                loraJoinCb(false, 0, 0);                               
+                loraJoinCb(loraJoinCtx, false, 0, 0);                               
             }
         }
     }
@@ -169,17 +369,13 @@ static void OnJoinRequest( LmHandlerJoinParams_t* params )
         if( params->Status == LORAMAC_HANDLER_SUCCESS )
         {
             printf("\n\n-----------OTAA SUCCESS!----------\n\n");
-            if (loraJoinCb != NULL) { loraJoinCb(true, rssi, snr); }
+            eventPostJoin(true, rssi, snr);
 
         }
         else                    
         {
             printf("\n\n-----------OTAA JOIN FAIL!------------\n\n");
-            if (loraJoinCb != NULL) 
-            { 
-                
-                loraJoinCb(false, rssi, snr);    
-            }
+            eventPostJoin(false, rssi, snr);
 
         }
 
@@ -187,9 +383,7 @@ static void OnJoinRequest( LmHandlerJoinParams_t* params )
     else   // ABP入网通知
     {
         printf("\n\n-----------ABP SUCCESS!------------\n\n");
-        if (loraJoinCb != NULL) {
-            loraJoinCb(true, rssi, snr); 
-        }
+        eventPostJoin(true, rssi, snr);
 
     }
 
@@ -198,7 +392,20 @@ static void OnJoinRequest( LmHandlerJoinParams_t* params )
 // 发送数据回调 可以在此处打出发送数据包的TxPower、频道等信息
 static void OnTxData( LmHandlerTxParams_t* params )
 {
-    if(txCb != NULL && params != NULL)
+    if(params != NULL && params->IsMcpsConfirm && msgInFlight >= 0)
+    {
+        xSemaphoreTake(msgMutex, portMAX_DELAY);
+        sLoRaWANMsg_t *msg = &msgSlots[msgInFlight];
+        if(msg->confirmed) {
+            msg->status = params->AckReceived ? LORAWAN_MSG_ACKED : LORAWAN_MSG_FAILED;
+        } else {
+            msg->status = (params->Status == LORAMAC_EVENT_INFO_STATUS_OK) ? LORAWAN_MSG_SENT : LORAWAN_MSG_FAILED;
+        }
+        msgInFlight = -1;
+        eventPostMsg(msg->handle, msg->status);
+        xSemaphoreGive(msgMutex);
+    }
+    if(params != NULL)
     {
         uint8_t txeirp = 0;
 #ifdef REGION_EU868
@@ -207,31 +414,55 @@ static void OnTxData( LmHandlerTxParams_t* params )
 #ifdef REGION_US915
         txeirp = txpowerEirpUS915[((params->TxPower < 4)?4:params->TxPower) - 4][1];
 #endif
-        txCb(params->AckReceived, params->Datarate, txeirp, params->Channel);
+        sLoRaWANEvent_t *event = eventAlloc(LORAWAN_EVENT_TX);
+        if (event != NULL) {
+            event->tx.isconfirm = params->AckReceived;
+            event->tx.datarate = params->Datarate;
+            event->tx.txeirp = txeirp;
+            event->tx.channel = params->Channel;
+            eventCommit();
+        }
+    }
+}
+
+// 无线电故障回调，进行中的入网或上行会以错误结束
+static void OnRadioFault( RadioFault_t fault )
+{
+    sLoRaWANEvent_t *event = eventAlloc(LORAWAN_EVENT_FAULT);
+    if (event != NULL) {
+        event->fault.fault = fault;
+        eventCommit();
     }
 }
 
 // 接收数据回调
 static void OnRxData( LmHandlerAppData_t* appData, LmHandlerRxParams_t* params )
 {
-    if (rxCb != NULL)
+    if (appData == NULL)
     {
-        uint16_t uplinkcount = GetUplinkCounter();
-        // uint16_t downlinkcount = GetDownlinkCounter();
-
-        if(appData != NULL)
+        return;
+    }
+    sLoRaWANEvent_t *event = eventAlloc(LORAWAN_EVENT_RX);
+    if (event != NULL)
+    {
+        uint16_t size = appData->BufferSize;
+        if (size > LORAWAN_APP_DATA_BUFFER_MAX_SIZE)
+        {
+            size = LORAWAN_APP_DATA_BUFFER_MAX_SIZE;
+        }
+        if (size != 0)
         {
-            rxCb(
-                appData->Buffer,
-                appData->BufferSize,
-                appData->Port,
-                params->Rssi,
-                params->Snr,
-                params->IsRevACK,
-                uplinkcount,
-                params->DownlinkCounter
-            );
+            memcpy(event->rx.buffer, appData->Buffer, size);
         }
+        event->rx.buffer[size] = 0;
+        event->rx.size = size;
+        event->rx.port = appData->Port;
+        event->rx.rssi = params->Rssi;
+        event->rx.snr = params->Snr;
+        event->rx.ackReceived = params->IsRevACK;
+        event->rx.uplinkCounter = GetUplinkCounter();
+        event->rx.downlinkCounter = params->DownlinkCounter;
+        eventCommit();
     }
 }
 
@@ -242,35 +473,233 @@ static void OnClassChange( DeviceClass_t deviceClass )
 }
 
 
-void loraTask(void *pvParameters)
+// 在LoRa任务中运行：回答应用任务的getNextTxDelay请求
+static void txDelayProcess(void)
+{
+    if (!txDelayRequested) {
+        return;
+    }
+    txDelayResult = TIMERTIME_T_MAX;
+    LoRaMacQueryTxDelay(txDelaySize, &txDelayResult);
+    txDelayRequested = false;
+    xSemaphoreGive(txDelayDone);
+}
+
+// LoRa任务每次被唤醒执行一遍，返回等待用户回调的事件数
+static uint16_t loraTaskProcess(void)
+{
+    // printf("\n--------LmHandlerProcess ---------\n");
+    LmHandlerProcess();
+    txDelayProcess();
+    msgProcess();
+    uplinkQueueProcess();
+    return (uint16_t)(eventRingHead - __atomic_load_n(&eventRingTail, __ATOMIC_ACQUIRE));
+}
+
+#if LORAWAN_EVENT_TASK
+void loraEventTask(void *pvParameters)
 {
-    // printf("LoRa Task started\n");
     while (1)
     {
-        if (xSemaphoreTake(loraIntSem, portMAX_DELAY) == pdTRUE)
-        {   
-            // printf("\n--------LmHandlerProcess ---------\n");
-            LmHandlerProcess();
-        }
+        eventDispatch(portMAX_DELAY);
     }
 }
+#endif
 
 bool taskLoad(void)
 {
-    // Create the LoRaWan event semaphore
-    // 二值 信号量用于同步
-    loraIntSem = xSemaphoreCreateBinary();
-    xSemaphoreGive(loraIntSem);
-    xSemaphoreTake(loraIntSem, 10);
+    if (!LoRaTaskStart(loraTaskProcess))
+    {
+        return false;
+    }
 
-    // xTaskCreateUniversal(loraTask, "LORA", 8192, NULL, 1, &loraTaskHandle, ARDUINO_RUNNING_CORE);
-    if (!xTaskCreate(loraTask, "LORA", 8192, NULL, 2, &loraTaskHandle))
+    // 用户回调事件信号量，事件任务以低于LoRa任务的优先级运行回调
+    eventSem = xSemaphoreCreateBinary();
+#if LORAWAN_EVENT_TASK
+    if (!xTaskCreate(loraEventTask, "LORA_EVT", 4096, NULL, 1, &loraEventTaskHandle))
     {
         return false;
     }
+#endif
     return true;
 }
 
+// 上行队列定时器：记录到期或上次发送被拒后，唤醒LoRa任务去发送
+static void OnUplinkQueueTimer( void* context )
+{
+    uplinkQueueFlush = true;
+    xSemaphoreGive(loraIntSem);
+}
+
+// 在LoRa任务中运行：把队首能装进一帧的记录打包发送，发送成功后才移出队列
+static void uplinkQueueProcess( void )
+{
+    LoRaMacTxInfo_t txInfo;
+    McpsReq_t mcpsReq;
+    uint16_t frameLen = 0;
+    uint16_t frameRecords = 0;
+
+    if (uplinkQueueMutex == NULL || uplinkQueueRecords == 0 || LoRaMacIsBusy()) {
+        return;
+    }
+
+    xSemaphoreTake(uplinkQueueMutex, portMAX_DELAY);
+    LoRaMacQueryTxPossible(0, &txInfo);
+    while (frameLen < uplinkQueueLen &&
+           frameLen + 1 + uplinkQueue[frameLen] <= txInfo.MaxPossibleApplicationDataSize) {
+        frameLen += 1 + uplinkQueue[frameLen];
+        frameRecords++;
+    }
+
+    // 帧未满且没有到期/刷新请求时继续攒数据
+    if (frameLen == uplinkQueueLen && uplinkQueueFlush == false) {
+        xSemaphoreGive(uplinkQueueMutex);
+        return;
+    }
+
+    MibRequestConfirm_t mibReq;
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm(&mibReq);
+
+    if (frameLen == 0) {
+        if (1 + uplinkQueue[0] > txInfo.CurrentPossiblePayloadSize) {
+            // 当前速率下永远发不出去的记录，丢弃
+            uplinkQueueLen -= 1 + uplinkQueue[0];
+            memmove(uplinkQueue, uplinkQueue + 1 + uplinkQueue[0], uplinkQueueLen);
+            uplinkQueueRecords--;
+            uplinkQueueDropped++;
+            xSemaphoreGive(uplinkQueueMutex);
+            xSemaphoreGive(loraIntSem);
+            return;
+        }
+        // 挂起的MAC命令占满了帧，先发空帧把它们送出去，记录留在队列里
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fBuffer = NULL;
+        mcpsReq.Req.Unconfirmed.fBufferSize = 0;
+        mcpsReq.Req.Unconfirmed.Datarate = mibReq.Param.ChannelsDatarate;
+    } else if (uplinkQueueConfirmed) {
+        mcpsReq.Type = MCPS_CONFIRMED;
+        mcpsReq.Req.Confirmed.fPort = uplinkQueuePort;
+        mcpsReq.Req.Confirmed.fBuffer = uplinkQueue;
+        mcpsReq.Req.Confirmed.fBufferSize = frameLen;
+        mcpsReq.Req.Confirmed.NbTrials = LmHandlerParams.NbTrials;
+        mcpsReq.Req.Confirmed.Datarate = mibReq.Param.ChannelsDatarate;
+    } else {
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fPort = uplinkQueuePort;
+        mcpsReq.Req.Unconfirmed.fBuffer = uplinkQueue;
+        mcpsReq.Req.Unconfirmed.fBufferSize = frameLen;
+        mcpsReq.Req.Unconfirmed.Datarate = mibReq.Param.ChannelsDatarate;
+    }
+
+    if (LoRaMacMcpsRequest(&mcpsReq) != LORAMAC_STATUS_OK) {
+        // MAC拒绝（未入网等），稍后再试；忙时由本次传输完成再次唤醒
+        uplinkQueueFlush = true;
+        TimerSetValue(&uplinkQueueTimer, LORAWAN_UPLINK_QUEUE_RETRY_MS);
+        TimerStart(&uplinkQueueTimer);
+    } else if (frameLen != 0) {
+        uplinkQueueLen -= frameLen;
+        memmove(uplinkQueue, uplinkQueue + frameLen, uplinkQueueLen);
+        uplinkQueueRecords -= frameRecords;
+        if (uplinkQueueRecords == 0) {
+            uplinkQueueFlush = false;
+            TimerStop(&uplinkQueueTimer);
+        }
+    }
+    xSemaphoreGive(uplinkQueueMutex);
+}
+
+// sendAsync消息重试定时器
+static void OnMsgTimer( void* context )
+{
+    xSemaphoreGive(loraIntSem);
+}
+
+// 在LoRa任务中运行：处理过期消息，并把最早的待发消息交给MAC
+static void msgProcess( void )
+{
+    uint32_t resolvedHandle[LORAWAN_MSG_SLOTS];
+    eLoRaWANMsgStatus_t resolvedStatus[LORAWAN_MSG_SLOTS];
+    uint8_t resolved = 0;
+    int8_t next = -1;
+
+    if (msgMutex == NULL || msgInFlight >= 0 || LoRaMacIsBusy()) {
+        return;
+    }
+
+    xSemaphoreTake(msgMutex, portMAX_DELAY);
+    for (int8_t i = 0; i < LORAWAN_MSG_SLOTS; i++) {
+        sLoRaWANMsg_t *msg = &msgSlots[i];
+        if (msg->status != LORAWAN_MSG_PENDING) {
+            continue;
+        }
+        if (msg->timeout != 0 && TimerGetElapsedTime(msg->queuedAt) >= msg->timeout) {
+            msg->status = LORAWAN_MSG_EXPIRED;
+            resolvedHandle[resolved] = msg->handle;
+            resolvedStatus[resolved++] = msg->status;
+        } else if (next < 0 || msg->handle < msgSlots[next].handle) {
+            next = i;
+        }
+    }
+
+    if (next >= 0) {
+        sLoRaWANMsg_t *msg = &msgSlots[next];
+        LoRaMacTxInfo_t txInfo;
+        McpsReq_t mcpsReq;
+        MibRequestConfirm_t mibReq;
+        mibReq.Type = MIB_CHANNELS_DATARATE;
+        LoRaMacMibGetRequestConfirm(&mibReq);
+
+        if (LoRaMacQueryTxPossible(msg->size, &txInfo) != LORAMAC_STATUS_OK) {
+            if (msg->size > txInfo.CurrentPossiblePayloadSize) {
+                // 当前速率下装不下，不再重试，接着处理下一条
+                msg->status = LORAWAN_MSG_FAILED;
+                resolvedHandle[resolved] = msg->handle;
+                resolvedStatus[resolved++] = msg->status;
+                xSemaphoreGive(loraIntSem);
+            } else {
+                // 挂起的MAC命令占了位置，先发空帧送出它们，消息保持待发
+                mcpsReq.Type = MCPS_UNCONFIRMED;
+                mcpsReq.Req.Unconfirmed.fBuffer = NULL;
+                mcpsReq.Req.Unconfirmed.fBufferSize = 0;
+                mcpsReq.Req.Unconfirmed.Datarate = mibReq.Param.ChannelsDatarate;
+                if (LoRaMacMcpsRequest(&mcpsReq) != LORAMAC_STATUS_OK) {
+                    TimerSetValue(&msgTimer, LORAWAN_UPLINK_QUEUE_RETRY_MS);
+                    TimerStart(&msgTimer);
+                }
+            }
+        } else {
+            if (msg->confirmed) {
+                mcpsReq.Type = MCPS_CONFIRMED;
+                mcpsReq.Req.Confirmed.fPort = msg->port;
+                mcpsReq.Req.Confirmed.fBuffer = msg->data;
+                mcpsReq.Req.Confirmed.fBufferSize = msg->size;
+                mcpsReq.Req.Confirmed.NbTrials = LmHandlerParams.NbTrials;
+                mcpsReq.Req.Confirmed.Datarate = mibReq.Param.ChannelsDatarate;
+            } else {
+                mcpsReq.Type = MCPS_UNCONFIRMED;
+                mcpsReq.Req.Unconfirmed.fPort = msg->port;
+                mcpsReq.Req.Unconfirmed.fBuffer = msg->data;
+                mcpsReq.Req.Unconfirmed.fBufferSize = msg->size;
+                mcpsReq.Req.Unconfirmed.Datarate = mibReq.Param.ChannelsDatarate;
+            }
+            if (LoRaMacMcpsRequest(&mcpsReq) == LORAMAC_STATUS_OK) {
+                msg->status = LORAWAN_MSG_SENDING;
+                msgInFlight = next;
+            } else {
+                // 未入网等情况，稍后再试
+                TimerSetValue(&msgTimer, LORAWAN_UPLINK_QUEUE_RETRY_MS);
+                TimerStart(&msgTimer);
+            }
+        }
+    }
+    xSemaphoreGive(msgMutex);
+
+    for (uint8_t i = 0; i < resolved; i++) {
+        eventPostMsg(resolvedHandle[i], resolvedStatus[i]);
+    }
+}
+
 static void startDeepSleep( void )
 {
     SX126xIOInit();    // 预防用户没有初始化
@@ -305,6 +734,9 @@ LoRaWAN_Node::LoRaWAN_Node(const uint32_t devAddr, const uint8_t *nwkSKey, const
 
 bool LoRaWAN_Node::init(int8_t dataRate, int8_t txEirp, bool adr, bool dutyCycle)
 {
+    // RTC alarm of the timers, before the stack starts any
+    BoardInitMcu();
+
     // sx1262 IO初始化
     SX126xIOInit();
 
@@ -320,6 +752,19 @@ bool LoRaWAN_Node::init(int8_t dataRate, int8_t txEirp, bool adr, bool dutyCycle
     // lora任务创建
     taskLoad();
 
+    if (uplinkQueueMutex == NULL) {
+        uplinkQueueMutex = xSemaphoreCreateMutex();
+        TimerInit(&uplinkQueueTimer, OnUplinkQueueTimer);
+    }
+    if (msgMutex == NULL) {
+        msgMutex = xSemaphoreCreateMutex();
+        TimerInit(&msgTimer, OnMsgTimer);
+    }
+    if (txDelayMutex == NULL) {
+        txDelayDone = xSemaphoreCreateBinary();
+        txDelayMutex = xSemaphoreCreateMutex();
+    }
+
     // printf("\n\n\n--------LoRaWAN_Node::init   isJoined= %d--------------\n\n", isJoined());
 
     // 新 - 协议栈初始化
@@ -365,6 +810,18 @@ bool LoRaWAN_Node::setRxCB(rxCB callback)
 {
     if(callback != NULL)
     {
+        rxCbCtx = (void *)callback;
+        rxCb = rxPlainCb;
+        return true;
+    }
+    return false;
+}
+
+bool LoRaWAN_Node::setRxCB(rxCtxCB callback, void *context)
+{
+    if(callback != NULL)
+    {
+        rxCbCtx = context;
         rxCb = callback;
         return true;
     }
@@ -375,6 +832,18 @@ bool LoRaWAN_Node::setTxCB(txCB callback)
 {
     if(callback != NULL)
     {
+        txCbCtx = (void *)callback;
+        txCb = txPlainCb;
+        return true;
+    }
+    return false;
+}
+
+bool LoRaWAN_Node::setTxCB(txCtxCB callback, void *context)
+{
+    if(callback != NULL)
+    {
+        txCbCtx = context;
         txCb = callback;
         return true;
     }
@@ -397,6 +866,11 @@ bool LoRaWAN_Node::isJoined()
     }
 }
 
+bool LoRaWAN_Node::eraseSession()
+{
+    return NvmDataMgmtFactoryReset();
+}
+
 bool LoRaWAN_Node::setSubBand(uint8_t subBand)
 {
     if(subBand < 1 || subBand > 8){
@@ -432,6 +906,7 @@ bool LoRaWAN_Node::setSubBand(uint8_t subBand)
     RegionCommonChanMaskCopy(nvm->RegionGroup2.ChannelsDefaultMask, subBandChannelMask, maxMask);
     RegionCommonChanMaskCopy(nvm->RegionGroup2.ChannelsMask, subBandChannelMask, maxMask);
     RegionCommonChanMaskCopy(nvm->RegionGroup1.ChannelsMaskRemaining, subBandChannelMask, maxMask);
+    LoRaMacNvmSetDirty(LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 | LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2);
 
     return true;
 
@@ -485,7 +960,7 @@ bool LoRaWAN_Node::sendConfirmedPacket(uint8_t port, void *buffer, uint8_t size)
     
 // printf("-----------LoRaWAN_Node::sendConfirmedPacket 1 step------------\n");
     LoRaMacStatus_t status = LoRaMacMcpsRequest(&mcpsReq);
-    if (status == LORAMAC_STATUS_OK)
+    if (status == LORAMAC_STATUS_OK && mcpsReq.Type == MCPS_CONFIRMED)
     {
         // printf("-----------LoRaMacMcpsRequest LORAMAC_STATUS_OK------------\n");
         return true;
@@ -502,7 +977,8 @@ bool LoRaWAN_Node::sendUnconfirmedPacket(uint8_t port, void *buffer, uint8_t siz
     MibRequestConfirm_t mibReq;
     mibReq.Type = MIB_CHANNELS_DATARATE;
     LoRaMacMibGetRequestConfirm(&mibReq);
-    if (LoRaMacQueryTxPossible(size, &txInfo) != LORAMAC_STATUS_OK)
+    bool flushOnly = (LoRaMacQueryTxPossible(size, &txInfo) != LORAMAC_STATUS_OK);
+    if (flushOnly)
     {
         // Send empty frame in order to flush MAC commands
         mcpsReq.Type = MCPS_UNCONFIRMED;
@@ -519,15 +995,208 @@ bool LoRaWAN_Node::sendUnconfirmedPacket(uint8_t port, void *buffer, uint8_t siz
         mcpsReq.Req.Unconfirmed.Datarate = mibReq.Param.ChannelsDatarate;
     }
 
-    if (LoRaMacMcpsRequest(&mcpsReq) == LORAMAC_STATUS_OK)
+    // 只发出了刷新MAC命令的空帧时，用户数据并未发送
+    if (LoRaMacMcpsRequest(&mcpsReq) == LORAMAC_STATUS_OK && !flushOnly)
     {
+        return true;
+    }
+    return false;
+}
+
+uint32_t LoRaWAN_Node::timeOnAir(uint8_t size)
+{
+    TimerTime_t time = 0;
+    LoRaMacQueryTimeOnAir(size, &time);
+    return time;
+}
+
+uint8_t LoRaWAN_Node::getMaxPayload()
+{
+    LoRaMacTxInfo_t txInfo;
+    LoRaMacQueryTxPossible(0, &txInfo);
+    return txInfo.MaxPossibleApplicationDataSize;
+}
+
+uint32_t LoRaWAN_Node::getNextTxDelay(uint8_t size)
+{
+    TimerTime_t delay = TIMERTIME_T_MAX;
+
+    // 在LoRa任务的回调中直接查询，其他任务等LoRa任务查询完成
+    if (loraTaskHandle != NULL && xTaskGetCurrentTaskHandle() == loraTaskHandle) {
+        LoRaMacQueryTxDelay(size, &delay);
+        return delay;
+    }
+    if (txDelayMutex == NULL) {
+        return delay;
+    }
+    xSemaphoreTake(txDelayMutex, portMAX_DELAY);
+    txDelaySize = size;
+    txDelayRequested = true;
+    xSemaphoreGive(loraIntSem);
+    xSemaphoreTake(txDelayDone, portMAX_DELAY);
+    delay = txDelayResult;
+    xSemaphoreGive(txDelayMutex);
+    return delay;
+}
+
+uint8_t LoRaWAN_Node::getBandCount()
+{
+    uint8_t count = 0;
+    LoRaMacQueryBandCount(&count);
+    return count;
+}
+
+uint32_t LoRaWAN_Node::getAirtimeCredit(uint8_t band)
+{
+    LoRaMacBandBudget_t budget;
+    if (LoRaMacQueryBandBudget(band, &budget) != LORAMAC_STATUS_OK) {
+        return 0;
+    }
+    return budget.AirTime;
+}
+
+bool LoRaWAN_Node::setUplinkQueue(uint8_t port, bool confirmed, uint32_t maxAgeMs)
+{
+    if (port == 0 || port > 223) {
         return false;
     }
+    uplinkQueuePort = port;
+    uplinkQueueConfirmed = confirmed;
+    uplinkQueueMaxAge = maxAgeMs;
     return true;
 }
 
+bool LoRaWAN_Node::queueRecord(const void *record, uint8_t size)
+{
+    if (uplinkQueueMutex == NULL || record == NULL || size == 0 || size == 255) {
+        return false;
+    }
+    // LoRa任务发送时持有队列锁，只等很短时间
+    if (xSemaphoreTake(uplinkQueueMutex, pdMS_TO_TICKS(LORAWAN_UPLINK_QUEUE_LOCK_MS)) != pdTRUE) {
+        return false;
+    }
+    if (uplinkQueueLen + 1 + size > LORAWAN_UPLINK_QUEUE_SIZE) {
+        xSemaphoreGive(uplinkQueueMutex);
+        return false;
+    }
+    if (uplinkQueueRecords == 0 && uplinkQueueMaxAge != 0) {
+        TimerSetValue(&uplinkQueueTimer, uplinkQueueMaxAge);
+        TimerStart(&uplinkQueueTimer);
+    }
+    uplinkQueue[uplinkQueueLen] = size;
+    memcpy(uplinkQueue + uplinkQueueLen + 1, record, size);
+    uplinkQueueLen += 1 + size;
+    uplinkQueueRecords++;
+    xSemaphoreGive(uplinkQueueMutex);
+
+    // LoRa任务比较队列长度和当前最大载荷，攒够一帧时发送
+    xSemaphoreGive(loraIntSem);
+    return true;
+}
+
+bool LoRaWAN_Node::flushQueue()
+{
+    if (uplinkQueueRecords == 0) {
+        return false;
+    }
+    uplinkQueueFlush = true;
+    xSemaphoreGive(loraIntSem);
+    return true;
+}
+
+uint16_t LoRaWAN_Node::getQueuedRecords()
+{
+    return uplinkQueueRecords;
+}
+
+uint32_t LoRaWAN_Node::getDroppedRecords()
+{
+    return uplinkQueueDropped;
+}
+
+uint32_t LoRaWAN_Node::sendAsync(uint8_t port, const void *buffer, uint8_t size, bool confirmed, uint32_t timeoutMs)
+{
+    int8_t slot = -1;
+
+    if (msgMutex == NULL || port == 0 || port > 223 || size > LORAWAN_APP_DATA_BUFFER_MAX_SIZE ||
+        (buffer == NULL && size != 0)) {
+        return 0;
+    }
+    xSemaphoreTake(msgMutex, portMAX_DELAY);
+    // 优先用空槽位，其次复用最早结束的消息
+    for (int8_t i = 0; i < LORAWAN_MSG_SLOTS; i++) {
+        eLoRaWANMsgStatus_t status = msgSlots[i].status;
+        if (status == LORAWAN_MSG_PENDING || status == LORAWAN_MSG_SENDING) {
+            continue;
+        }
+        if (slot < 0 || msgSlots[i].handle < msgSlots[slot].handle) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        xSemaphoreGive(msgMutex);
+        return 0;
+    }
+    sLoRaWANMsg_t *msg = &msgSlots[slot];
+    msg->handle = msgNextHandle++;
+    if (msgNextHandle == 0) {
+        msgNextHandle = 1;
+    }
+    msg->status = LORAWAN_MSG_PENDING;
+    msg->port = port;
+    msg->confirmed = confirmed;
+    msg->size = size;
+    msg->queuedAt = TimerGetCurrentTime();
+    msg->timeout = timeoutMs;
+    memcpy(msg->data, buffer, size);
+    uint32_t handle = msg->handle;
+    xSemaphoreGive(msgMutex);
+
+    xSemaphoreGive(loraIntSem);
+    return handle;
+}
+
+eLoRaWANMsgStatus_t LoRaWAN_Node::getMsgStatus(uint32_t handle)
+{
+    eLoRaWANMsgStatus_t status = LORAWAN_MSG_UNKNOWN;
+
+    if (msgMutex == NULL || handle == 0) {
+        return status;
+    }
+    xSemaphoreTake(msgMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < LORAWAN_MSG_SLOTS; i++) {
+        if (msgSlots[i].handle == handle) {
+            status = msgSlots[i].status;
+            break;
+        }
+    }
+    xSemaphoreGive(msgMutex);
+    return status;
+}
+
+void LoRaWAN_Node::setMsgCB(msgCB callback, void *context)
+{
+    msgCbContext = context;
+    msgCb = callback;
+}
+
+void LoRaWAN_Node::setFaultCB(faultCB callback, void *context)
+{
+    faultCbContext = context;
+    faultCb = callback;
+}
+
 int LoRaWAN_Node::join(joinCallback callback)
 {
+    if (callback != NULL) {
+        return join(joinPlainCb, (void *)callback);
+    }
+    return join((joinCtxCallback)NULL, NULL);
+}
+
+int LoRaWAN_Node::join(joinCtxCallback callback, void *context)
+{
+    loraJoinCtx = context;
     loraJoinCb = callback;
 
     if (isJoined()) {
@@ -540,6 +1209,49 @@ int LoRaWAN_Node::join(joinCallback callback)
     return 1;
 }
 
+bool LoRaWAN_Node::setTaskConfig(int8_t core, uint8_t priority, uint32_t stackSize)
+{
+    sLoRaTaskConfig_t config;
+    config.core = core;
+    config.priority = priority;
+    config.stackSize = stackSize;
+    return LoRaTaskSetConfig(&config);
+}
+
+sLoRaTaskStats_t LoRaWAN_Node::getTaskStats()
+{
+    sLoRaTaskStats_t stats;
+    LoRaTaskGetStats(&stats);
+    return stats;
+}
+
+void LoRaWAN_Node::resetTaskStats()
+{
+    LoRaTaskResetStats();
+}
+
+sRadioLatencyStats_t LoRaWAN_Node::getLatencyStats(eRadioLatencyStage_t stage)
+{
+    sRadioLatencyStats_t stats;
+    RadioLatencyGetStats(stage, &stats);
+    return stats;
+}
+
+void LoRaWAN_Node::resetLatencyStats()
+{
+    RadioLatencyReset();
+}
+
+uint16_t LoRaWAN_Node::processEvents(uint32_t timeoutMs)
+{
+    return eventDispatch(timeoutMs);
+}
+
+uint32_t LoRaWAN_Node::getDroppedEvents()
+{
+    return eventDropped;
+}
+
 uint32_t LoRaWAN_Node::getDevAddr()
 {
     // return LoRaMacGetOTAADevId();
@@ -16,6 +16,8 @@
 #include "boards/mcu/board.h"
 #include "system/utilities.h"
 #include "boards/mcu/timer.h"
+#include "boards/lora-task.h"
+#include "radio/radio-latency.h"
 #include "radio/radio.h"
 #include "mac/LoRaMacTest.h"
 #include "stdint.h"
@@ -24,7 +26,45 @@
 #include "mac/region/Region.h"
 
 #define LCD_OnBoard LoRaWAN::DFRobot_ST7735_80x160_HW_SPI ///< The type of screen on the development board
-#define SPI_MUTEX LoRaWAN::spimutex
+#define SPI_MUTEX LoRaWAN::spimutex ///< Recursive SPI bus mutex, see spi-arbiter.h
+
+#ifndef LORAWAN_UPLINK_QUEUE_SIZE
+#define LORAWAN_UPLINK_QUEUE_SIZE 512      ///< Bytes of the uplink queue, one length byte per record included
+#endif
+
+#ifndef LORAWAN_UPLINK_QUEUE_RETRY_MS
+#define LORAWAN_UPLINK_QUEUE_RETRY_MS 1000 ///< Delay before a flush the MAC refused is tried again(ms)
+#endif
+
+#ifndef LORAWAN_UPLINK_QUEUE_LOCK_MS
+#define LORAWAN_UPLINK_QUEUE_LOCK_MS 10    ///< Longest wait of queueRecord() for the queue the LoRa task is sending from(ms)
+#endif
+
+#ifndef LORAWAN_EVENT_QUEUE_SIZE
+#define LORAWAN_EVENT_QUEUE_SIZE 8         ///< Events waiting for the user callbacks, must be a power of two
+#endif
+
+#ifndef LORAWAN_EVENT_TASK
+#define LORAWAN_EVENT_TASK 1               ///< 1: a library task runs the user callbacks, 0: call processEvents() from the application
+#endif
+
+#ifndef LORAWAN_MSG_SLOTS
+#define LORAWAN_MSG_SLOTS 8                ///< Messages of sendAsync() tracked at the same time
+#endif
+
+/**
+ * @enum eLoRaWANMsgStatus_t
+ * @brief State of a message sent with sendAsync()
+ */
+typedef enum {
+    LORAWAN_MSG_UNKNOWN = 0,  /**<Handle not valid, or its slot was reused by a newer message>*/
+    LORAWAN_MSG_PENDING,      /**<Waiting for the radio>*/
+    LORAWAN_MSG_SENDING,      /**<Handed to the MAC, waiting for the end of the transmission>*/
+    LORAWAN_MSG_SENT,         /**<Unconfirmed message transmitted>*/
+    LORAWAN_MSG_ACKED,        /**<Confirmed message acknowledged by the network>*/
+    LORAWAN_MSG_FAILED,       /**<Transmission failed, or no acknowledgment received>*/
+    LORAWAN_MSG_EXPIRED,      /**<Not transmitted before its timeout>*/
+} eLoRaWANMsgStatus_t;
 
 /**
  * @fn joinCallback
@@ -66,6 +106,44 @@ typedef void (*rxCB)(void *buffer, uint16_t size, uint8_t port, int16_t rssi, in
  */
 typedef void (*txCB)(bool isconfirm, int8_t datarate, int8_t TxEirp, uint8_t Channel);
 
+/**
+ * @fn joinCtxCallback
+ * @brief Same as joinCallback, with the context pointer given to join().
+ */
+typedef void (*joinCtxCallback)(void *context, bool isOk, int16_t rssi, int8_t snr);
+
+/**
+ * @fn rxCtxCB
+ * @brief Same as rxCB, with the context pointer given to setRxCB().
+ */
+typedef void (*rxCtxCB)(void *context, void *buffer, uint16_t size, uint8_t port, int16_t rssi, int8_t snr, bool ackReceived, uint16_t uplinkCounter, uint16_t downlinkCounter);
+
+/**
+ * @fn txCtxCB
+ * @brief Same as txCB, with the context pointer given to setTxCB().
+ */
+typedef void (*txCtxCB)(void *context, bool isconfirm, int8_t datarate, int8_t TxEirp, uint8_t Channel);
+
+/**
+ * @fn msgCB
+ * @brief The callback function when a message sent with sendAsync() is resolved.
+ * @param handle Handle returned by sendAsync()
+ * @param status Final state of the message, LORAWAN_MSG_SENT, LORAWAN_MSG_ACKED, LORAWAN_MSG_FAILED or LORAWAN_MSG_EXPIRED
+ * @param context Pointer given to setMsgCB()
+ * @return None
+ */
+typedef void (*msgCB)(uint32_t handle, eLoRaWANMsgStatus_t status, void *context);
+
+/**
+ * @fn faultCB
+ * @brief The callback function when the radio driver detects a fault.
+ * @details The join or uplink in progress ends with an error: a failed join, LORAWAN_MSG_FAILED for sendAsync().
+ * @param fault The fault, RADIO_FAULT_BUSY_TIMEOUT when the radio kept its BUSY line high too long
+ * @param context Pointer given to setFaultCB()
+ * @return None
+ */
+typedef void (*faultCB)(RadioFault_t fault, void *context);
+
 class LoRaWAN_Node
 {
 
@@ -107,12 +185,64 @@ public:
      *                  with LORAWAN_DUTYCYCLE_OFF being the default.
      * @n LORAWAN_DUTYCYCLE_ON Enable duty cycle transmission limitation
      * @n LORAWAN_DUTYCYCLE_OFF Disable duty cycle transmission limitation
+     * @n A session saved in flash for the same DevEUI, JoinEUI and AppKey (and DevAddr and session
+     * @n keys in ABP mode) is resumed, isJoined() then returns true and join() does not join again.
      * @return Whether the node initialization was successful
      * @retval true Initialization successful
      * @retval false Initialization failed
      */
     bool init(int8_t dataRate, int8_t txEirp, bool adr = false, bool dutyCycle = LORAWAN_DUTYCYCLE_OFF);
 
+    /**
+     * @fn setTaskConfig
+     * @brief Set where the LoRa task runs, call it before init().
+     * @n The LoRa task runs the MAC and the radio interrupt processing. Pin it to the core
+     * @n the application does not use, e.g. core 0 when loop() runs on core 1.
+     * @param core Core the task is pinned to, -1 lets the scheduler choose
+     * @param priority FreeRTOS priority of the task
+     * @param stackSize Stack size of the task(bytes)
+     * @return Whether the setting was successful
+     * @retval false The task already runs, or core or priority is out of range
+     */
+    bool setTaskConfig(int8_t core, uint8_t priority = LORA_TASK_PRIORITY, uint32_t stackSize = LORA_TASK_STACK_SIZE);
+
+    /**
+     * @fn getTaskStats
+     * @brief Get the run-time statistics of the LoRa task.
+     * @n stackFree is the least free stack seen so far, the durations time one MAC processing
+     * @n pass and the queue depth counts the events waiting for the user callbacks.
+     * @param None
+     * @return Statistics, of type sLoRaTaskStats_t
+     */
+    sLoRaTaskStats_t getTaskStats();
+
+    /**
+     * @fn resetTaskStats
+     * @brief Clear the duration and queue depth statistics of the LoRa task.
+     * @param None
+     * @return None
+     */
+    void resetTaskStats();
+
+    /**
+     * @fn getLatencyStats
+     * @brief Get the latency from the radio interrupt to one stage of its handling.
+     * @n Stages: RADIO_LATENCY_TASK_WAKE (LoRa task woken), RADIO_LATENCY_IRQ_STATUS (IRQ status
+     * @n read from the radio), RADIO_LATENCY_EVENT (TxDone/RxDone handed to the MAC).
+     * @n Only measured when RADIO_LATENCY_ENABLE is set to 1 in radio/radio-latency.h.
+     * @param stage Stage, of type eRadioLatencyStage_t
+     * @return Count, min, average, 99th percentile and max latency(us), all 0 when not measured
+     */
+    sRadioLatencyStats_t getLatencyStats(eRadioLatencyStage_t stage);
+
+    /**
+     * @fn resetLatencyStats
+     * @brief Clear the latency histograms of all the stages.
+     * @param None
+     * @return None
+     */
+    void resetLatencyStats();
+
     /**
      * @fn join
      * @brief LoRaWAN node performs the network join operation and sets a user-defined join callback function.
@@ -123,6 +253,15 @@ public:
      */
     int join(joinCallback callback);
 
+    /**
+     * @fn join
+     * @brief Same as join(joinCallback), the callback also receives context.
+     * @param callback User-defined join callback function, of type joinCtxCallback
+     * @param context Pointer passed back to the callback
+     * @return Whether the node actually performed the join operation
+     */
+    int join(joinCtxCallback callback, void *context);
+
     /**
      * @fn isJoined
      * @brief Determine whether the node has joined the LoRaWAN network.
@@ -133,6 +272,16 @@ public:
      */
     bool isJoined();
 
+    /**
+     * @fn eraseSession
+     * @brief Erase the session stored in flash.
+     * @n The session (keys, frame counters, channels) is saved in flash whenever it changes and
+     * @n resumed by init() after a reset or a power loss. Call before init() to join again.
+     * @param None
+     * @return Whether the session was erased
+     */
+    bool eraseSession();
+
     /**
      * @fn getNetID
      * @brief Get the node's current network identifier, used to distinguish between different networks within the same region.
@@ -215,6 +364,15 @@ public:
      */
     bool setRxCB(rxCB callback);
 
+    /**
+     * @fn setRxCB
+     * @brief Same as setRxCB(rxCB), the callback also receives context.
+     * @param callback User-defined callback function, of type rxCtxCB
+     * @param context Pointer passed back to the callback
+     * @return Whether the setting was successful
+     */
+    bool setRxCB(rxCtxCB callback, void *context);
+
     /**
      * @fn setTxCB
      * @brief Set the user-defined callback function for when the node sends data.
@@ -224,6 +382,15 @@ public:
      * @retval false Set failed, please check if callback is NULL
      */
     bool setTxCB(txCB callback);
+
+    /**
+     * @fn setTxCB
+     * @brief Same as setTxCB(txCB), the callback also receives context.
+     * @param callback User-defined callback function, of type txCtxCB
+     * @param context Pointer passed back to the callback
+     * @return Whether the setting was successful
+     */
+    bool setTxCB(txCtxCB callback, void *context);
     
     /**
      * @fn sendConfirmedPacket
@@ -249,6 +416,160 @@ public:
      */
     bool sendUnconfirmedPacket(uint8_t port, void *buffer, uint8_t size);
 
+    /**
+     * @fn timeOnAir
+     * @brief Computes how long an uplink stays on the air at the current data rate.
+     * @n Pending MAC commands sent along with the data are included.
+     * @param size Size of the data to be sent by the node
+     * @return Time on air(ms)
+     */
+    uint32_t timeOnAir(uint8_t size);
+
+    /**
+     * @fn getMaxPayload
+     * @brief Get the largest data size the next uplink can carry at the current data rate.
+     * @n Pending MAC commands sent along with the data are taken into account.
+     * @param None
+     * @return Maximum size of the data(byte)
+     */
+    uint8_t getMaxPayload();
+
+    /**
+     * @fn getNextTxDelay
+     * @brief Get how long the duty-cycle limits hold back an uplink of the given size.
+     * @n Sleep for that long instead of retrying the send.
+     * @n The LoRa task runs the query, the call blocks until it is done.
+     * @param size Size of the data to be sent by the node
+     * @return Time to wait(ms), 0 if the uplink can be sent now, 0xFFFFFFFF if no channel accepts it
+     */
+    uint32_t getNextTxDelay(uint8_t size);
+
+    /**
+     * @fn getBandCount
+     * @brief Get the number of duty-cycle bands of the region.
+     * @param None
+     * @return Number of bands
+     */
+    uint8_t getBandCount();
+
+    /**
+     * @fn getAirtimeCredit
+     * @brief Get the airtime a duty-cycle band still allows right now.
+     * @param band Band index, below getBandCount()
+     * @return Airtime(ms), 0xFFFFFFFF if the duty cycle is off
+     */
+    uint32_t getAirtimeCredit(uint8_t band);
+
+    /**
+     * @fn setUplinkQueue
+     * @brief Configure the uplink queue filled by queueRecord().
+     * @n The queue packs records into frames of up to getMaxPayload() bytes, each record
+     * @n prefixed with its length byte. A frame goes out when it is full, when the oldest
+     * @n record is maxAgeMs old, or on flushQueue().
+     * @param port Node communication port with the gateway
+     * @param confirmed Whether the frames are sent as confirmed packets
+     * @param maxAgeMs Longest time a record waits in the queue(ms), 0 waits for a full frame
+     * @return Whether the configuration is valid
+     * @retval true Set successful
+     * @retval false Set failed
+     */
+    bool setUplinkQueue(uint8_t port, bool confirmed = false, uint32_t maxAgeMs = 0);
+
+    /**
+     * @fn queueRecord
+     * @brief Add a record to the uplink queue.
+     * @n Call it from loop() or a task, not from a TimerEvent_t callback: those share their task with the
+     * @n MAC receive windows. It waits at most LORAWAN_UPLINK_QUEUE_LOCK_MS while the LoRa task sends.
+     * @param record Data of the record
+     * @param size Size of the record, 1 to 254 bytes
+     * @return Whether the record was queued
+     * @retval true Queued
+     * @retval false The queue is full or busy, or the node is not initialized
+     */
+    bool queueRecord(const void *record, uint8_t size);
+
+    /**
+     * @fn flushQueue
+     * @brief Send all queued records now, in as few frames as possible.
+     * @param None
+     * @return Whether records were waiting
+     */
+    bool flushQueue();
+
+    /**
+     * @fn getQueuedRecords
+     * @brief Get the number of records waiting in the uplink queue.
+     * @param None
+     * @return Number of records
+     */
+    uint16_t getQueuedRecords();
+
+    /**
+     * @fn getDroppedRecords
+     * @brief Get the number of records dropped because they were larger than any frame at the current data rate.
+     * @param None
+     * @return Number of records
+     */
+    uint32_t getDroppedRecords();
+
+    /**
+     * @fn sendAsync
+     * @brief Queue a message and return at once, the LoRa task sends it when the radio is free.
+     * @n Can be called from several tasks. Follow the message with getMsgStatus() or setMsgCB().
+     * @param port Node communication port with the gateway
+     * @param buffer Data to be sent by the node, copied before the call returns
+     * @param size Size of the data to be sent by the node
+     * @param confirmed Whether the message is sent as a confirmed packet
+     * @param timeoutMs Time after which a message not yet transmitted expires(ms), 0 never expires
+     * @return Handle of the message, 0 if all LORAWAN_MSG_SLOTS slots are in use or the parameters are invalid
+     */
+    uint32_t sendAsync(uint8_t port, const void *buffer, uint8_t size, bool confirmed = false, uint32_t timeoutMs = 0);
+
+    /**
+     * @fn getMsgStatus
+     * @brief Get the state of a message sent with sendAsync().
+     * @param handle Handle returned by sendAsync()
+     * @return State of the message
+     */
+    eLoRaWANMsgStatus_t getMsgStatus(uint32_t handle);
+
+    /**
+     * @fn setMsgCB
+     * @brief Set the callback function called from the LoRa task when a message sent with sendAsync() is resolved.
+     * @param callback User-defined callback function, of type msgCB, NULL to remove it
+     * @param context Pointer passed back to the callback
+     * @return None
+     */
+    void setMsgCB(msgCB callback, void *context = NULL);
+
+    /**
+     * @fn setFaultCB
+     * @brief Set the callback function called like the other user callbacks when the radio driver detects a fault.
+     * @param callback User-defined callback function, of type faultCB, NULL to remove it
+     * @param context Pointer passed back to the callback
+     * @return None
+     */
+    void setFaultCB(faultCB callback, void *context = NULL);
+
+    /**
+     * @fn processEvents
+     * @brief Run the user callbacks of the events the LoRa task has queued.
+     * @n The LoRa task never calls user code, it queues join, tx, rx and message events
+     * @n instead, so a slow callback cannot delay the MAC. With LORAWAN_EVENT_TASK set to 1
+     * @n a library task calls this method; set it to 0 to call it from one application task.
+     * @param timeoutMs Time to wait for a first event(ms), 0 returns at once
+     * @return Number of events handled
+     */
+    uint16_t processEvents(uint32_t timeoutMs = 0);
+
+    /**
+     * @fn getDroppedEvents
+     * @brief Get the number of events lost because the event queue was full.
+     * @param None
+     * @return Number of events
+     */
+    uint32_t getDroppedEvents();
+
     /**
      * @fn setSubBand
      * @brief Set the frequency band for the US915 regional node.
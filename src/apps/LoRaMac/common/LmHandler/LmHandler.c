@@ -284,6 +284,7 @@ LmHandlerErrorStatus_t LmHandlerInit(LmHandlerCallbacks_t *handlerCallbacks, LmH
     LoRaMacCallbacks.GetTemperatureLevel = LmHandlerCallbacks->GetTemperature;
     LoRaMacCallbacks.NvmDataChange = NvmDataMgmtEvent;
     LoRaMacCallbacks.MacProcessNotify = LmHandlerCallbacks->OnMacProcess;
+    LoRaMacCallbacks.MacRadioFault = LmHandlerCallbacks->OnRadioFault;
 
     IsClassBSwitchPending = false;
 
@@ -364,6 +365,27 @@ LmHandlerErrorStatus_t LmHandlerInit(LmHandlerCallbacks_t *handlerCallbacks, LmH
     mibReq.Param.NwkSEncKey = LmHandlerParams->NwkSKey;
     LoRaMacMibSetRequestConfirm(&mibReq);
 
+    // Cold boot: resume the session kept in non-volatile memory, it must match the identity set above
+    // 冷启动：恢复保存在非易失存储中的会话
+    if (NvmDataMgmtRestore() > 0)
+    {
+        // The radio does not listen yet, enter class C again to open the continuous reception window
+        mibReq.Type = MIB_DEVICE_CLASS;
+        LoRaMacMibGetRequestConfirm(&mibReq);
+        if (mibReq.Param.Class == CLASS_C)
+        {
+            mibReq.Param.Class = CLASS_A;
+            LoRaMacMibSetRequestConfirm(&mibReq);
+            mibReq.Param.Class = CLASS_C;
+            LoRaMacMibSetRequestConfirm(&mibReq);
+        }
+        if (LmHandlerCallbacks->OnNvmDataChange != NULL)
+        {
+            LmHandlerCallbacks->OnNvmDataChange(LORAMAC_HANDLER_NVM_RESTORE, sizeof(LoRaMacNvmData_t));
+        }
+        return LORAMAC_HANDLER_SUCCESS;
+    }
+
     // 速率
     mibReq.Type = MIB_CHANNELS_DATARATE;
     mibReq.Param.ChannelsDatarate = LmHandlerParams->TxDatarate;
@@ -467,7 +489,7 @@ bool LmHandlerIsBusy(void)
 
 void LmHandlerProcess(void)
 {
-    // uint16_t size = 0;
+    uint16_t size = 0;
 
     // Process Radio IRQ
     // if (Radio.IrqProcess != NULL)
@@ -487,12 +509,12 @@ void LmHandlerProcess(void)
     LmHandlerPackagesProcess();
 
     // Store to NVM if required
-    // size = NvmDataMgmtStore();
+    size = NvmDataMgmtStore();
 
-    // if (size > 0)
-    // {
-    //     LmHandlerCallbacks->OnNvmDataChange(LORAMAC_HANDLER_NVM_STORE, size);
-    // }
+    if ((size > 0) && (LmHandlerCallbacks->OnNvmDataChange != NULL))
+    {
+        LmHandlerCallbacks->OnNvmDataChange(LORAMAC_HANDLER_NVM_STORE, size);
+    }
 }
 
 /*!
@@ -245,6 +245,13 @@ typedef struct LmHandlerCallbacks_s
      */
     void ( *OnSysTimeUpdate )( void );
 #endif
+    /*!
+     * Notifies the upper layer that the radio reported a fault, the request  通知上层无线电故障
+     * in progress ends with an error
+     *
+     * \param [IN] fault Radio fault
+     */
+    void ( *OnRadioFault )( RadioFault_t fault );
 }LmHandlerCallbacks_t;
 
 /*!
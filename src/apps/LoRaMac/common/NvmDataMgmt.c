@@ -32,8 +32,12 @@
  */
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include "system/utilities.h"
-// #include "nvmm.h"
+#include "boards/nvmm.h"
+#include "boards/mcu/timer.h"
 #include "mac/LoRaMac.h"
 #include "NvmDataMgmt.h"
 
@@ -45,230 +49,363 @@
 #define CONTEXT_MANAGEMENT_ENABLED         1
 #endif
 
+#if( CONTEXT_MANAGEMENT_ENABLED == 1 )
 
-// static uint16_t NvmNotifyFlags = 0;
+/*!
+ * One NVM record per context group
+ */
+typedef struct sNvmDataMgmtGroup
+{
+    uint16_t NotifyFlag;
+    uint16_t Offset;
+    uint16_t Size;
+    uint16_t Crc32Offset;
+}NvmDataMgmtGroup_t;
+
+#define NVM_DATA_MGMT_GROUP( flag, group )  { flag, offsetof( LoRaMacNvmData_t, group ), \
+                                              sizeof( ( ( LoRaMacNvmData_t* )0 )->group ), \
+                                              offsetof( LoRaMacNvmData_t, group.Crc32 ) }
+
+static const NvmDataMgmtGroup_t NvmDataMgmtGroups[] =
+{
+    NVM_DATA_MGMT_GROUP( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO, Crypto ),
+    NVM_DATA_MGMT_GROUP( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1, MacGroup1 ),
+    NVM_DATA_MGMT_GROUP( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2, MacGroup2 ),
+    NVM_DATA_MGMT_GROUP( LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT, SecureElement ),
+    NVM_DATA_MGMT_GROUP( LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1, RegionGroup1 ),
+    NVM_DATA_MGMT_GROUP( LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2, RegionGroup2 ),
+    NVM_DATA_MGMT_GROUP( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B, ClassB ),
+};
+
+#define NVM_DATA_MGMT_GROUP_NB              ( sizeof( NvmDataMgmtGroups ) / sizeof( NvmDataMgmtGroup_t ) )
+
+/*!
+ * Record of the commit, after the group records
+ */
+#define NVM_DATA_MGMT_COMMIT_RECORD         NVM_DATA_MGMT_GROUP_NB
+
+/*!
+ * Commit record, written after the groups of a store. It holds the CRC of
+ * every group as stored, a group that does not match it was written by a
+ * store that did not complete and the context is not resumed.
+ */
+typedef struct sNvmDataMgmtCommit
+{
+    uint32_t GroupCrc32[NVM_DATA_MGMT_GROUP_NB];
+    uint32_t Crc32;
+}NvmDataMgmtCommit_t;
+
+/*!
+ * Keys identifying the device whatever the activation
+ */
+static const KeyIdentifier_t NvmDataMgmtRootKeys[] = { APP_KEY, NWK_KEY };
+
+/*!
+ * Session keys the application configures in ABP mode
+ */
+static const KeyIdentifier_t NvmDataMgmtAbpKeys[] = { APP_S_KEY, F_NWK_S_INT_KEY, S_NWK_S_INT_KEY, NWK_S_ENC_KEY };
+
+/*!
+ * Groups changed since they were last stored
+ */
+static uint16_t NvmNotifyFlags = 0;
+
+/*!
+ * Commit matching the records in storage
+ */
+static NvmDataMgmtCommit_t NvmCommit;
+
+/*!
+ * Groups were written since the commit record was
+ */
+static bool NvmCommitPending = false;
+
+static LoRaMacNvmData_t* NvmDataMgmtGetContexts( void )
+{
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_NVM_CTXS;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    return mibReq.Param.Contexts;
+}
+
+/*!
+ * \brief Checks the CRC the MAC stored in a group, computed like LoRaMacHandleNvm does
+ */
+static bool NvmDataMgmtCrc32Check( const LoRaMacNvmData_t* nvm, const NvmDataMgmtGroup_t* group )
+{
+    uint32_t crc;
+
+    memcpy1( ( uint8_t* ) &crc, ( const uint8_t* ) nvm + group->Crc32Offset, sizeof( crc ) );
+    return Crc32( ( uint8_t* ) nvm + group->Offset, group->Size - sizeof( uint32_t ) ) == crc;
+}
+
+/*!
+ * \brief Updates the CRC of a group after it was modified
+ */
+static void NvmDataMgmtCrc32Update( LoRaMacNvmData_t* nvm, uint16_t notifyFlag )
+{
+    for( uint8_t i = 0; i < NVM_DATA_MGMT_GROUP_NB; i++ )
+    {
+        const NvmDataMgmtGroup_t* group = &NvmDataMgmtGroups[i];
+
+        if( group->NotifyFlag == notifyFlag )
+        {
+            uint32_t crc = Crc32( ( uint8_t* ) nvm + group->Offset, group->Size - sizeof( uint32_t ) );
+
+            memcpy1( ( uint8_t* ) nvm + group->Crc32Offset, ( uint8_t* ) &crc, sizeof( crc ) );
+        }
+    }
+}
+
+/*!
+ * \brief Compares a key of two contexts
+ */
+static bool NvmDataMgmtKeyMatch( const LoRaMacNvmData_t* stored, const LoRaMacNvmData_t* nvm, KeyIdentifier_t keyId )
+{
+#ifdef SOFT_SE
+    for( uint8_t i = 0; i < NUM_OF_KEYS; i++ )
+    {
+        if( stored->SecureElement.KeyList[i].KeyID == keyId )
+        {
+            return ( nvm->SecureElement.KeyList[i].KeyID == keyId ) &&
+                   ( memcmp( stored->SecureElement.KeyList[i].KeyValue, nvm->SecureElement.KeyList[i].KeyValue,
+                             SE_KEY_SIZE ) == 0 );
+        }
+    }
+    return false;
+#else
+    // The secure element keeps the keys itself
+    return true;
+#endif
+}
+
+/*!
+ * \brief Checks that the stored session belongs to the identity the
+ *        application configured: EUIs and root keys, plus the DevAddr and the
+ *        session keys in ABP mode
+ */
+static bool NvmDataMgmtIdentityMatch( const LoRaMacNvmData_t* stored, const LoRaMacNvmData_t* nvm )
+{
+    if( ( memcmp( stored->SecureElement.DevEui, nvm->SecureElement.DevEui, SE_EUI_SIZE ) != 0 ) ||
+        ( memcmp( stored->SecureElement.JoinEui, nvm->SecureElement.JoinEui, SE_EUI_SIZE ) != 0 ) )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < ( sizeof( NvmDataMgmtRootKeys ) / sizeof( KeyIdentifier_t ) ); i++ )
+    {
+        if( NvmDataMgmtKeyMatch( stored, nvm, NvmDataMgmtRootKeys[i] ) == false )
+        {
+            return false;
+        }
+    }
+    if( stored->MacGroup2.NetworkActivation == ACTIVATION_TYPE_ABP )
+    {
+        if( stored->MacGroup2.DevAddr != nvm->MacGroup2.DevAddr )
+        {
+            return false;
+        }
+        for( uint8_t i = 0; i < ( sizeof( NvmDataMgmtAbpKeys ) / sizeof( KeyIdentifier_t ) ); i++ )
+        {
+            if( NvmDataMgmtKeyMatch( stored, nvm, NvmDataMgmtAbpKeys[i] ) == false )
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Reads the commit record and the groups, and checks that they belong
+ *        to the same store
+ *
+ * \retval true when the whole context was read
+ */
+static bool NvmDataMgmtReadContext( LoRaMacNvmData_t* stored, NvmDataMgmtCommit_t* commit )
+{
+    if( ( NvmmRead( NVM_DATA_MGMT_COMMIT_RECORD, ( uint8_t* ) commit, sizeof( NvmDataMgmtCommit_t ) ) !=
+          sizeof( NvmDataMgmtCommit_t ) ) ||
+        ( Crc32( ( uint8_t* ) commit, sizeof( NvmDataMgmtCommit_t ) - sizeof( uint32_t ) ) != commit->Crc32 ) )
+    {
+        return false;
+    }
+
+    // Every group must be there and from the committed store, a partial context is not resumed
+    for( uint8_t i = 0; i < NVM_DATA_MGMT_GROUP_NB; i++ )
+    {
+        const NvmDataMgmtGroup_t* group = &NvmDataMgmtGroups[i];
+        uint32_t crc;
+
+        if( ( NvmmRead( i, ( uint8_t* ) stored + group->Offset, group->Size ) != group->Size ) ||
+            ( NvmDataMgmtCrc32Check( stored, group ) == false ) )
+        {
+            return false;
+        }
+        memcpy1( ( uint8_t* ) &crc, ( const uint8_t* ) stored + group->Crc32Offset, sizeof( crc ) );
+        if( crc != commit->GroupCrc32[i] )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief The stored times count from the boot they were stored in, restarts them
+ *        from now. The remaining time off and band credits are kept, so the
+ *        duty cycle is not relaxed by a reset.
+ */
+static void NvmDataMgmtRebaseTimes( LoRaMacNvmData_t* nvm )
+{
+    TimerTime_t now = TimerGetCurrentTime( );
+
+    nvm->MacGroup1.LastTxDoneTime = now;
+    NvmDataMgmtCrc32Update( nvm, LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
+
+    for( uint8_t i = 0; i < REGION_NVM_MAX_NB_BANDS; i++ )
+    {
+        nvm->RegionGroup1.Bands[i].LastBandUpdateTime = now;
+        nvm->RegionGroup1.Bands[i].LastMaxCreditAssignTime = 0;
+    }
+    NvmDataMgmtCrc32Update( nvm, LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 );
+}
+
+#endif
 
 void NvmDataMgmtEvent( uint16_t notifyFlags )
 {
-    // NvmNotifyFlags = notifyFlags;
+#if( CONTEXT_MANAGEMENT_ENABLED == 1 )
+    NvmNotifyFlags |= notifyFlags;
+#endif
 }
 
 uint16_t NvmDataMgmtStore( void )
 {
-// #if( CONTEXT_MANAGEMENT_ENABLED == 1 )
-//     uint16_t offset = 0;
-//     uint16_t dataSize = 0;
-//     MibRequestConfirm_t mibReq;
-//     mibReq.Type = MIB_NVM_CTXS;
-//     LoRaMacMibGetRequestConfirm( &mibReq );
-//     LoRaMacNvmData_t* nvm = mibReq.Param.Contexts;
-
-//     // Input checks
-//     if( NvmNotifyFlags == LORAMAC_NVM_NOTIFY_FLAG_NONE )
-//     {
-//         // There was no update.
-//         return 0;
-//     }
-//     if( LoRaMacStop( ) != LORAMAC_STATUS_OK )
-//     {
-//         return 0;
-//     }
-
-//     // Crypto
-//     if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_CRYPTO ) ==
-//         LORAMAC_NVM_NOTIFY_FLAG_CRYPTO )
-//     {
-//         dataSize += NvmmWrite( ( uint8_t* ) &nvm->Crypto, sizeof( nvm->Crypto ),
-//                                offset );
-//     }
-//     offset += sizeof( nvm->Crypto );
-
-//     // MacGroup1
-//     if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 ) ==
-//         LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 )
-//     {
-//         dataSize += NvmmWrite( ( uint8_t* ) &nvm->MacGroup1,
-//                                sizeof( nvm->MacGroup1 ), offset );
-//     }
-//     offset += sizeof( nvm->MacGroup1 );
-
-//     // MacGroup2
-//     if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 ) ==
-//         LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 )
-//     {
-//         dataSize += NvmmWrite( ( uint8_t* ) &nvm->MacGroup2,
-//                                sizeof( nvm->MacGroup2 ), offset );
-//     }
-//     offset += sizeof( nvm->MacGroup2 );
-
-//     // Secure element
-//     if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT ) ==
-//         LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT )
-//     {
-//         dataSize += NvmmWrite( ( uint8_t* ) &nvm->SecureElement, sizeof( nvm->SecureElement ),
-//                                offset );
-//     }
-//     offset += sizeof( nvm->SecureElement );
-
-//     // Region group 1
-//     if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 ) ==
-//         LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 )
-//     {
-//         dataSize += NvmmWrite( ( uint8_t* ) &nvm->RegionGroup1,
-//                                sizeof( nvm->RegionGroup1 ), offset );
-//     }
-//     offset += sizeof( nvm->RegionGroup1 );
-
-//     // Region group 2
-//     if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2 ) ==
-//         LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2 )
-//     {
-//         dataSize += NvmmWrite( ( uint8_t* ) &nvm->RegionGroup2,
-//                                sizeof( nvm->RegionGroup2 ), offset );
-//     }
-//     offset += sizeof( nvm->RegionGroup2 );
-
-//     // Class b
-//     if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_CLASS_B ) ==
-//         LORAMAC_NVM_NOTIFY_FLAG_CLASS_B )
-//     {
-//         dataSize += NvmmWrite( ( uint8_t* ) &nvm->ClassB, sizeof( nvm->ClassB ),
-//                                offset );
-//     }
-//     offset += sizeof( nvm->ClassB );
-
-//     // Reset notification flags
-//     NvmNotifyFlags = LORAMAC_NVM_NOTIFY_FLAG_NONE;
-
-//     // Resume LoRaMac
-//     LoRaMacStart( );
-//     return dataSize;
-// #else
-//     return 0;
-// #endif
-
-return 0;
+#if( CONTEXT_MANAGEMENT_ENABLED == 1 )
+    uint16_t dataSize = 0;
+    bool failed = false;
+    LoRaMacNvmData_t* nvm;
+
+    // Input checks
+    if( ( NvmNotifyFlags == LORAMAC_NVM_NOTIFY_FLAG_NONE ) && ( NvmCommitPending == false ) )
+    {
+        // There was no update.
+        return 0;
+    }
+    // Keeps the groups consistent while they are written
+    if( LoRaMacStop( ) != LORAMAC_STATUS_OK )
+    {
+        return 0;
+    }
+    nvm = NvmDataMgmtGetContexts( );
+
+    for( uint8_t i = 0; i < NVM_DATA_MGMT_GROUP_NB; i++ )
+    {
+        const NvmDataMgmtGroup_t* group = &NvmDataMgmtGroups[i];
+
+        if( ( NvmNotifyFlags & group->NotifyFlag ) == 0 )
+        {
+            continue;
+        }
+        if( NvmmWrite( i, ( uint8_t* ) nvm + group->Offset, group->Size ) == group->Size )
+        {
+            NvmNotifyFlags &= ~group->NotifyFlag;
+            memcpy1( ( uint8_t* ) &NvmCommit.GroupCrc32[i], ( uint8_t* ) nvm + group->Crc32Offset, sizeof( uint32_t ) );
+            NvmCommitPending = true;
+            dataSize += group->Size;
+        }
+        else
+        {
+            // A failed group stays flagged and is written again next time
+            failed = true;
+        }
+    }
+
+    // Written last, once every group of the store is in flash
+    if( ( failed == false ) && ( NvmCommitPending == true ) )
+    {
+        NvmCommit.Crc32 = Crc32( ( uint8_t* ) &NvmCommit, sizeof( NvmDataMgmtCommit_t ) - sizeof( uint32_t ) );
+        if( NvmmWrite( NVM_DATA_MGMT_COMMIT_RECORD, ( uint8_t* ) &NvmCommit, sizeof( NvmDataMgmtCommit_t ) ) ==
+            sizeof( NvmDataMgmtCommit_t ) )
+        {
+            NvmCommitPending = false;
+            dataSize += sizeof( NvmDataMgmtCommit_t );
+        }
+    }
+
+    // Resume LoRaMac
+    LoRaMacStart( );
+    return dataSize;
+#else
+    return 0;
+#endif
 }
 
 uint16_t NvmDataMgmtRestore( void )
 {
-// #if( CONTEXT_MANAGEMENT_ENABLED == 1 )
-//     MibRequestConfirm_t mibReq;
-//     mibReq.Type = MIB_NVM_CTXS;
-//     LoRaMacMibGetRequestConfirm( &mibReq );
-//     LoRaMacNvmData_t* nvm = mibReq.Param.Contexts;
-//     uint16_t offset = 0;
-
-//     // Crypto
-//     if( NvmmCrc32Check( sizeof( LoRaMacCryptoNvmData_t ), offset ) == false )
-//     {
-//         return 0;
-//     }
-//     offset += sizeof( LoRaMacCryptoNvmData_t );
-
-//     // Mac Group 1
-//     if( NvmmCrc32Check( sizeof( LoRaMacNvmDataGroup1_t ), offset ) == false )
-//     {
-//         return 0;
-//     }
-//     offset += sizeof( LoRaMacNvmDataGroup1_t );
-
-//     // Mac Group 2
-//     if( NvmmCrc32Check( sizeof( LoRaMacNvmDataGroup2_t ), offset ) == false )
-//     {
-//         return 0;
-//     }
-//     offset += sizeof( LoRaMacNvmDataGroup2_t );
-
-//     // Secure element
-//     if( NvmmCrc32Check( sizeof( SecureElementNvmData_t ), offset ) == false )
-//     {
-//         return 0;
-//     }
-//     offset += sizeof( SecureElementNvmData_t );
-
-//     // Region group 1
-//     if( NvmmCrc32Check( sizeof( RegionNvmDataGroup1_t ), offset ) == false )
-//     {
-//         return 0;
-//     }
-//     offset += sizeof( RegionNvmDataGroup1_t );
-
-//     // Region group 2
-//     if( NvmmCrc32Check( sizeof( RegionNvmDataGroup2_t ), offset ) == false )
-//     {
-//         return 0;
-//     }
-//     offset += sizeof( RegionNvmDataGroup2_t );
-
-//     // Class b
-//     if( NvmmCrc32Check( sizeof( LoRaMacClassBNvmData_t ), offset ) == false )
-//     {
-//         return 0;
-//     }
-//     offset += sizeof( LoRaMacClassBNvmData_t );
-
-//     if( NvmmRead( ( uint8_t* ) nvm, sizeof( LoRaMacNvmData_t ), 0 ) ==
-//                   sizeof( LoRaMacNvmData_t ) )
-//     {
-//         return sizeof( LoRaMacNvmData_t );
-//     }
-// #endif
+#if( CONTEXT_MANAGEMENT_ENABLED == 1 )
+    LoRaMacNvmData_t* nvm = NvmDataMgmtGetContexts( );
+    LoRaMacNvmData_t* stored;
+    NvmDataMgmtCommit_t commit;
+    MibRequestConfirm_t mibReq;
+    uint16_t dataSize = 0;
+
+    // Too large for the stack of the calling task
+    stored = ( LoRaMacNvmData_t* ) malloc( sizeof( LoRaMacNvmData_t ) );
+    if( stored == NULL )
+    {
+        return 0;
+    }
+    memset1( ( uint8_t* ) stored, 0, sizeof( LoRaMacNvmData_t ) );
+
+    if( ( NvmDataMgmtReadContext( stored, &commit ) == true ) &&
+        ( stored->MacGroup2.NetworkActivation != ACTIVATION_TYPE_NONE ) )
+    {
+        // The session must belong to the identity the application configured
+        if( NvmDataMgmtIdentityMatch( stored, nvm ) == false )
+        {
+            NvmmErase( );
+        }
+        else if( LoRaMacStop( ) == LORAMAC_STATUS_OK )
+        {
+            NvmDataMgmtRebaseTimes( stored );
+            mibReq.Type = MIB_NVM_CTXS;
+            mibReq.Param.Contexts = stored;
+            if( LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK )
+            {
+                NvmCommit = commit;
+                dataSize = sizeof( LoRaMacNvmData_t );
+            }
+            LoRaMacStart( );
+        }
+    }
+
+    if( dataSize == 0 )
+    {
+        // Records left from another session must not pass for groups of the
+        // new one, the first store writes them all
+        for( uint8_t i = 0; i < NVM_DATA_MGMT_GROUP_NB; i++ )
+        {
+            NvmNotifyFlags |= NvmDataMgmtGroups[i].NotifyFlag;
+        }
+    }
+
+    free( stored );
+    return dataSize;
+#else
     return 0;
+#endif
 }
 
 bool NvmDataMgmtFactoryReset( void )
 {
-//     uint16_t offset = 0;
-// #if( CONTEXT_MANAGEMENT_ENABLED == 1 )
-//     // Crypto
-//     if( NvmmReset( sizeof( LoRaMacCryptoNvmData_t ), offset ) == false )
-//     {
-//         return false;
-//     }
-//     offset += sizeof( LoRaMacCryptoNvmData_t );
-
-//     // Mac Group 1
-//     if( NvmmReset( sizeof( LoRaMacNvmDataGroup1_t ), offset ) == false )
-//     {
-//         return false;
-//     }
-//     offset += sizeof( LoRaMacNvmDataGroup1_t );
-
-//     // Mac Group 2
-//     if( NvmmReset( sizeof( LoRaMacNvmDataGroup2_t ), offset ) == false )
-//     {
-//         return false;
-//     }
-//     offset += sizeof( LoRaMacNvmDataGroup2_t );
-
-//     // Secure element
-//     if( NvmmReset( sizeof( SecureElementNvmData_t ), offset ) == false )
-//     {
-//         return false;
-//     }
-//     offset += sizeof( SecureElementNvmData_t );
-
-//     // Region group 1
-//     if( NvmmReset( sizeof( RegionNvmDataGroup1_t ), offset ) == false )
-//     {
-//         return false;
-//     }
-//     offset += sizeof( RegionNvmDataGroup1_t );
-
-//     // Region group 2
-//     if( NvmmReset( sizeof( RegionNvmDataGroup2_t ), offset ) == false )
-//     {
-//         return false;
-//     }
-//     offset += sizeof( RegionNvmDataGroup2_t );
-
-//     // Class b
-//     if( NvmmReset( sizeof( LoRaMacClassBNvmData_t ), offset ) == false )
-//     {
-//         return false;
-//     }
-//     offset += sizeof( LoRaMacClassBNvmData_t );
-// #endif
+#if( CONTEXT_MANAGEMENT_ENABLED == 1 )
+    NvmNotifyFlags = LORAMAC_NVM_NOTIFY_FLAG_NONE;
+    NvmCommitPending = false;
+    memset1( ( uint8_t* ) &NvmCommit, 0, sizeof( NvmCommit ) );
+    return NvmmErase( );
+#else
     return true;
+#endif
 }
@@ -37,6 +37,14 @@
 #ifndef __NVMDATAMGMT_H__
 #define __NVMDATAMGMT_H__
 
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
 /*!
  * \brief NVM Management event.
  *
@@ -55,6 +63,10 @@ uint16_t NvmDataMgmtStore( void );
 /*!
  * \brief Function which restores the MAC data from NVM, if required.
  *
+ * \remark The stored context is resumed only when every group belongs to the
+ *         last complete store and matches the identity the application
+ *         configured. It is erased when the identity differs.
+ *
  * \retval Number of bytes which were restored.
  */
 uint16_t NvmDataMgmtRestore(void );
@@ -68,4 +80,8 @@ bool NvmDataMgmtFactoryReset( void );
 
 /* \} */
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // __NVMDATAMGMT_H__
@@ -0,0 +1,118 @@
+/*!
+ * \file      lora-task.cpp
+ *
+ * \brief     LoRa task executor: creation, core affinity and run-time statistics
+ */
+#include <Arduino.h>
+#include "lora-task.h"
+#include "system/utilities.h"
+#include "boards/mcu/board.h"
+#include "boards/mcu/timer.h"
+#include "radio/radio-latency.h"
+
+extern SemaphoreHandle_t loraIntSem;
+extern TaskHandle_t loraTaskHandle;
+
+static sLoRaTaskConfig_t LoRaTaskConfig = { LORA_TASK_CORE, LORA_TASK_PRIORITY, LORA_TASK_STACK_SIZE };
+
+/*!
+ * Statistics, written by the LoRa task and read by the application with the
+ * interrupts masked, the 64-bit total would tear otherwise
+ */
+static sLoRaTaskStats_t LoRaTaskStats;
+static uint64_t LoRaTaskTotalUs = 0;
+
+static void LoRaTaskLoop( void *pvParameters )
+{
+    LoRaTaskProcess_t process = ( LoRaTaskProcess_t )pvParameters;
+
+    while( 1 )
+    {
+        if( xSemaphoreTake( loraIntSem, portMAX_DELAY ) == pdTRUE )
+        {
+            RADIO_LATENCY_MARK( RADIO_LATENCY_TASK_WAKE );
+            TimerTimeUs_t start = TimerGetCurrentTimeUs( );
+            uint16_t depth = process( );
+            uint32_t elapsed = ( uint32_t )TimerGetElapsedTimeUs( start );
+
+            BoardDisableIrq( );
+            LoRaTaskStats.runs++;
+            LoRaTaskTotalUs += elapsed;
+            LoRaTaskStats.lastRunUs = elapsed;
+            if( elapsed > LoRaTaskStats.maxRunUs )
+            {
+                LoRaTaskStats.maxRunUs = elapsed;
+            }
+            LoRaTaskStats.queueDepth = depth;
+            if( depth > LoRaTaskStats.maxQueueDepth )
+            {
+                LoRaTaskStats.maxQueueDepth = depth;
+            }
+            BoardEnableIrq( );
+        }
+    }
+}
+
+bool LoRaTaskSetConfig( const sLoRaTaskConfig_t *config )
+{
+    if( ( config == NULL ) || ( loraTaskHandle != NULL ) )
+    {
+        return false;
+    }
+    if( ( config->core >= portNUM_PROCESSORS ) || ( config->priority >= configMAX_PRIORITIES ) )
+    {
+        return false;
+    }
+    LoRaTaskConfig = *config;
+    return true;
+}
+
+void LoRaTaskGetConfig( sLoRaTaskConfig_t *config )
+{
+    *config = LoRaTaskConfig;
+}
+
+bool LoRaTaskStart( LoRaTaskProcess_t process )
+{
+    // Create the LoRaWan event semaphore
+    // 二值 信号量用于同步
+    loraIntSem = xSemaphoreCreateBinary( );
+    xSemaphoreGive( loraIntSem );
+    xSemaphoreTake( loraIntSem, 10 );
+
+    BaseType_t core = ( LoRaTaskConfig.core < 0 ) ? tskNO_AFFINITY : LoRaTaskConfig.core;
+    if( xTaskCreatePinnedToCore( LoRaTaskLoop, "LORA", LoRaTaskConfig.stackSize, ( void* )process,
+                                 LoRaTaskConfig.priority, &loraTaskHandle, core ) != pdPASS )
+    {
+        loraTaskHandle = NULL;
+        return false;
+    }
+    return true;
+}
+
+void LoRaTaskGetStats( sLoRaTaskStats_t *stats )
+{
+    uint64_t totalUs;
+
+    BoardDisableIrq( );
+    *stats = LoRaTaskStats;
+    totalUs = LoRaTaskTotalUs;
+    BoardEnableIrq( );
+
+    stats->avgRunUs = ( stats->runs != 0 ) ? ( uint32_t )( totalUs / stats->runs ) : 0;
+
+    // On the ESP32 the high water mark is counted in bytes
+    stats->stackFree = ( loraTaskHandle != NULL ) ? uxTaskGetStackHighWaterMark( loraTaskHandle ) : 0;
+}
+
+void LoRaTaskResetStats( void )
+{
+    BoardDisableIrq( );
+    LoRaTaskTotalUs = 0;
+    LoRaTaskStats.runs = 0;
+    LoRaTaskStats.lastRunUs = 0;
+    LoRaTaskStats.maxRunUs = 0;
+    LoRaTaskStats.queueDepth = 0;
+    LoRaTaskStats.maxQueueDepth = 0;
+    BoardEnableIrq( );
+}
@@ -0,0 +1,105 @@
+/*!
+ * \file      lora-task.h
+ *
+ * \brief     LoRa task executor: creation, core affinity and run-time statistics
+ *
+ * \remark    The LoRa task sleeps on loraIntSem and runs the MAC (LoRaWAN_Node)
+ *            or the radio event handler (DFRobot_LoRaRadio) each time the radio
+ *            interrupt or a timer gives it.
+ */
+#ifndef __LORA_TASK_H__
+#define __LORA_TASK_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef LORA_TASK_CORE
+#define LORA_TASK_CORE -1                  ///< Core the LoRa task is pinned to, -1 lets the scheduler choose
+#endif
+
+#ifndef LORA_TASK_PRIORITY
+#define LORA_TASK_PRIORITY 2               ///< FreeRTOS priority of the LoRa task
+#endif
+
+#ifndef LORA_TASK_STACK_SIZE
+#define LORA_TASK_STACK_SIZE 8192          ///< Stack size of the LoRa task(bytes)
+#endif
+
+/*!
+ * LoRa task settings, used when the task is created
+ */
+typedef struct
+{
+    int8_t core;                /**<Core the task is pinned to, -1 for no affinity>*/
+    uint8_t priority;           /**<FreeRTOS priority>*/
+    uint32_t stackSize;         /**<Stack size(bytes)>*/
+} sLoRaTaskConfig_t;
+
+/*!
+ * LoRa task run-time statistics
+ */
+typedef struct
+{
+    uint32_t stackFree;         /**<Least free stack seen since the task started(bytes)>*/
+    uint32_t runs;              /**<Wake-ups processed>*/
+    uint32_t lastRunUs;         /**<Duration of the last processing pass(us)>*/
+    uint32_t avgRunUs;          /**<Average duration of a processing pass(us)>*/
+    uint32_t maxRunUs;          /**<Longest processing pass(us)>*/
+    uint16_t queueDepth;        /**<Entries waiting in the owner's queue after the last pass>*/
+    uint16_t maxQueueDepth;     /**<Most entries seen waiting after a pass>*/
+} sLoRaTaskStats_t;
+
+/*!
+ * \brief One processing pass of the LoRa task
+ *
+ * \retval Entries left waiting in the owner's queue
+ */
+typedef uint16_t ( *LoRaTaskProcess_t )( void );
+
+/*!
+ * \brief Set the settings used by the next LoRaTaskStart
+ *
+ * \param [IN] config Task settings
+ *
+ * \retval false when the LoRa task already runs
+ */
+bool LoRaTaskSetConfig( const sLoRaTaskConfig_t *config );
+
+/*!
+ * \brief Get the settings of the LoRa task
+ *
+ * \param [OUT] config Task settings
+ */
+void LoRaTaskGetConfig( sLoRaTaskConfig_t *config );
+
+/*!
+ * \brief Create loraIntSem and the LoRa task
+ *
+ * \param [IN] process Called each time loraIntSem is given
+ *
+ * \retval true when the task was created
+ */
+bool LoRaTaskStart( LoRaTaskProcess_t process );
+
+/*!
+ * \brief Get a snapshot of the LoRa task statistics
+ *
+ * \param [OUT] stats Statistics
+ */
+void LoRaTaskGetStats( sLoRaTaskStats_t *stats );
+
+/*!
+ * \brief Clear the duration and queue depth statistics
+ */
+void LoRaTaskResetStats( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LORA_TASK_H__
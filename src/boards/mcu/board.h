@@ -123,6 +123,14 @@ extern "C"
 //  */
 // void lora_hardware_uninit(void);
 
+/**@brief Initializes the MCU resources shared by the stack: the RTC alarm
+ *        of the timers
+ *
+ * @remark Allocates, never call it from inside BoardDisableIrq. The first
+ *         TimerStart does the same if it has not been called yet.
+ */
+void BoardInitMcu(void);
+
 // /**@brief Returns a pseudo random seed generated using the MCU Unique ID
 //  *
 //  * @retval seed Generated pseudo random seed
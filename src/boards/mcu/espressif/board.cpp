@@ -36,6 +36,12 @@ Maintainer: Miguel Luis and Gregory Cristian
 #if defined ESP32 || defined ESP8266
 #include <Arduino.h>
 #include "boards/mcu/board.h"
+#include "boards/rtc-board.h"
+
+void BoardInitMcu(void)
+{
+	RtcInit();
+}
 
 uint32_t BoardGetRandomSeed(void)
 {
@@ -0,0 +1,31 @@
+/*!
+ * \file      Arduino.h
+ *
+ * \brief     Minimal Arduino core stand-in for the host (POSIX) build
+ *
+ * \remark    Only the attributes used by the LoRaMac stack sources are
+ *            provided. This directory is on the include path of the host
+ *            build only, the Arduino IDE never sees this file.
+ */
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef RTC_DATA_ATTR
+#define RTC_DATA_ATTR
+#endif
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+#ifndef DRAM_ATTR
+#define DRAM_ATTR
+#endif
+
+#endif // __HOST_ARDUINO_H__
@@ -0,0 +1,59 @@
+/*!
+ * \file      board.cpp
+ *
+ * \brief     Host (POSIX) board general functions implementation
+ */
+#if defined( LORAWAN_HOST )
+#include <stdlib.h>
+#include "boards/mcu/board.h"
+#include "boards/mcu/posix/host-board.h"
+#include "boards/rtc-board.h"
+
+static uint32_t BoardSeed = 0;
+
+void BoardInitMcu(void)
+{
+	RtcInit();
+}
+
+void HostBoardInit( uint32_t seed )
+{
+	BoardSeed = seed;
+	srand( seed );
+	BoardInitMcu();
+}
+
+uint32_t BoardGetRandomSeed(void)
+{
+	return BoardSeed;
+}
+
+void BoardGetUniqueId(uint8_t *id)
+{
+	// Same layout as the ESP32 MAC based ID: upper 2 bytes are 0
+	id[7] = 0;
+	id[6] = 0;
+	id[5] = 0xDF;
+	id[4] = 0x0B;
+	id[3] = (uint8_t)(BoardSeed >> 24);
+	id[2] = (uint8_t)(BoardSeed >> 16);
+	id[1] = (uint8_t)(BoardSeed >> 8);
+	id[0] = (uint8_t)(BoardSeed);
+}
+
+uint8_t BoardGetBatteryLevel(void)
+{
+	return 0;
+}
+
+// The host port is single threaded, timers and radio events are dispatched
+// from the application loop, so there is nothing to mask.
+void BoardDisableIrq(void)
+{
+}
+
+void BoardEnableIrq(void)
+{
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*!
+ * \file      host-board.h
+ *
+ * \brief     Host (POSIX) board specific functions
+ *
+ * \remark    The host port runs the stack on a virtual microsecond clock.
+ *            Nothing moves forward on its own: the application drives the
+ *            clock with \ref HostTimerRunNext or \ref HostTimerAdvance and
+ *            calls LmHandlerProcess between events, exactly like loraTask
+ *            does on the ESP32 after each radio interrupt.
+ */
+#ifndef __HOST_BOARD_H__
+#define __HOST_BOARD_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "boards/mcu/timer.h"
+
+/*!
+ * \brief Initializes the host board
+ *
+ * \param [IN] seed Seed used for the board random seed and unique ID
+ */
+void HostBoardInit( uint32_t seed );
+
+/*!
+ * \brief Returns the absolute time of the next timer to expire
+ *
+ * \retval time Deadline in ms, rounded up, or TIMERTIME_T_MAX when no timer is running
+ */
+TimerTime_t HostTimerGetNextDeadline( void );
+
+/*!
+ * \brief Moves the clock to the next timer deadline and fires the timers
+ *        expiring at that instant
+ *
+ * \retval fired false when no timer was running
+ */
+bool HostTimerRunNext( void );
+
+/*!
+ * \brief Moves the clock forward, firing every timer expiring on the way
+ *
+ * \param [IN] milliseconds Time to move forward
+ */
+void HostTimerAdvance( TimerTime_t milliseconds );
+
+/*!
+ * \brief Sets the directory holding the MAC context records, see nvmm.h
+ *
+ * \param [IN] directory Existing directory, NULL disables the storage
+ */
+void HostNvmmSetDirectory( const char *directory );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HOST_BOARD_H__
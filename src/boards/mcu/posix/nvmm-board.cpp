@@ -0,0 +1,98 @@
+/*!
+ * \file      nvmm-board.cpp
+ *
+ * \brief     Host (POSIX) MAC context storage, one file per record
+ *
+ * \remark    A record is written to a temporary file, synced and renamed
+ *            over the previous one. Without a directory nothing is stored.
+ */
+#if defined( LORAWAN_HOST )
+#include <stdio.h>
+#include <unistd.h>
+#include "boards/nvmm.h"
+#include "boards/mcu/posix/host-board.h"
+
+static const char *NvmmDirectory = NULL;
+
+void HostNvmmSetDirectory( const char *directory )
+{
+    NvmmDirectory = directory;
+}
+
+static void NvmmPath( char *path, size_t length, uint8_t record, const char *suffix )
+{
+    snprintf( path, length, "%s/nvm%u.%s", NvmmDirectory, record, suffix );
+}
+
+uint16_t NvmmWrite( uint8_t record, const uint8_t *src, uint16_t size )
+{
+    char tmpPath[512];
+    char path[512];
+    FILE *file;
+    bool ok;
+
+    if( ( record >= NVMM_RECORD_MAX ) || ( NvmmDirectory == NULL ) )
+    {
+        return 0;
+    }
+    NvmmPath( tmpPath, sizeof( tmpPath ), record, "tmp" );
+    NvmmPath( path, sizeof( path ), record, "bin" );
+
+    file = fopen( tmpPath, "wb" );
+    if( file == NULL )
+    {
+        return 0;
+    }
+    ok = ( fwrite( src, 1, size, file ) == size ) && ( fflush( file ) == 0 ) && ( fsync( fileno( file ) ) == 0 );
+    if( ( fclose( file ) != 0 ) || ( ok == false ) || ( rename( tmpPath, path ) != 0 ) )
+    {
+        remove( tmpPath );
+        return 0;
+    }
+    return size;
+}
+
+uint16_t NvmmRead( uint8_t record, uint8_t *dest, uint16_t size )
+{
+    char path[512];
+    FILE *file;
+    size_t length;
+
+    if( ( record >= NVMM_RECORD_MAX ) || ( NvmmDirectory == NULL ) )
+    {
+        return 0;
+    }
+    NvmmPath( path, sizeof( path ), record, "bin" );
+
+    file = fopen( path, "rb" );
+    if( file == NULL )
+    {
+        return 0;
+    }
+    length = fread( dest, 1, size, file );
+    // A record of another size belongs to another build of the stack
+    if( ( length != size ) || ( fgetc( file ) != EOF ) )
+    {
+        length = 0;
+    }
+    fclose( file );
+    return length;
+}
+
+bool NvmmErase( void )
+{
+    char path[512];
+
+    if( NvmmDirectory == NULL )
+    {
+        return false;
+    }
+    for( uint8_t record = 0; record < NVMM_RECORD_MAX; record++ )
+    {
+        NvmmPath( path, sizeof( path ), record, "bin" );
+        remove( path );
+    }
+    return true;
+}
+
+#endif
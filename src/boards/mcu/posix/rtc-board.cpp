@@ -0,0 +1,161 @@
+/*!
+ * \file      rtc-board.cpp
+ *
+ * \brief     Host (POSIX) RTC driver implementation, backed by the virtual clock
+ *
+ * \remark    The RTC tick is 1 us of the virtual clock. The alarm only
+ *            records its deadline, \ref HostTimerRunNext and
+ *            \ref HostTimerAdvance move the clock to it and call
+ *            TimerIrqHandler like the ESP32 alarm does.
+ */
+#if defined( LORAWAN_HOST )
+#include "boards/rtc-board.h"
+#include "boards/mcu/timer.h"
+#include "system/utilities.h"
+#include "boards/mcu/posix/host-board.h"
+
+/*!
+ * The virtual alarm has no latency
+ */
+#define MIN_ALARM_DELAY                             0
+
+/*!
+ * Virtual clock [us]
+ */
+static uint64_t HostClock = 0;
+
+/*!
+ * Alarm state
+ */
+static bool RtcAlarmArmed = false;
+static uint64_t RtcAlarmDeadline = 0;
+
+/*!
+ * Timer reference, RTC ticks at the time the alarm was set
+ */
+static uint32_t RtcTimerContext = 0;
+
+uint32_t RtcGetCalendarTime( uint16_t *milliseconds )
+{
+    *milliseconds = ( uint16_t )( ( HostClock / 1000 ) % 1000 );
+    return ( uint32_t )( HostClock / 1000000 );
+}
+
+static uint32_t RtcBkupRegisters[] = { 0, 0 };
+
+void RtcBkupWrite( uint32_t data0, uint32_t data1 )
+{
+    RtcBkupRegisters[0] = data0;
+    RtcBkupRegisters[1] = data1;
+}
+
+void RtcBkupRead( uint32_t* data0, uint32_t* data1 )
+{
+    *data0 = RtcBkupRegisters[0];
+    *data1 = RtcBkupRegisters[1];
+}
+
+uint32_t RtcGetMinimumTimeout( void )
+{
+    return( MIN_ALARM_DELAY );
+}
+
+TimerTime_t RtcTempCompensation( TimerTime_t period, float temperature )
+{
+    return period;
+}
+
+void RtcProcess( void )
+{
+
+}
+
+uint32_t RtcMs2Tick( TimerTime_t milliseconds )
+{
+    return milliseconds * 1000;
+}
+
+TimerTime_t RtcTick2Ms( uint32_t tick )
+{
+    return tick / 1000;
+}
+
+uint64_t RtcGetTimeUs( void )
+{
+    return HostClock;
+}
+
+void RtcInit( void )
+{
+}
+
+uint32_t RtcGetTimerValue( void )
+{
+    return ( uint32_t )HostClock;
+}
+
+void RtcSetAlarm( uint32_t timeout )
+{
+    RtcSetTimerContext( );
+    RtcAlarmDeadline = HostClock + timeout;
+    RtcAlarmArmed = true;
+}
+
+void RtcStopAlarm( void )
+{
+    RtcAlarmArmed = false;
+}
+
+uint32_t RtcSetTimerContext( void )
+{
+    RtcTimerContext = ( uint32_t )HostClock;
+    return RtcTimerContext;
+}
+
+uint32_t RtcGetTimerContext( void )
+{
+    return RtcTimerContext;
+}
+
+uint32_t RtcGetTimerElapsedTime( void )
+{
+    return ( uint32_t )HostClock - RtcTimerContext;
+}
+
+TimerTime_t HostTimerGetNextDeadline( void )
+{
+    if( RtcAlarmArmed == false )
+    {
+        return TIMERTIME_T_MAX;
+    }
+    // Rounded up, advancing the clock to the deadline fires the alarm
+    return ( TimerTime_t )( ( RtcAlarmDeadline + 999 ) / 1000 );
+}
+
+bool HostTimerRunNext( void )
+{
+    if( RtcAlarmArmed == false )
+    {
+        return false;
+    }
+    if( RtcAlarmDeadline > HostClock )
+    {
+        HostClock = RtcAlarmDeadline;
+    }
+    RtcAlarmArmed = false;
+    TimerIrqHandler( );
+    return true;
+}
+
+void HostTimerAdvance( TimerTime_t milliseconds )
+{
+    uint64_t target = HostClock + ( uint64_t )milliseconds * 1000;
+
+    while( ( RtcAlarmArmed == true ) && ( RtcAlarmDeadline <= target ) )
+    {
+        HostTimerRunNext( );
+    }
+    HostClock = target;
+}
+
+#endif
@@ -0,0 +1,19 @@
+#if defined( LORAWAN_HOST )
+#include <string.h>
+#include "boards/mcu/posix/spi_board.h"
+
+SPIClass SPI_LORA;
+
+void SPIClass::transferBytes(const uint8_t *data, uint8_t *out, uint32_t size)
+{
+	if ((out != NULL) && (data != NULL) && (out != data))
+	{
+		memcpy(out, data, size);
+	}
+}
+
+void initSPI(void)
+{
+	SPI_LORA.begin();
+}
+#endif
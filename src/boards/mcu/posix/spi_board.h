@@ -0,0 +1,35 @@
+#ifndef SPI_BOARD_H
+#define SPI_BOARD_H
+#include <stdint.h>
+#include <stddef.h>
+
+#define MSBFIRST  1
+#define SPI_MODE0 0
+
+/*!
+ * \brief SPI settings stand-in, the host bus has no clock
+ */
+class SPISettings
+{
+public:
+	SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {}
+};
+
+/*!
+ * \brief Loopback SPI bus: every transfer returns the byte it was given
+ */
+class SPIClass
+{
+public:
+	void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {}
+	void end(void) {}
+	void beginTransaction(SPISettings settings) {}
+	void endTransaction(void) {}
+	uint8_t transfer(uint8_t data) { return data; }
+	void transferBytes(const uint8_t *data, uint8_t *out, uint32_t size);
+};
+
+extern SPIClass SPI_LORA;
+
+void initSPI(void);
+#endif // SPI_BOARD_H
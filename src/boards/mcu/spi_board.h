@@ -1,6 +1,8 @@
 #ifndef _SPI_BOARD_H
 #define _SPI_BOARD_H
-#if defined ESP8266 || defined ESP32
+#if defined LORAWAN_HOST
+#include "boards/mcu/posix/spi_board.h"
+#elif defined ESP8266 || defined ESP32
 #include "boards/mcu/espressif/spi_board.h"
 #elif defined(NRF52_SERIES)
 #include "boards/mcu/nrf52832/spi_board.h"
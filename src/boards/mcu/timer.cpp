@@ -0,0 +1,504 @@
+/*!
+ * \file      timer.c
+ *
+ * \brief     Timer objects and scheduling management implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ *
+ * \remark    All the running timers share the single RTC alarm. They are kept
+ *            in a binary min-heap ordered by absolute expiry time, so starting
+ *            or stopping a timer costs O(log n) and the alarm is always set
+ *            for the heap root. The heap grows on demand, there is no limit on
+ *            the number of timers.
+ *
+ *            Expiry times are kept on the 64-bit microsecond clock of the RTC,
+ *            which never wraps around.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "system/utilities.h"
+#include "boards/mcu/board.h"
+#include "boards/rtc-board.h"
+#include "boards/mcu/timer.h"
+
+/*!
+ * Number of entries allocated the first time a timer is started. The queue
+ * doubles whenever it is full.
+ */
+#define TIMER_QUEUE_INITIAL_SIZE                    16
+
+/*!
+ * Longest alarm requested from the RTC [us]. Farther deadlines are reached
+ * through intermediate alarms.
+ */
+#define TIMER_MAX_ALARM_TIMEOUT                     0x7FFFFFFF
+
+/*!
+ * Safely execute call back
+ */
+#define ExecuteCallBack( _callback_, context ) \
+    do                                         \
+    {                                          \
+        if( _callback_ == NULL )               \
+        {                                      \
+            while( 1 );                        \
+        }                                      \
+        else                                   \
+        {                                      \
+            _callback_( context );             \
+        }                                      \
+    }while( 0 );
+
+/*!
+ * Running timers, heap ordered on TimerEvent_t.Timestamp. TimerQueue[0] is
+ * the next timer to expire.
+ */
+static TimerEvent_t **TimerQueue = NULL;
+static uint32_t TimerQueueSize = 0;
+static uint32_t TimerQueueCapacity = 0;
+
+/*!
+ * Callback lateness statistics
+ */
+static TimerLateness_t TimerLateness;
+
+/*!
+ * \brief Compares two expiry times
+ *
+ * \retval true if time a is before time b
+ */
+static inline bool TimerIsBefore( TimerTimeUs_t a, TimerTimeUs_t b )
+{
+    return a < b;
+}
+
+/*!
+ * \brief Makes sure the queue can hold one more timer
+ *
+ * \remark Called outside of the critical section as it may allocate.
+ *
+ * \retval false if the queue could not be enlarged
+ */
+static bool TimerQueueReserve( void );
+
+/*!
+ * \brief Checks if the object is in the queue
+ */
+static bool TimerExists( TimerEvent_t *obj );
+
+/*!
+ * \brief Adds a timer to the queue.
+ *
+ * \param [IN]  obj Timer object to be added to the queue
+ */
+static void TimerInsertTimer( TimerEvent_t *obj );
+
+/*!
+ * \brief Removes a timer from the queue.
+ *
+ * \param [IN]  obj Timer object to be removed, must be in the queue
+ */
+static void TimerRemoveTimer( TimerEvent_t *obj );
+
+/*!
+ * \brief Sets the RTC alarm for the queue head, or stops it when the queue is
+ *        empty.
+ */
+static void TimerSetTimeout( void );
+
+void TimerInit( TimerEvent_t *obj, void ( *callback )( void* context ) )
+{
+    BoardDisableIrq( );
+    if( TimerExists( obj ) == true )
+    {
+        TimerRemoveTimer( obj );
+        TimerSetTimeout( );
+    }
+    BoardEnableIrq( );
+
+    obj->Timestamp = 0;
+    obj->ReloadValue = 0;
+    obj->IsRunning = false;
+    obj->QueueIndex = 0;
+    obj->Lateness = 0;
+    obj->Callback = callback;
+    obj->Context = NULL;
+}
+
+/*!
+ * \brief Calls a callback registered without context
+ */
+static void TimerCallWithoutContext( void* context )
+{
+    ( ( void ( * )( void ) )context )( );
+}
+
+void TimerInit( TimerEvent_t *obj, void ( *callback )( void ) )
+{
+    TimerInit( obj, TimerCallWithoutContext );
+    obj->Context = ( void* )callback;
+}
+
+void TimerSetContext( TimerEvent_t *obj, void* context )
+{
+    // The context of a timer initialized without one holds its callback
+    assert( obj->Callback != TimerCallWithoutContext );
+    obj->Context = context;
+}
+
+void TimerStart( TimerEvent_t *obj )
+{
+    if( ( obj == NULL ) || ( obj->Callback == NULL ) )
+    {
+        // Never initialized
+        return;
+    }
+    // Creates the RTC alarm on the first start, outside the critical section
+    // since it allocates. Timers may start before BoardInitMcu.
+    RtcInit( );
+
+    for( ;; )
+    {
+        if( TimerQueueReserve( ) == false )
+        {
+            return;
+        }
+        BoardDisableIrq( );
+        if( TimerExists( obj ) == true )
+        {
+            TimerRemoveTimer( obj );
+        }
+        if( TimerQueueSize < TimerQueueCapacity )
+        {
+            break;
+        }
+        // Filled up by another context in the meantime
+        BoardEnableIrq( );
+    }
+
+    obj->Timestamp = RtcGetTimeUs( ) + obj->ReloadValue;
+    obj->IsRunning = true;
+    TimerInsertTimer( obj );
+    if( TimerQueue[0] == obj )
+    {
+        TimerSetTimeout( );
+    }
+    BoardEnableIrq( );
+}
+
+bool TimerIsStarted( TimerEvent_t *obj )
+{
+    return obj->IsRunning;
+}
+
+void TimerIrqHandler( void )
+{
+    TimerEvent_t* cur;
+    TimerTimeUs_t now;
+    uint32_t lateness;
+
+    BoardDisableIrq( );
+    now = RtcGetTimeUs( );
+    while( ( TimerQueueSize > 0 ) && ( TimerIsBefore( now, TimerQueue[0]->Timestamp ) == false ) )
+    {
+        cur = TimerQueue[0];
+        lateness = ( uint32_t )MIN( now - cur->Timestamp, UINT32_MAX );
+        TimerRemoveTimer( cur );
+
+        // Periodic timers are re-armed before their callback runs, so a
+        // callback may stop its own timer
+        if( ( cur->oneShot == false ) && ( cur->ReloadValue != 0 ) )
+        {
+            cur->Timestamp += cur->ReloadValue;
+            if( TimerIsBefore( cur->Timestamp, now ) == true )
+            {
+                cur->Timestamp = now + cur->ReloadValue;
+            }
+            TimerInsertTimer( cur );
+        }
+        else
+        {
+            cur->IsRunning = false;
+        }
+
+        cur->Lateness = lateness;
+        TimerLateness.Events++;
+        TimerLateness.Last = lateness;
+        TimerLateness.Total += lateness;
+        if( lateness > TimerLateness.Max )
+        {
+            TimerLateness.Max = lateness;
+        }
+        BoardEnableIrq( );
+
+        ExecuteCallBack( cur->Callback, cur->Context );
+
+        BoardDisableIrq( );
+        now = RtcGetTimeUs( );
+    }
+    TimerSetTimeout( );
+    BoardEnableIrq( );
+}
+
+void TimerStop( TimerEvent_t *obj )
+{
+    if( obj == NULL )
+    {
+        return;
+    }
+
+    BoardDisableIrq( );
+    obj->IsRunning = false;
+    if( TimerExists( obj ) == true )
+    {
+        bool head = ( TimerQueue[0] == obj );
+
+        TimerRemoveTimer( obj );
+        if( head == true )
+        {
+            TimerSetTimeout( );
+        }
+    }
+    BoardEnableIrq( );
+}
+
+void TimerReset( TimerEvent_t *obj )
+{
+    TimerStop( obj );
+    TimerStart( obj );
+}
+
+void TimerSetValue( TimerEvent_t *obj, uint32_t value )
+{
+    TimerSetValueUs( obj, ( TimerTimeUs_t )value * 1000 );
+}
+
+void TimerSetValueUs( TimerEvent_t *obj, TimerTimeUs_t value )
+{
+    TimerStop( obj );
+    obj->ReloadValue = value;
+}
+
+TimerTime_t TimerGetCurrentTime( void )
+{
+    return ( TimerTime_t )( RtcGetTimeUs( ) / 1000 );
+}
+
+TimerTime_t TimerGetElapsedTime( TimerTime_t past )
+{
+    // Intentional wrap around
+    return TimerGetCurrentTime( ) - past;
+}
+
+TimerTimeUs_t TimerGetCurrentTimeUs( void )
+{
+    return RtcGetTimeUs( );
+}
+
+TimerTimeUs_t TimerGetElapsedTimeUs( TimerTimeUs_t past )
+{
+    TimerTimeUs_t now = RtcGetTimeUs( );
+
+    return ( now > past ) ? now - past : 0;
+}
+
+TimerTime_t TimerTempCompensation( TimerTime_t period, float temperature )
+{
+    return RtcTempCompensation( period, temperature );
+}
+
+void TimerProcess( void )
+{
+    RtcProcess( );
+}
+
+void TimerGetLateness( TimerLateness_t *lateness )
+{
+    BoardDisableIrq( );
+    *lateness = TimerLateness;
+    BoardEnableIrq( );
+}
+
+void TimerResetLateness( void )
+{
+    BoardDisableIrq( );
+    memset( &TimerLateness, 0, sizeof( TimerLateness ) );
+    BoardEnableIrq( );
+}
+
+static bool TimerQueueReserve( void )
+{
+    TimerEvent_t **queue;
+    TimerEvent_t **old;
+    uint32_t capacity;
+
+    if( TimerQueueSize < TimerQueueCapacity )
+    {
+        return true;
+    }
+
+    capacity = ( TimerQueueCapacity == 0 ) ? TIMER_QUEUE_INITIAL_SIZE : TimerQueueCapacity * 2;
+    queue = ( TimerEvent_t** )malloc( capacity * sizeof( TimerEvent_t* ) );
+    if( queue == NULL )
+    {
+        return false;
+    }
+
+    BoardDisableIrq( );
+    if( capacity <= TimerQueueCapacity )
+    {
+        // Enlarged by another context in the meantime
+        BoardEnableIrq( );
+        free( queue );
+        return true;
+    }
+    if( TimerQueueSize > 0 )
+    {
+        memcpy( queue, TimerQueue, TimerQueueSize * sizeof( TimerEvent_t* ) );
+    }
+    old = TimerQueue;
+    TimerQueue = queue;
+    TimerQueueCapacity = capacity;
+    BoardEnableIrq( );
+
+    free( old );
+    return true;
+}
+
+static bool TimerExists( TimerEvent_t *obj )
+{
+    return ( obj->QueueIndex < TimerQueueSize ) && ( TimerQueue[obj->QueueIndex] == obj );
+}
+
+/*!
+ * \brief Moves the entry at index up to its place in the heap
+ */
+static void TimerSiftUp( uint32_t index )
+{
+    TimerEvent_t *obj = TimerQueue[index];
+
+    while( index > 0 )
+    {
+        uint32_t parent = ( index - 1 ) / 2;
+
+        if( TimerIsBefore( obj->Timestamp, TimerQueue[parent]->Timestamp ) == false )
+        {
+            break;
+        }
+        TimerQueue[index] = TimerQueue[parent];
+        TimerQueue[index]->QueueIndex = index;
+        index = parent;
+    }
+    TimerQueue[index] = obj;
+    obj->QueueIndex = index;
+}
+
+/*!
+ * \brief Moves the entry at index down to its place in the heap
+ */
+static void TimerSiftDown( uint32_t index )
+{
+    TimerEvent_t *obj = TimerQueue[index];
+
+    for( ;; )
+    {
+        uint32_t child = ( 2 * index ) + 1;
+
+        if( child >= TimerQueueSize )
+        {
+            break;
+        }
+        if( ( ( child + 1 ) < TimerQueueSize ) &&
+            ( TimerIsBefore( TimerQueue[child + 1]->Timestamp, TimerQueue[child]->Timestamp ) == true ) )
+        {
+            child++;
+        }
+        if( TimerIsBefore( TimerQueue[child]->Timestamp, obj->Timestamp ) == false )
+        {
+            break;
+        }
+        TimerQueue[index] = TimerQueue[child];
+        TimerQueue[index]->QueueIndex = index;
+        index = child;
+    }
+    TimerQueue[index] = obj;
+    obj->QueueIndex = index;
+}
+
+static void TimerInsertTimer( TimerEvent_t *obj )
+{
+    TimerQueue[TimerQueueSize] = obj;
+    TimerQueueSize++;
+    TimerSiftUp( TimerQueueSize - 1 );
+}
+
+static void TimerRemoveTimer( TimerEvent_t *obj )
+{
+    uint32_t index = obj->QueueIndex;
+
+    TimerQueueSize--;
+    // Invalidates the index, TimerExists( obj ) is false from now on
+    obj->QueueIndex = TimerQueueSize;
+    if( index == TimerQueueSize )
+    {
+        return;
+    }
+    TimerQueue[index] = TimerQueue[TimerQueueSize];
+    TimerQueue[index]->QueueIndex = index;
+    if( ( index > 0 ) &&
+        ( TimerIsBefore( TimerQueue[index]->Timestamp, TimerQueue[( index - 1 ) / 2]->Timestamp ) == true ) )
+    {
+        TimerSiftUp( index );
+    }
+    else
+    {
+        TimerSiftDown( index );
+    }
+}
+
+static void TimerSetTimeout( void )
+{
+    TimerTimeUs_t now;
+    TimerTimeUs_t timeout = 0;
+    uint32_t minTicks;
+
+    if( TimerQueueSize == 0 )
+    {
+        RtcStopAlarm( );
+        return;
+    }
+
+    now = RtcGetTimeUs( );
+    minTicks = RtcGetMinimumTimeout( );
+    // In case deadline too soon
+    if( TimerIsBefore( now, TimerQueue[0]->Timestamp ) == true )
+    {
+        timeout = TimerQueue[0]->Timestamp - now;
+    }
+    if( timeout < minTicks )
+    {
+        timeout = minTicks;
+    }
+    if( timeout > TIMER_MAX_ALARM_TIMEOUT )
+    {
+        // TimerIrqHandler finds nothing expired and sets the next alarm
+        timeout = TIMER_MAX_ALARM_TIMEOUT;
+    }
+    RtcSetAlarm( ( uint32_t )timeout );
+}
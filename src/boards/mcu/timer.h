@@ -32,34 +32,25 @@ extern "C"
 {
 #endif
 
-// /*!
-//  * \brief Timer object description
-//  */
-// typedef struct TimerEvent_s
-// {
-//     uint32_t Timestamp;                  //! Current timer value                                当前时间戳
-//     uint32_t ReloadValue;                //! Timer delay value                                  定时器延迟值     
-//     bool IsStarted;                      //! Is the timer currently running                     定时器当前是否正在运行
-//     bool IsNext2Expire;                  //! Is the next timer to expire                        下一个定时器是否到期
-//     void ( *Callback )( void* context ); //! Timer IRQ callback function                        定时器IRQ回调函数
-//     void *Context;                       //! User defined data object pointer to pass back      用户定义的数据对象指针传回
-//     struct TimerEvent_s *Next;           //! Pointer to the next Timer object.                  指向下一个 Timer 对象的指针
-// }TimerEvent_t;
-
-/**@brief Timer object description
+/*!
+ * \brief Microsecond time variable definition, monotonic since boot
+ */
+typedef uint64_t TimerTimeUs_t;
+
+/*!
+ * \brief Timer object description
  */
 typedef struct TimerEvent_s
 {
-	uint8_t timerNum;			  /**< Used with ESP32 MCU 1 for TX, 2 for RX*/
-	// bool oneShot = true;		  /**< True if it is a one shot timer */
-    bool oneShot;
-	uint32_t Timestamp;			  /**< Current timer value */
-	// uint32_t ReloadValue = 10000; /**< Timer delay value	*/
-    uint32_t ReloadValue;
-	bool IsRunning;				  /**< Is the timer currently running	*/
-	void (*Callback)(void);		  /**< Timer IRQ callback function	*/
-	struct TimerEvent_s *Next;	  /**< Pointer to the next Timer object.	*/
-} TimerEvent_t;
+    TimerTimeUs_t Timestamp;             //! Expiry time of the running timer [us]          定时器到期时间
+    TimerTimeUs_t ReloadValue;           //! Timer delay value [us]                         定时器延迟值
+    bool IsRunning;                      //! Is the timer currently running                 定时器当前是否正在运行
+    bool oneShot;                        //! false: restarted with ReloadValue on expiry    false 时到期后按 ReloadValue 重新启动
+    uint32_t QueueIndex;                 //! Position in the timer queue                    在定时器队列中的位置
+    uint32_t Lateness;                   //! Delay of the last callback after expiry [us]   上次回调相对到期时间的延迟
+    void ( *Callback )( void* context ); //! Timer IRQ callback function                    定时器IRQ回调函数
+    void *Context;                       //! User defined data object pointer to pass back  用户定义的数据对象指针传回
+}TimerEvent_t;
 
 /*!
  * \brief Timer time variable definition
@@ -69,6 +60,17 @@ typedef uint32_t TimerTime_t;
 #define TIMERTIME_T_MAX                             ( ( uint32_t )~0 )
 #endif
 
+/*!
+ * \brief Timer callback lateness statistics
+ */
+typedef struct TimerLateness_s
+{
+    uint32_t Events;                     //! Number of callbacks executed
+    uint32_t Last;                       //! Lateness of the last callback [us]
+    uint32_t Max;                        //! Largest lateness seen [us]
+    uint64_t Total;                      //! Sum of the lateness of all callbacks [us]
+}TimerLateness_t;
+
 /*!
  * \brief Initializes the timer object
  *
@@ -78,7 +80,7 @@ typedef uint32_t TimerTime_t;
  * \param [IN] obj          Structure containing the timer object parameters
  * \param [IN] callback     Function callback called at the end of the timeout
  */
-void TimerInit( TimerEvent_t *obj, void ( *callback )( void ) );           // 定时器初始化
+void TimerInit( TimerEvent_t *obj, void ( *callback )( void* context ) );  // 定时器初始化
 
 /*!
  * \brief Sets a user defined object pointer
@@ -86,12 +88,12 @@ void TimerInit( TimerEvent_t *obj, void ( *callback )( void ) );           // 
  * \param [IN] context User defined data object pointer to pass back
  *                     on IRQ handler callback
  */
-void TimerSetContext( TimerEvent_t *obj, void* context );                           // 设置自定义用户数据指针       项目未使用
+void TimerSetContext( TimerEvent_t *obj, void* context );                           // 设置自定义用户数据指针
 
 /*!
  * Timer IRQ event handler
  */
-void TimerIrqHandler( void );                                                       // 定时器中断处理               项目未使用
+void TimerIrqHandler( void );                                                       // 定时器中断处理，由 RTC 闹钟调用
 
 /*!
  * \brief Starts and adds the timer object to the list of timer events
@@ -122,7 +124,7 @@ void TimerStop( TimerEvent_t *obj );
  *
  * \param [IN] obj Structure containing the timer object parameters
  */
-void TimerReset( TimerEvent_t *obj );                                               // 重置定时器                   项目未使用
+void TimerReset( TimerEvent_t *obj );                                               // 重置定时器
 
 /*!
  * \brief Set timer new timeout value
@@ -132,6 +134,14 @@ void TimerReset( TimerEvent_t *obj );
  */
 void TimerSetValue( TimerEvent_t *obj, uint32_t value );                            // 定时器设置超时时间
 
+/*!
+ * \brief Set timer new timeout value with microsecond resolution
+ *
+ * \param [IN] obj   Structure containing the timer object parameters
+ * \param [IN] value New timer timeout value [us]
+ */
+void TimerSetValueUs( TimerEvent_t *obj, TimerTimeUs_t value );                     // 定时器设置超时时间（微秒）
+
 /*!
  * \brief Read the current time
  *
@@ -142,13 +152,26 @@ TimerTime_t TimerGetCurrentTime( void );
 /*!
  * \brief Return the Time elapsed since a fix moment in Time
  *
- * \remark TimerGetElapsedTime will return 0 for argument 0.
- *
  * \param [IN] past         fix moment in Time
  * \retval time             returns elapsed time
  */
 TimerTime_t TimerGetElapsedTime( TimerTime_t past );                                // 返回至参数时刻以来经过的时间
 
+/*!
+ * \brief Read the current time with microsecond resolution
+ *
+ * \retval time returns current time [us], never wraps around
+ */
+TimerTimeUs_t TimerGetCurrentTimeUs( void );                                        // 获取当前时间（微秒）
+
+/*!
+ * \brief Return the time elapsed since a fix moment in time, in microseconds
+ *
+ * \param [IN] past         fix moment in time [us]
+ * \retval time             returns elapsed time [us]
+ */
+TimerTimeUs_t TimerGetElapsedTimeUs( TimerTimeUs_t past );                          // 返回至参数时刻以来经过的时间（微秒）
+
 /*!
  * \brief Computes the temperature compensation for a period of time on a
  *        specific temperature.
@@ -165,8 +188,36 @@ TimerTime_t TimerTempCompensation( TimerTime_t period, float temperature );
  */
 void TimerProcess( void );                                                          // 处理待处理的计时器事件                   项目未使用
 
+/*!
+ * \brief Reads how late the timer callbacks fired
+ *
+ * \remark The lateness of a callback is the time between the expiry of its
+ *         timer and the moment the callback is called. The lateness of the
+ *         last callback of each timer is also kept in TimerEvent_t.Lateness.
+ *
+ * \param [OUT] lateness Statistics since boot or the last \ref TimerResetLateness
+ */
+void TimerGetLateness( TimerLateness_t *lateness );                                 // 读取定时器回调延迟统计
+
+/*!
+ * \brief Clears the timer callback lateness statistics
+ */
+void TimerResetLateness( void );                                                    // 清除定时器回调延迟统计
+
 #ifdef __cplusplus
 }
+
+/*!
+ * \brief Initializes the timer object with a callback without context, as
+ *        used by the sketches
+ *
+ * \remark The callback is kept in the context pointer, TimerSetContext
+ *         asserts on such a timer.
+ *
+ * \param [IN] obj          Structure containing the timer object parameters
+ * \param [IN] callback     Function callback called at the end of the timeout
+ */
+extern "C++" void TimerInit( TimerEvent_t *obj, void ( *callback )( void ) );
 #endif
 
 #endif // __TIMER_H__
@@ -0,0 +1,86 @@
+/*!
+ * \file      nvmm-board.cpp
+ *
+ * \brief     MAC context storage in the ESP32 NVS partition
+ */
+#include <Arduino.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include "nvmm.h"
+
+#define NVMM_NAMESPACE                              "lorawan"
+
+static nvs_handle NvmmHandle;
+static bool NvmmOpened = false;
+
+static bool NvmmOpen( void )
+{
+    if( NvmmOpened == true )
+    {
+        return true;
+    }
+    // Already done by the Arduino core, returns ESP_OK again
+    if( nvs_flash_init( ) != ESP_OK )
+    {
+        return false;
+    }
+    if( nvs_open( NVMM_NAMESPACE, NVS_READWRITE, &NvmmHandle ) != ESP_OK )
+    {
+        return false;
+    }
+    NvmmOpened = true;
+    return true;
+}
+
+static void NvmmKey( uint8_t record, char *key )
+{
+    key[0] = 'n';
+    key[1] = 'v';
+    key[2] = 'm';
+    key[3] = '0' + record;
+    key[4] = '\0';
+}
+
+uint16_t NvmmWrite( uint8_t record, const uint8_t *src, uint16_t size )
+{
+    char key[5];
+
+    if( ( record >= NVMM_RECORD_MAX ) || ( NvmmOpen( ) == false ) )
+    {
+        return 0;
+    }
+    NvmmKey( record, key );
+    // NVS writes the new entry before it erases the old one
+    if( ( nvs_set_blob( NvmmHandle, key, src, size ) != ESP_OK ) ||
+        ( nvs_commit( NvmmHandle ) != ESP_OK ) )
+    {
+        return 0;
+    }
+    return size;
+}
+
+uint16_t NvmmRead( uint8_t record, uint8_t *dest, uint16_t size )
+{
+    char key[5];
+    size_t length = size;
+
+    if( ( record >= NVMM_RECORD_MAX ) || ( NvmmOpen( ) == false ) )
+    {
+        return 0;
+    }
+    NvmmKey( record, key );
+    if( ( nvs_get_blob( NvmmHandle, key, dest, &length ) != ESP_OK ) || ( length != size ) )
+    {
+        return 0;
+    }
+    return size;
+}
+
+bool NvmmErase( void )
+{
+    if( NvmmOpen( ) == false )
+    {
+        return false;
+    }
+    return ( nvs_erase_all( NvmmHandle ) == ESP_OK ) && ( nvs_commit( NvmmHandle ) == ESP_OK );
+}
@@ -0,0 +1,67 @@
+/*!
+ * \file      nvmm.h
+ *
+ * \brief     Non-volatile storage of the MAC context
+ *
+ * \remark    The context is kept as one record per LoRaMacNvmData_t group, so
+ *            a group is written only when it changed. Writing a record is
+ *            atomic: after a power failure it reads back with either its
+ *            previous or its new content. Records written together are not
+ *            atomic as a whole, NvmDataMgmt writes a commit record last to
+ *            tell a complete store from an interrupted one.
+ *
+ *            ESP32: one blob per record in the "lorawan" namespace of the NVS
+ *            partition, NVS spreads the writes over its pages.
+ *            Host: one file per record, replaced with rename, in the
+ *            directory given to HostNvmmSetDirectory.
+ */
+#ifndef __NVMM_H__
+#define __NVMM_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * Number of records
+ */
+#define NVMM_RECORD_MAX                             8
+
+/*!
+ * \brief Writes a record
+ *
+ * \param [IN] record Record index, lower than NVMM_RECORD_MAX
+ * \param [IN] src    Record content
+ * \param [IN] size   Record size
+ *
+ * \retval Number of bytes written, 0 on failure
+ */
+uint16_t NvmmWrite( uint8_t record, const uint8_t *src, uint16_t size );
+
+/*!
+ * \brief Reads a record
+ *
+ * \param [IN]  record Record index, lower than NVMM_RECORD_MAX
+ * \param [OUT] dest   Record content
+ * \param [IN]  size   Expected record size
+ *
+ * \retval Number of bytes read, 0 when the record is missing or its size differs
+ */
+uint16_t NvmmRead( uint8_t record, uint8_t *dest, uint16_t size );
+
+/*!
+ * \brief Erases all the records
+ *
+ * \retval true if successful
+ */
+bool NvmmErase( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __NVMM_H__
@@ -2,14 +2,65 @@
 #include <esp_timer.h>
 #include <stdint.h>
 #include <esp_attr.h>
+#include <assert.h>
 #include "system/utilities.h"
+#include "boards/mcu/timer.h"
+
+/*!
+ * The RTC tick is 1 us, the esp_timer 64-bit microsecond counter. A single
+ * one-shot esp_timer provides the alarm shared by all the timers of
+ * boards/mcu/timer.cpp.
+ */
+#define MIN_ALARM_DELAY                             50
+
+/*!
+ * Alarm timer handle, created by RtcInit from BoardInitMcu or from the first
+ * TimerStart
+ */
+static esp_timer_handle_t RtcAlarmTimer = NULL;
+
+/*!
+ * Timer reference, RTC ticks at the time the alarm was set
+ */
+static uint32_t RtcTimerContext = 0;
+
+/*!
+ * \brief Alarm expiry, runs in the esp_timer task
+ */
+static void RtcAlarmIrq( void *arg )
+{
+    TimerIrqHandler( );
+}
 
-#define MIN_ALARM_DELAY                             3
+void RtcInit( void )
+{
+    if( __atomic_load_n( &RtcAlarmTimer, __ATOMIC_ACQUIRE ) == NULL )
+    {
+        esp_timer_create_args_t args = { };
+        esp_timer_handle_t timer = NULL;
+        esp_timer_handle_t expected = NULL;
+
+        args.callback = RtcAlarmIrq;
+        args.arg = NULL;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "lorawan_rtc";
+        if( esp_timer_create( &args, &timer ) != ESP_OK )
+        {
+            return;
+        }
+        // Two tasks may start their first timer together, the loser drops its own
+        if( __atomic_compare_exchange_n( &RtcAlarmTimer, &expected, timer, false, __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE ) == false )
+        {
+            esp_timer_delete( timer );
+        }
+    }
+}
 
 uint32_t RtcGetCalendarTime( uint16_t *milliseconds )
 {
     // 获取当前时间（微秒）
-    int64_t time_us = esp_timer_get_time();
+    uint64_t time_us = RtcGetTimeUs( );
 
     // 转换为秒和毫秒
     uint32_t seconds = (uint32_t)(time_us / 1000000ULL);
@@ -53,35 +104,56 @@ void RtcProcess( void )
 
 uint32_t RtcMs2Tick( TimerTime_t milliseconds )
 {
-    return ( uint32_t )( ( ( ( uint64_t )milliseconds ) << 15 ) / 1000 );
+    return milliseconds * 1000;
 }
 
-
-// vvvvvvvvvvvvv以下函数先空实现占位，后续用ticker库代替vvvvvvvvvvvvvvvvvvv
-void RtcSetAlarm( uint32_t timeout )
+TimerTime_t RtcTick2Ms( uint32_t tick )
 {
+    return tick / 1000;
+}
 
+uint64_t IRAM_ATTR RtcGetTimeUs( void )
+{
+    return ( uint64_t )esp_timer_get_time( );
 }
 
-void RtcStopAlarm( void )
+uint32_t RtcGetTimerValue( void )
 {
+    return ( uint32_t )RtcGetTimeUs( );
+}
 
+void RtcSetAlarm( uint32_t timeout )
+{
+    // Called inside BoardDisableIrq, the timer must already exist: creating it
+    // allocates, which a port critical section does not allow. TimerStart
+    // creates it, it is only missing when esp_timer_create failed.
+    assert( RtcAlarmTimer != NULL );
+    RtcSetTimerContext( );
+    // Restarting a running esp_timer fails, stop it first
+    esp_timer_stop( RtcAlarmTimer );
+    esp_timer_start_once( RtcAlarmTimer, timeout );
 }
 
+void RtcStopAlarm( void )
+{
+    if( RtcAlarmTimer != NULL )
+    {
+        esp_timer_stop( RtcAlarmTimer );
+    }
+}
 
 uint32_t RtcSetTimerContext( void )
 {
-    return 0;
+    RtcTimerContext = RtcGetTimerValue( );
+    return RtcTimerContext;
 }
 
 uint32_t RtcGetTimerContext( void )
 {
-    return 0;
+    return RtcTimerContext;
 }
 
 uint32_t RtcGetTimerElapsedTime( void )
 {
-    return 0;
+    return RtcGetTimerValue( ) - RtcTimerContext;
 }
-
-// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
\ No newline at end of file
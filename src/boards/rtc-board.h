@@ -62,9 +62,10 @@ typedef uint32_t TimerTime_t;
 /*!
  * \brief Initializes the RTC timer
  *
- * \remark The timer is based on the RTC
+ * \remark The timer is based on the RTC. Does nothing once the alarm exists,
+ *         TimerStart calls it before each start.
  */
-void RtcInit( void );                                                 // 初始化 RTC 计时器          未使用
+void RtcInit( void );                                                 // 初始化 RTC 计时器（esp_timer 闹钟）     已实现
 
 /*!
  * \brief Returns the minimum timeout value
@@ -79,7 +80,7 @@ uint32_t RtcGetMinimumTimeout( void );                                // 返回
  * \param[IN] milliseconds Time in milliseconds
  * \retval returns time in timer ticks
  */
-uint32_t RtcMs2Tick( TimerTime_t milliseconds );                      // 将毫秒时间转换为刻度时间    已实现
+uint32_t RtcMs2Tick( TimerTime_t milliseconds );                      // 将毫秒时间转换为刻度时间（1 刻度 = 1 us）    已实现
 
 /*!
  * \brief converts time in ticks to time in ms
@@ -87,7 +88,7 @@ uint32_t RtcMs2Tick( TimerTime_t milliseconds );                      // 将毫
  * \param[IN] time in timer ticks
  * \retval returns time in milliseconds
  */
-TimerTime_t RtcTick2Ms( uint32_t tick );                              // 将以刻度为单位的时间转换为以毫秒为单位的时间       未使用
+TimerTime_t RtcTick2Ms( uint32_t tick );                              // 将以刻度为单位的时间转换为以毫秒为单位的时间       已实现
 
 /*!
  * \brief Performs a delay of milliseconds by polling RTC
@@ -117,12 +118,12 @@ int16_t RtcGetMcuWakeUpTime( void );                                  // 返回
  *
  * \param timeout [IN] Duration of the Timer ticks
  */
-void RtcSetAlarm( uint32_t timeout );                                 // 设置闹钟               不实现，相关功能改用esp32 Ticker库实现
+void RtcSetAlarm( uint32_t timeout );                                 // 设置闹钟               已实现，所有定时器共用一个 esp_timer
 
 /*!
  * \brief Stops the Alarm
  */
-void RtcStopAlarm( void );                                            // 停止闹钟               不实现，相关功能改用esp32 Ticker库实现
+void RtcStopAlarm( void );                                            // 停止闹钟               已实现
 
 /*!
  * \brief Starts wake up alarm
@@ -138,14 +139,14 @@ void RtcStartAlarm( uint32_t timeout );                               // 启动
  *
  * \retval value Timer reference value in ticks
  */
-uint32_t RtcSetTimerContext( void );                                  // 设置 RTC 定时器参考    不实现，相关功能改用esp32 Ticker库实现
+uint32_t RtcSetTimerContext( void );                                  // 设置 RTC 定时器参考    已实现
   
 /*!
  * \brief Gets the RTC timer reference
  *
  * \retval value Timer value in ticks
  */
-uint32_t RtcGetTimerContext( void );                                  // 获取 RTC 定时器参考    不实现，相关功能改用esp32 Ticker库实现
+uint32_t RtcGetTimerContext( void );                                  // 获取 RTC 定时器参考    已实现
 
 /*!
  * \brief Gets the system time with the number of seconds elapsed since epoch
@@ -160,14 +161,23 @@ uint32_t RtcGetCalendarTime( uint16_t *milliseconds );                // 获取
  *
  * \retval RTC Timer value
  */
-uint32_t RtcGetTimerValue( void );                                    // 获取 RTC 定时器值          未使用
+uint32_t RtcGetTimerValue( void );                                    // 获取 RTC 定时器值          已实现
+
+/*!
+ * \brief Get the 64-bit RTC time
+ *
+ * \remark The RTC tick is 1 us, this value never wraps around.
+ *
+ * \retval RTC time since boot in microseconds
+ */
+uint64_t RtcGetTimeUs( void );                                        // 获取 64 位微秒单调时间      已实现
 
 /*!
  * \brief Get the RTC timer elapsed time since the last Alarm was set
  *
  * \retval RTC Elapsed time since the last alarm in ticks.
  */
-uint32_t RtcGetTimerElapsedTime( void );                              // 获取自上次设置闹钟以来 RTC 计时器经过的时间    不实现，相关功能改用esp32 Ticker库实现
+uint32_t RtcGetTimerElapsedTime( void );                              // 获取自上次设置闹钟以来 RTC 计时器经过的时间    已实现
 
 /*!
  * \brief Writes data0 and data1 to the RTC backup registers
@@ -0,0 +1,82 @@
+/*!
+ * \file      spi-arbiter.cpp
+ *
+ * \brief     SPI bus arbiter shared by the SX126x and the on-board LCD
+ */
+#include "spi-arbiter.h"
+
+static SemaphoreHandle_t SpiBusMutex = NULL;
+
+/*!
+ * Radio requests blocked on the mutex, low priority requests back off while
+ * it is not zero
+ */
+static volatile uint32_t SpiBusHighWaiting = 0;
+
+SemaphoreHandle_t SpiBusInit( void )
+{
+    if( SpiBusMutex == NULL )
+    {
+        // A mutex rather than a binary semaphore, so the owner inherits the
+        // priority of the LoRa task while it waits. Recursive, so a task
+        // holding SPI_MUTEX can still draw on the screen or use the radio.
+        SpiBusMutex = xSemaphoreCreateRecursiveMutex( );
+    }
+    return SpiBusMutex;
+}
+
+bool SpiBusAcquire( eSpiBusPriority_t priority, TickType_t timeout )
+{
+    TickType_t start = xTaskGetTickCount( );
+
+    if( SpiBusInit( ) == NULL )
+    {
+        return false;
+    }
+
+    if( priority == SPI_BUS_PRIORITY_HIGH )
+    {
+        __atomic_add_fetch( &SpiBusHighWaiting, 1, __ATOMIC_SEQ_CST );
+        bool taken = ( xSemaphoreTakeRecursive( SpiBusMutex, timeout ) == pdTRUE );
+        __atomic_sub_fetch( &SpiBusHighWaiting, 1, __ATOMIC_SEQ_CST );
+        return taken;
+    }
+
+    // The owner nests without backing off, the radio waits for it anyway
+    if( xSemaphoreGetMutexHolder( SpiBusMutex ) == xTaskGetCurrentTaskHandle( ) )
+    {
+        return xSemaphoreTakeRecursive( SpiBusMutex, 0 ) == pdTRUE;
+    }
+
+    while( 1 )
+    {
+        TickType_t elapsed = xTaskGetTickCount( ) - start;
+        TickType_t remaining = ( timeout == portMAX_DELAY ) ? portMAX_DELAY : ( ( elapsed < timeout ) ? ( timeout - elapsed ) : 0 );
+
+        if( xSemaphoreTakeRecursive( SpiBusMutex, remaining ) != pdTRUE )
+        {
+            return false;
+        }
+        if( SpiBusPending( ) == false )
+        {
+            return true;
+        }
+        // A radio request queued up meanwhile, let it go first
+        xSemaphoreGiveRecursive( SpiBusMutex );
+        if( ( timeout != portMAX_DELAY ) && ( ( xTaskGetTickCount( ) - start ) >= timeout ) )
+        {
+            return false;
+        }
+        vTaskDelay( 1 );
+    }
+}
+
+void SpiBusRelease( void )
+{
+    xSemaphoreGiveRecursive( SpiBusMutex );
+}
+
+bool SpiBusPending( void )
+{
+    return __atomic_load_n( &SpiBusHighWaiting, __ATOMIC_SEQ_CST ) != 0;
+}
@@ -0,0 +1,68 @@
+/*!
+ * \file      spi-arbiter.h
+ *
+ * \brief     SPI bus arbiter shared by the SX126x and the on-board LCD
+ *
+ * \remark    The radio and the screen sit on the same SPI peripheral. Every
+ *            transaction holds the arbiter mutex, which is also the SPI_MUTEX
+ *            handed to the application. Radio requests have priority:
+ *            SpiBusPending tells a low priority owner that a radio request
+ *            waits, and the LCD interface then releases the bus between two
+ *            chunks of SPI_BUS_LCD_CHUNK bytes. A low priority SpiBusAcquire
+ *            that gets the mutex while a radio request waits gives it back
+ *            and retries.
+ *
+ *            The arbiter mutex is recursive and owned by the task that took
+ *            it: only that task gives it back, never an interrupt. A task
+ *            holding it may take it again, from the screen or the radio
+ *            driver, without blocking. The application takes SPI_MUTEX with
+ *            xSemaphoreTakeRecursive and gives it with xSemaphoreGiveRecursive.
+ *            A plain xSemaphoreTake does not nest: the first recursive give
+ *            of the library inside it releases the lock early.
+ */
+#ifndef __SPI_ARBITER_H__
+#define __SPI_ARBITER_H__
+
+#include <Arduino.h>
+
+#ifndef SPI_BUS_LCD_CHUNK
+#define SPI_BUS_LCD_CHUNK 1024             ///< Bytes an LCD transfer sends before it checks for a waiting radio request
+#endif
+
+/*!
+ * Bus request priority
+ */
+typedef enum
+{
+    SPI_BUS_PRIORITY_LOW = 0,               /**<Screen and application transfers>*/
+    SPI_BUS_PRIORITY_HIGH,                  /**<Radio transfers>*/
+} eSpiBusPriority_t;
+
+/*!
+ * \brief Creates the arbiter mutex on first use
+ *
+ * \retval Arbiter mutex, the handle behind SPI_MUTEX
+ */
+SemaphoreHandle_t SpiBusInit( void );
+
+/*!
+ * \brief Takes the bus
+ *
+ * \param [IN] priority Request priority
+ * \param [IN] timeout  Ticks to wait, portMAX_DELAY waits forever
+ *
+ * \retval true when the bus is held
+ */
+bool SpiBusAcquire( eSpiBusPriority_t priority, TickType_t timeout = portMAX_DELAY );
+
+/*!
+ * \brief Gives the bus back, from the task that took it
+ */
+void SpiBusRelease( void );
+
+/*!
+ * \brief Tells a low priority owner whether a radio request waits for the bus
+ */
+bool SpiBusPending( void );
+
+#endif // __SPI_ARBITER_H__
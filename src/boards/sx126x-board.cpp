@@ -40,15 +40,48 @@ Maintainer: Miguel Luis and Gregory Cristian
 #include "boards/mcu/spi_board.h"
 // #include "radio/sx126x/sx126x.h"
 #include "sx126x-board.h"
+#include "spi-arbiter.h"
 #include <driver/rtc_io.h>
 
 static RadioOperatingModes_t OperatingMode;
 
-SPISettings spiSettings = SPISettings(2000000, MSBFIRST, SPI_MODE0);
+static uint32_t spiClock = (SX126X_SPI_CLOCK > SX126X_SPI_CLOCK_MAX) ? SX126X_SPI_CLOCK_MAX : SX126X_SPI_CLOCK;
+
+SPISettings spiSettings = SPISettings(spiClock, MSBFIRST, SPI_MODE0);
+
+// Bus usage counters, see SX126xGetSpiStats
+static SX126xSpiStats_t spiStats[SX126X_SPI_ACCOUNT_COUNT];
+static SX126xSpiAccount_t spiAccount = SX126X_SPI_ACCOUNT_OTHER;
 
 // No need to initialize DIO3 as output everytime, do it once and remember it
 bool dio3IsOutput = false;
 
+// Given by the BUSY falling edge, see SX126xWaitOnBusy
+static SemaphoreHandle_t busySem = NULL;
+static DioIrqHandler *busyFaultHandler = NULL;
+static uint32_t busyTimeouts = 0;
+
+static void IRAM_ATTR SX126xOnBusyFalling(void)
+{
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	xSemaphoreGiveFromISR(busySem, &higherPriorityTaskWoken);
+	if (higherPriorityTaskWoken == pdTRUE)
+	{
+		portYIELD_FROM_ISR();
+	}
+}
+
+/**@brief Arms the BUSY falling edge notification
+ */
+static void SX126xIoBusyInit(void)
+{
+	if (busySem == NULL)
+	{
+		busySem = xSemaphoreCreateBinary();
+	}
+	attachInterrupt(LORA_BUSY, SX126xOnBusyFalling, FALLING);
+}
+
 void SX126xIOInit(void)
 {
 	rtc_gpio_hold_dis(gpio_num_t(LORA_SS));
@@ -64,6 +97,7 @@ void SX126xIOInit(void)
     delay(10);
     digitalWrite(LORA_RST, HIGH);
     delay(20);
+    SX126xIoBusyInit();
 
 
 // 新逻辑
@@ -113,6 +147,7 @@ void SX126xIoReInit(void)
 	digitalWrite(LORA_SS, HIGH);
 	pinMode(LORA_BUSY, INPUT);
 	pinMode(LORA_DIO1, INPUT);
+	SX126xIoBusyInit();
 	// pinMode(LORA_RST, OUTPUT);
 	// digitalWrite(LORA_RST, HIGH);
 
@@ -129,6 +164,7 @@ void SX126xIoDeInit(void)
 {
 	dio3IsOutput = false;
 	detachInterrupt(LORA_DIO1);
+	detachInterrupt(LORA_BUSY);
 	pinMode(LORA_SS, INPUT);
 	pinMode(LORA_BUSY, INPUT);
 	pinMode(LORA_DIO1, INPUT);
@@ -145,104 +181,211 @@ void SX126xReset(void)
 	dio3IsOutput = false;
 }
 
-void SX126xWaitOnBusy(void)
+void SX126xIoFaultInit(DioIrqHandler faultHandler)
 {
-	int timeout = 1000;
+	busyFaultHandler = faultHandler;
+}
+
+bool SX126xWaitOnBusy(void)
+{
+	if (digitalRead(LORA_BUSY) == LOW)
+	{
+		return true;
+	}
+
+	// Short commands clear BUSY within tens of us, spin for those. Long ones
+	// (calibration, TCXO start up, wake up) block the task until the falling
+	// edge, unless the scheduler cannot be used from here.
+	bool canBlock = (busySem != NULL) && (xPortInIsrContext() == pdFALSE) &&
+					(xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+	TimerTimeUs_t start = TimerGetCurrentTimeUs();
+
 	while (digitalRead(LORA_BUSY) == HIGH)
 	{
-		delay(1);
-		timeout -= 1;
-		//Serial.printf("1");
-		if (timeout < 0)
+		TimerTimeUs_t elapsed = TimerGetCurrentTimeUs() - start;
+
+		if (elapsed >= SX126X_BUSY_TIMEOUT_US)
 		{
-			/// \todo This error should be reported to the main app
-			//LOG_LIB("LORA", "[SX126xWaitOnBusy] Timeout waiting for BUSY low");
-			return;
+			busyTimeouts++;
+			if (busyFaultHandler != NULL)
+			{
+				busyFaultHandler();
+			}
+			return false;
+		}
+		if ((elapsed >= SX126X_BUSY_SPIN_US) && (canBlock == true))
+		{
+			// Drop an edge left over from a previous command before sampling again
+			xSemaphoreTake(busySem, 0);
+			if (digitalRead(LORA_BUSY) == LOW)
+			{
+				break;
+			}
+			xSemaphoreTake(busySem, pdMS_TO_TICKS((SX126X_BUSY_TIMEOUT_US - elapsed) / 1000) + 1);
 		}
 	}
+	return true;
 }
 
-void SX126xWakeup(void)
+uint32_t SX126xGetBusyTimeouts(void)
 {
-	dio3IsOutput = false;
-	BoardDisableIrq();
+	return busyTimeouts;
+}
+
+/**@brief Runs one chip select cycle on the radio bus, the caller holds the bus
+ *
+ * The header (opcode, address, NOP) and the payload are each clocked out as
+ * a single burst, which lets the SPI driver use its FIFO/DMA instead of one
+ * call per byte.
+ *
+ * \param  header     Opcode and address bytes
+ * \param  headerSize Number of header bytes
+ * \param  tx         Payload to write, NULL when reading
+ * \param  rx         Buffer receiving the payload, NULL when writing
+ * \param  size       Payload size
+ */
+static void SX126xSpiTransferLocked(const uint8_t *header, uint16_t headerSize, const uint8_t *tx, uint8_t *rx, uint16_t size)
+{
+	SX126xSpiStats_t *stats = &spiStats[spiAccount];
+	TimerTimeUs_t start = TimerGetCurrentTimeUs();
 
 	digitalWrite(LORA_SS, LOW);
 
 	SPI_LORA.beginTransaction(spiSettings);
-	SPI_LORA.transfer(RADIO_GET_STATUS);
-	SPI_LORA.transfer(0x00);
+	SPI_LORA.transferBytes(header, NULL, headerSize);
+	if (size > 0)
+	{
+		if (rx != NULL)
+		{
+			// The radio expects NOPs while it shifts the data out
+			memset(rx, 0x00, size);
+			SPI_LORA.transferBytes(rx, rx, size);
+		}
+		else
+		{
+			SPI_LORA.transferBytes(tx, NULL, size);
+		}
+	}
 	SPI_LORA.endTransaction();
-	digitalWrite(LORA_SS, HIGH);
 
-	// Wait for chip to be ready.
-	SX126xWaitOnBusy();
+	digitalWrite(LORA_SS, HIGH);
 
+	uint32_t duration = (uint32_t)(TimerGetCurrentTimeUs() - start);
+	// Same critical section as the getter and the reset, which may run on the other core.
+	// It nests inside the one of SX126xWakeup.
+	BoardDisableIrq();
+	stats->Transactions++;
+	stats->Bytes += headerSize + size;
+	stats->BusTimeUs += duration;
+	if (duration > stats->MaxTimeUs)
+	{
+		stats->MaxTimeUs = duration;
+	}
 	BoardEnableIrq();
 }
 
-void SX126xWriteCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
+/**@brief Runs one chip select cycle on the radio bus at radio priority
+ */
+static void SX126xSpiTransfer(const uint8_t *header, uint16_t headerSize, const uint8_t *tx, uint8_t *rx, uint16_t size)
 {
-	//printf("%s()\r\n",__FUNCTION__);
-	SX126xCheckDeviceReady();
+	SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
+	SX126xSpiTransferLocked(header, headerSize, tx, rx, size);
+	SpiBusRelease();
+}
 
-	digitalWrite(LORA_SS, LOW);
+void SX126xSetSpiClock(uint32_t clock)
+{
+	if (clock > SX126X_SPI_CLOCK_MAX)
+	{
+		clock = SX126X_SPI_CLOCK_MAX;
+	}
+	spiClock = clock;
+	spiSettings = SPISettings(spiClock, MSBFIRST, SPI_MODE0);
+}
 
-	SPI_LORA.beginTransaction(spiSettings);
-	SPI_LORA.transfer((uint8_t)command);
+uint32_t SX126xGetSpiClock(void)
+{
+	return spiClock;
+}
 
-	for (uint16_t i = 0; i < size; i++)
+SX126xSpiAccount_t SX126xSetSpiAccount(SX126xSpiAccount_t account)
+{
+	SX126xSpiAccount_t previous = spiAccount;
+	if (account < SX126X_SPI_ACCOUNT_COUNT)
 	{
-		SPI_LORA.transfer(buffer[i]);
+		spiAccount = account;
 	}
+	return previous;
+}
 
-	SPI_LORA.endTransaction();
-	digitalWrite(LORA_SS, HIGH);
-
-	if (command != RADIO_SET_SLEEP)
+void SX126xGetSpiStats(SX126xSpiAccount_t account, SX126xSpiStats_t *stats)
+{
+	if ((account < SX126X_SPI_ACCOUNT_COUNT) && (stats != NULL))
 	{
-		SX126xWaitOnBusy();
+		BoardDisableIrq();
+		*stats = spiStats[account];
+		BoardEnableIrq();
 	}
 }
 
-void SX126xReadCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
+void SX126xResetSpiStats(void)
 {
-	SX126xCheckDeviceReady();
+	BoardDisableIrq();
+	memset(spiStats, 0, sizeof(spiStats));
+	BoardEnableIrq();
+}
 
-	digitalWrite(LORA_SS, LOW);
+void SX126xWakeup(void)
+{
+	uint8_t header[2] = {RADIO_GET_STATUS, 0x00};
 
-	SPI_LORA.beginTransaction(spiSettings);
-	SPI_LORA.transfer((uint8_t)command);
-	SPI_LORA.transfer(0x00);
-	for (uint16_t i = 0; i < size; i++)
-	{
-		buffer[i] = SPI_LORA.transfer(0x00);
-	}
+	dio3IsOutput = false;
+	// The bus is taken before the critical section, waiting for it may block
+	SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
+	BoardDisableIrq();
 
-	SPI_LORA.endTransaction();
-	digitalWrite(LORA_SS, HIGH);
+	SX126xSpiTransferLocked(header, sizeof(header), NULL, NULL, 0);
+
+	BoardEnableIrq();
+	SpiBusRelease();
 
+	// Wait for chip to be ready, outside of the critical section so the
+	// task can sleep until BUSY falls.
 	SX126xWaitOnBusy();
 }
 
-void SX126xWriteRegisters(uint16_t address, uint8_t *buffer, uint16_t size)
+void SX126xWriteCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
 {
-	SX126xCheckDeviceReady();
+	uint8_t header[1] = {(uint8_t)command};
 
-	digitalWrite(LORA_SS, LOW);
+	SX126xCheckDeviceReady();
 
-	SPI_LORA.beginTransaction(spiSettings);
-	SPI_LORA.transfer(RADIO_WRITE_REGISTER);
-	SPI_LORA.transfer((address & 0xFF00) >> 8);
-	SPI_LORA.transfer(address & 0x00FF);
+	SX126xSpiTransfer(header, sizeof(header), buffer, NULL, size);
 
-	for (uint16_t i = 0; i < size; i++)
+	if (command != RADIO_SET_SLEEP)
 	{
-		SPI_LORA.transfer(buffer[i]);
+		SX126xWaitOnBusy();
 	}
+}
 
-	SPI_LORA.endTransaction();
-	digitalWrite(LORA_SS, HIGH);
+void SX126xReadCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
+{
+	uint8_t header[2] = {(uint8_t)command, 0x00};
+
+	SX126xCheckDeviceReady();
+
+	SX126xSpiTransfer(header, sizeof(header), NULL, buffer, size);
+
+	SX126xWaitOnBusy();
+}
+
+void SX126xWriteRegisters(uint16_t address, uint8_t *buffer, uint16_t size)
+{
+	uint8_t header[3] = {RADIO_WRITE_REGISTER, (uint8_t)((address & 0xFF00) >> 8), (uint8_t)(address & 0x00FF)};
+
+	SX126xCheckDeviceReady();
+
+	SX126xSpiTransfer(header, sizeof(header), buffer, NULL, size);
 
 	SX126xWaitOnBusy();
 }
@@ -254,21 +397,11 @@ void SX126xWriteRegister(uint16_t address, uint8_t value)
 
 void SX126xReadRegisters(uint16_t address, uint8_t *buffer, uint16_t size)
 {
-	SX126xCheckDeviceReady();
+	uint8_t header[4] = {RADIO_READ_REGISTER, (uint8_t)((address & 0xFF00) >> 8), (uint8_t)(address & 0x00FF), 0x00};
 
-	digitalWrite(LORA_SS, LOW);
+	SX126xCheckDeviceReady();
 
-	SPI_LORA.beginTransaction(spiSettings);
-	SPI_LORA.transfer(RADIO_READ_REGISTER);
-	SPI_LORA.transfer((address & 0xFF00) >> 8);
-	SPI_LORA.transfer(address & 0x00FF);
-	SPI_LORA.transfer(0x00);
-	for (uint16_t i = 0; i < size; i++)
-	{
-		buffer[i] = SPI_LORA.transfer(0x00);
-	}
-	SPI_LORA.endTransaction();
-	digitalWrite(LORA_SS, HIGH);
+	SX126xSpiTransfer(header, sizeof(header), NULL, buffer, size);
 
 	SX126xWaitOnBusy();
 }
@@ -282,39 +415,22 @@ uint8_t SX126xReadRegister(uint16_t address)
 
 void SX126xWriteBuffer(uint8_t offset, uint8_t *buffer, uint8_t size)
 {
-	SX126xCheckDeviceReady();
+	uint8_t header[2] = {RADIO_WRITE_BUFFER, offset};
 
-	digitalWrite(LORA_SS, LOW);
+	SX126xCheckDeviceReady();
 
-	SPI_LORA.beginTransaction(spiSettings);
-	SPI_LORA.transfer(RADIO_WRITE_BUFFER);
-	SPI_LORA.transfer(offset);
-	for (uint16_t i = 0; i < size; i++)
-	{
-		SPI_LORA.transfer(buffer[i]);
-	}
-	SPI_LORA.endTransaction();
-	digitalWrite(LORA_SS, HIGH);
+	SX126xSpiTransfer(header, sizeof(header), buffer, NULL, size);
 
 	SX126xWaitOnBusy();
 }
 
 void SX126xReadBuffer(uint8_t offset, uint8_t *buffer, uint8_t size)
 {
-	SX126xCheckDeviceReady();
+	uint8_t header[3] = {RADIO_READ_BUFFER, offset, 0x00};
 
-	digitalWrite(LORA_SS, LOW);
+	SX126xCheckDeviceReady();
 
-	SPI_LORA.beginTransaction(spiSettings);
-	SPI_LORA.transfer(RADIO_READ_BUFFER);
-	SPI_LORA.transfer(offset);
-	SPI_LORA.transfer(0x00);
-	for (uint16_t i = 0; i < size; i++)
-	{
-		buffer[i] = SPI_LORA.transfer(0x00);
-	}
-	SPI_LORA.endTransaction();
-	digitalWrite(LORA_SS, HIGH);
+	SX126xSpiTransfer(header, sizeof(header), NULL, buffer, size);
 
 	SX126xWaitOnBusy();
 }
@@ -345,6 +461,7 @@ static void SX126xDio3Control(bool state)
 
 		// Read 0x0580
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_READ_REGISTER);
@@ -354,9 +471,11 @@ static void SX126xDio3Control(bool state)
 		reg_0x0580 = SPI_LORA.transfer(0x00);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		// Read 0x0583
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_READ_REGISTER);
@@ -366,9 +485,11 @@ static void SX126xDio3Control(bool state)
 		reg_0x0583 = SPI_LORA.transfer(0x00);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		// Read 0x0584
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_READ_REGISTER);
@@ -378,9 +499,11 @@ static void SX126xDio3Control(bool state)
 		reg_0x0584 = SPI_LORA.transfer(0x00);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		// Read 0x0585
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_READ_REGISTER);
@@ -390,10 +513,12 @@ static void SX126xDio3Control(bool state)
 		reg_0x0585 = SPI_LORA.transfer(0x00);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		// Write 0x0580
 		// SX126xWriteRegister(0x0580, reg_0x0580 | 0x08);
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_WRITE_REGISTER);
@@ -402,9 +527,11 @@ static void SX126xDio3Control(bool state)
 		SPI_LORA.transfer(reg_0x0580 | 0x08);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		// Write 0x0583
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_WRITE_REGISTER);
@@ -413,9 +540,11 @@ static void SX126xDio3Control(bool state)
 		SPI_LORA.transfer(reg_0x0583 & ~0x08);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		// Write 0x0584
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_WRITE_REGISTER);
@@ -424,9 +553,11 @@ static void SX126xDio3Control(bool state)
 		SPI_LORA.transfer(reg_0x0584 & ~0x08);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		// Write 0x0585
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_WRITE_REGISTER);
@@ -435,9 +566,11 @@ static void SX126xDio3Control(bool state)
 		SPI_LORA.transfer(reg_0x0585 & ~0x08);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		// Write 0x0920
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_WRITE_REGISTER);
@@ -446,6 +579,7 @@ static void SX126xDio3Control(bool state)
 		SPI_LORA.transfer(0x06);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		dio3IsOutput = true;
 	}
@@ -454,6 +588,7 @@ static void SX126xDio3Control(bool state)
 	{
 		// Set DIO3 High
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_READ_REGISTER);
@@ -463,8 +598,10 @@ static void SX126xDio3Control(bool state)
 		reg_0x0920 = SPI_LORA.transfer(0x00);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_WRITE_REGISTER);
@@ -473,11 +610,13 @@ static void SX126xDio3Control(bool state)
 		SPI_LORA.transfer(reg_0x0920 | 0x08);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 	}
 	else
 	{
 		// Set DIO3 Low
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_READ_REGISTER);
@@ -487,8 +626,10 @@ static void SX126xDio3Control(bool state)
 		reg_0x0920 = SPI_LORA.transfer(0x00);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 
 		SX126xWaitOnBusy();
+		SpiBusAcquire(SPI_BUS_PRIORITY_HIGH);
 		digitalWrite(LORA_SS, LOW);
 		SPI_LORA.beginTransaction(spiSettings);
 		SPI_LORA.transfer(RADIO_WRITE_REGISTER);
@@ -497,6 +638,7 @@ static void SX126xDio3Control(bool state)
 		SPI_LORA.transfer(reg_0x0920 & ~0x08);
 		SPI_LORA.endTransaction();
 		digitalWrite(LORA_SS, HIGH);
+		SpiBusRelease();
 	}
 }
 
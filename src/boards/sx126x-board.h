@@ -90,9 +90,38 @@ void SX126xIoDeInit(void);
  */
 void SX126xReset(void);
 
-/**@brief Blocking loop to wait while the Busy pin in high
+/**@brief Spin time before the BUSY wait sleeps on the falling edge [us]
  */
-void SX126xWaitOnBusy(void);
+#ifndef SX126X_BUSY_SPIN_US
+#define SX126X_BUSY_SPIN_US 100
+#endif
+
+/**@brief Longest time the radio may keep BUSY high [us]
+ */
+#ifndef SX126X_BUSY_TIMEOUT_US
+#define SX126X_BUSY_TIMEOUT_US 1000000
+#endif
+
+/**@brief Waits while the Busy pin is high
+ *
+ * \remark Spins for \ref SX126X_BUSY_SPIN_US, then sleeps until the BUSY
+ *         falling edge when called from a task
+ *
+ * \retval status false when BUSY stayed high for \ref SX126X_BUSY_TIMEOUT_US
+ */
+bool SX126xWaitOnBusy(void);
+
+/**@brief Registers the handler called when the BUSY wait times out
+ *
+ * \param  faultHandler Called from the context that issued the command
+ */
+void SX126xIoFaultInit(DioIrqHandler faultHandler);
+
+/**@brief Gets the number of BUSY wait timeouts since boot
+ *
+ * \retval count Number of timeouts
+ */
+uint32_t SX126xGetBusyTimeouts(void);
 
 /**@brief Wakes up the radio
  */
@@ -191,6 +220,68 @@ uint32_t SX126xGetBoardTcxoWakeupTime( void );
 
 uint8_t SX126xGetDeviceId( void );
 
+/**@brief Default SPI clock of the radio bus [Hz]
+ *
+ * \remark Can be overridden from the build flags, see \ref SX126xSetSpiClock
+ */
+#ifndef SX126X_SPI_CLOCK
+#define SX126X_SPI_CLOCK 2000000
+#endif
+
+/**@brief Highest SPI clock supported by the SX126x [Hz]
+ */
+#define SX126X_SPI_CLOCK_MAX 16000000
+
+/**@brief Groups of SPI transactions counted separately
+ */
+typedef enum
+{
+	SX126X_SPI_ACCOUNT_OTHER = 0, //!< Configuration and everything not listed below
+	SX126X_SPI_ACCOUNT_SEND,	  //!< Transactions issued by RadioSend
+	SX126X_SPI_ACCOUNT_IRQ,		  //!< Transactions issued while processing radio interrupts
+	SX126X_SPI_ACCOUNT_COUNT
+} SX126xSpiAccount_t;
+
+/**@brief SPI bus usage counters
+ */
+typedef struct SX126xSpiStats_s
+{
+	uint32_t Transactions; //!< Number of chip select cycles
+	uint32_t Bytes;		   //!< Bytes clocked on the bus, opcode and address included
+	uint32_t BusTimeUs;	   //!< Time spent with chip select active [us]
+	uint32_t MaxTimeUs;	   //!< Longest single transaction [us]
+} SX126xSpiStats_t;
+
+/**@brief Sets the SPI clock of the radio bus
+ *
+ * \param  clock SPI clock [Hz], limited to \ref SX126X_SPI_CLOCK_MAX
+ */
+void SX126xSetSpiClock(uint32_t clock);
+
+/**@brief Gets the SPI clock of the radio bus
+ *
+ * \retval clock SPI clock [Hz]
+ */
+uint32_t SX126xGetSpiClock(void);
+
+/**@brief Selects the counters the next SPI transactions are added to
+ *
+ * \param  account Counters to use
+ * \retval previous Counters used until now, to be restored by the caller
+ */
+SX126xSpiAccount_t SX126xSetSpiAccount(SX126xSpiAccount_t account);
+
+/**@brief Reads the SPI bus usage counters
+ *
+ * \param  account Counters to read
+ * \param  stats   Copy of the counters
+ */
+void SX126xGetSpiStats(SX126xSpiAccount_t account, SX126xSpiStats_t *stats);
+
+/**@brief Clears all the SPI bus usage counters
+ */
+void SX126xResetSpiStats(void);
+
 /**@brief Radio hardware and global parameters
  */
 extern SX126x_t SX126x;
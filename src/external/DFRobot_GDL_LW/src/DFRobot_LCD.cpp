@@ -14,6 +14,7 @@
 #include "DFRobot_GDL_LW.h"
 #include "Interface/DFRobot_IF.h"
 #include "Drivers/DFRobot_LCDType.h"
+#include "../../../boards/spi-arbiter.h"
 
 namespace LoRaWAN {
 
@@ -243,10 +244,8 @@ DFRobot_ST7735_80x160_HW_SPI::DFRobot_ST7735_80x160_HW_SPI(uint8_t dc, uint8_t c
   :DFRobot_GDL(&gdl_Dev_ST7735S_R80x160_HW_SPI, ST7735S_R80x160_IC_WIDTH, ST7735S_R80x160_IC_HEIGHT, dc, cs, rst, bl,pspi){
   setDriverICResolution(ST7735S_R80x160_IC_WIDTH, ST7735S_R80x160_IC_HEIGHT);
 
-  // 在GDL屏幕构造时创建spi锁
-  spimutex = xSemaphoreCreateBinary();
-  xSemaphoreGive(spimutex);
-  xSemaphoreTake(spimutex, 10);
+  // spi锁即屏幕与射频共用的总线仲裁锁
+  spimutex = SpiBusInit();
 
   madctlReg.madctl = ST7735S_MADCTL;
   madctlReg.args.value = ST7735S_R80x160_MADCTL_RGB;
@@ -263,7 +262,6 @@ void DFRobot_ST7735_80x160_HW_SPI::begin(uint32_t freq)
 }
 void DFRobot_ST7735_80x160_HW_SPI::begin(devInterfaceInit fun, uint32_t freq)
 {
-  xSemaphoreGive(spimutex);   // 启动时释放一个SPI资源
   gdlInit(freq,fun);
   initDisplay();
   setRotation(1);
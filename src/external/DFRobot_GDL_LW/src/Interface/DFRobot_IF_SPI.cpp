@@ -1,5 +1,6 @@
 #include "DFRobot_IF.h"
 #include "../DFRobot_Type.h"
+#include "../../../../boards/spi-arbiter.h"
 
 #if defined(__AVR__)
 #define AVR_SPI_WRITE(d) for(SPDR = d; (!(SPSR & _BV(SPIF))); )
@@ -9,14 +10,24 @@
 
 namespace LoRaWAN{
 
-extern SemaphoreHandle_t spimutex;
+// 射频请求在等待总线时，在两块数据之间让出总线，之后接着发送
+static void interfaceSpiYield(sGdlIF_t *p)
+{
+  if(!SpiBusPending()) return;
+  PIN_HIGH(p->pinList[IF_PIN_CS]);
+  p->pro.spi->endTransaction();
+  SpiBusRelease();
+  SpiBusAcquire(SPI_BUS_PRIORITY_LOW, SPIMUTEX_BLOCK_TIME);
+  p->pro.spi->beginTransaction(SPISettings(p->freq, MSBFIRST, SPI_MODE0));
+  PIN_LOW(p->pinList[IF_PIN_CS]);
+}
 
 uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_t len)
 {
-    xSemaphoreTake(spimutex, SPIMUTEX_BLOCK_TIME);                    // LOCK
+    SpiBusAcquire(SPI_BUS_PRIORITY_LOW, SPIMUTEX_BLOCK_TIME);                    // LOCK
   if((p == NULL))
   {
-    xSemaphoreGive(spimutex);                    // UNLOCK
+    SpiBusRelease();                    // UNLOCK
     return 0;
   }
       
@@ -127,7 +138,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
       {
            //Serial.println("IF_COM_SET_FREQUENCY");
            if(!p->freq) {
-            xSemaphoreGive(spimutex);
+            SpiBusRelease();
             return 0;
            }
            #if defined(SPI_HAS_TRANSACTION)
@@ -155,7 +166,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
       {
            if(!(p->isBegin))
            {
-            xSemaphoreGive(spimutex);
+            SpiBusRelease();
             return 0;
            }
         //    xSemaphoreTake(spimutex, SPIMUTEX_BLOCK_TIME);                    // LOCK
@@ -179,7 +190,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
           // delay(10);
            if(!(p->isBegin))
            {
-            xSemaphoreGive(spimutex);
+            SpiBusRelease();
             return 0;
            }
         //    xSemaphoreTake(spimutex, SPIMUTEX_BLOCK_TIME);                    // LOCK
@@ -205,7 +216,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
            uint8_t num = pgm_read_byte(&pBuf[0]);
            if(!(p->isBegin) || num > 4)
            {
-            xSemaphoreGive(spimutex);
+            SpiBusRelease();
             return 0;
            }
         //    xSemaphoreTake(spimutex, SPIMUTEX_BLOCK_TIME);     // LOCK
@@ -214,7 +225,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
            //uint8_t buf[num];
            do{
                uint32_t datBytes = len;
-               uint32_t args = 100000/num;
+               uint32_t args = SPI_BUS_LCD_CHUNK/num;
                if(datBytes > args) datBytes = args;
                #if defined(ESP8266)
                yield();
@@ -266,6 +277,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
                               break;
                    }
                }
+               if(len) interfaceSpiYield(p);
            }while(len);
            PIN_HIGH(p->pinList[IF_PIN_CS]); 
         //    xSemaphoreGive(spimutex);                    // UNLOCK
@@ -277,7 +289,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
       {
            if(!(p->isBegin))
            {
-            xSemaphoreGive(spimutex);
+            SpiBusRelease();
             return 0;
            }
            
@@ -286,8 +298,8 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
            PIN_LOW(p->pinList[IF_PIN_CS]);
            do{
                uint32_t datBytes = len;
+               if(datBytes > SPI_BUS_LCD_CHUNK) datBytes = SPI_BUS_LCD_CHUNK;
                #if defined(ESP8266)
-               if(datBytes > 100000) datBytes = 100000;
                yield();
                #endif
                len -= datBytes;
@@ -299,6 +311,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
                    #endif
                    pBuf++;
                }
+               if(len) interfaceSpiYield(p);
            }while(len);
            PIN_HIGH(p->pinList[IF_PIN_CS]); 
         //    xSemaphoreGive(spimutex);                    // UNLOCK
@@ -310,7 +323,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
       {
            if(!(p->isBegin))
            {
-            xSemaphoreGive(spimutex);
+            SpiBusRelease();
             return 0;
            }
         //    xSemaphoreTake(spimutex, SPIMUTEX_BLOCK_TIME);     // LOCK
@@ -336,7 +349,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
            #endif
            do{
                uint32_t datBytes = len;
-               uint32_t args = 100000/pBuf[0];
+               uint32_t args = SPI_BUS_LCD_CHUNK/pBuf[0];
                if(datBytes > args) datBytes = args;
                #if defined(ESP8266)
                yield();
@@ -410,6 +423,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
                    }
                }
                #endif
+               if(len) interfaceSpiYield(p);
            }while(len);
            PIN_HIGH(p->pinList[IF_PIN_CS]); 
         //    xSemaphoreGive(spimutex);                    // UNLOCK
@@ -422,15 +436,15 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
            //Serial.println("IF_COM_WRITE_RAM_INC");
            if(!(p->isBegin))
            {
-            xSemaphoreGive(spimutex);
+            SpiBusRelease();
             return 0;
            }
         //    xSemaphoreTake(spimutex, SPIMUTEX_BLOCK_TIME);     // LOCK
            PIN_LOW(p->pinList[IF_PIN_CS]);
            do{
                uint32_t datBytes = len;
+               if(datBytes > SPI_BUS_LCD_CHUNK) datBytes = SPI_BUS_LCD_CHUNK;
                #if defined(ESP8266)
-               if(datBytes > 100000) datBytes = 100000;
                yield();
                #endif
                len -= datBytes;
@@ -442,6 +456,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
                    #endif
                    pBuf++;
                }
+               if(len) interfaceSpiYield(p);
            }while(len);
            PIN_HIGH(p->pinList[IF_PIN_CS]); 
         //    xSemaphoreGive(spimutex);                    // UNLOCK
@@ -459,7 +474,7 @@ uint8_t interfaceComHardwareSPI(sGdlIF_t *p, uint8_t cmd, uint8_t *pBuf, uint32_
      #if defined(ARDUINO_SAM_ZERO)
          SPI.setClockDivider(12); 
      #endif
-xSemaphoreGive(spimutex);                    // UNLOCK
+SpiBusRelease();                    // UNLOCK
   return 1;
 }
 
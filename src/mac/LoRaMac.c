@@ -165,6 +165,11 @@ typedef struct sLoRaMacCtx
     uint32_t RxWindow1Delay;
     uint32_t RxWindow2Delay;
     /*
+    * LoRaMac reception windows delay [us], used to set the window timers
+    */
+    uint32_t RxWindow1DelayUs;
+    uint32_t RxWindow2DelayUs;
+    /*
     * LoRaMac Rx windows configuration
     */
     RxConfigParams_t RxWindow1Config;
@@ -199,6 +204,11 @@ typedef struct sLoRaMacCtx
      * Indicates if the AckTimeout timer has expired or not     AckTimeout定时器是否过期
      */
     bool AckTimeoutRetry;
+    /*
+     * Set by a radio fault until the MAC is done with the aborted request,
+     * which is then not retransmitted
+     */
+    bool RadioFault;
     /*
      * If the node has sent a FRAME_TYPE_DATA_CONFIRMED_UP this variable indicates
      * if the nodes needs to manage the server acknowledgement.
@@ -257,6 +267,13 @@ RTC_DATA_ATTR static LoRaMacCtx_t MacCtx;
 
 RTC_DATA_ATTR static LoRaMacNvmData_t Nvm;
 
+/*
+ * NVM groups modified since the last LoRaMacHandleNvm pass, see LoRaMacNvmSetDirty.
+ * Set from any task and taken by the LoRa task with atomic operations, 32 bits
+ * wide so they are native on every target.
+ */
+RTC_DATA_ATTR static uint32_t NvmDirtyFlags;
+
 /*!
  * Defines the LoRaMac radio events status
  */
@@ -270,6 +287,7 @@ typedef union uLoRaMacRadioEvents
         uint32_t TxTimeout : 1;
         uint32_t RxDone    : 1;
         uint32_t TxDone    : 1;
+        uint32_t Fault     : 1;
     }Events;
 }LoRaMacRadioEvents_t;
 
@@ -311,25 +329,30 @@ static void OnRadioRxError( void );
  */
 static void OnRadioRxTimeout( void );
 
+/*!
+ * \brief Function executed on Radio fault event
+ */
+static void OnRadioFault( RadioFault_t fault );
+
 /*!
  * \brief Function executed on duty cycle delayed Tx  timer event
  */
-static void OnTxDelayedTimerEvent( void );
+static void OnTxDelayedTimerEvent( void* context );
 
 /*!
  * \brief Function executed on first Rx window timer event      RX1定时器回调
  */
-static void OnRxWindow1TimerEvent( void );
+static void OnRxWindow1TimerEvent( void* context );
 
 /*!
  * \brief Function executed on second Rx window timer event     RX2定时器回调
  */
-static void OnRxWindow2TimerEvent( void );
+static void OnRxWindow2TimerEvent( void* context );
 
 /*!
  * \brief Function executed on AckTimeout timer event
  */
-static void OnAckTimeoutTimerEvent( void );
+static void OnAckTimeoutTimerEvent( void* context );
 
 /*!
  * \brief Configures the events to trigger an MLME-Indication with
@@ -648,6 +671,7 @@ static void LoRaMacHandleNvm( LoRaMacNvmData_t* nvmData );
 struct
 {
     TimerTime_t CurTime;
+    TimerTimeUs_t CurTimeUs;
 }TxDoneParams;
 
 /*!
@@ -664,6 +688,9 @@ struct
 
 static void OnRadioTxDone( void )
 {
+    // End of the transmission as stamped by the radio ISR, the LoRa task may
+    // run this callback much later
+    TxDoneParams.CurTimeUs = Radio.GetIrqTimeUs( );
     TxDoneParams.CurTime = TimerGetCurrentTime( );
     MacCtx.LastTxSysTime = SysTimeGet( );
 
@@ -722,6 +749,21 @@ static void OnRadioRxTimeout( void )
     }
 }
 
+static void OnRadioFault( RadioFault_t fault )
+{
+    LoRaMacRadioEvents.Events.Fault = 1;
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacRadioFault != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacRadioFault( fault );
+    }
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
 static void UpdateRxSlotIdleState( void )
 {
     if( Nvm.MacGroup2.DeviceClass != CLASS_C )
@@ -739,6 +781,7 @@ static void ProcessRadioTxDone( void )      // 发送完成中断处理程序
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
     SetBandTxDoneParams_t txDone;
+    TimerTimeUs_t elapsed;
 
     if( Nvm.MacGroup2.DeviceClass != CLASS_C )  // 不是CLASS_C设备 则 天线休眠
     {
@@ -746,9 +789,11 @@ static void ProcessRadioTxDone( void )      // 发送完成中断处理程序
     }
 
     // Setup timers     打开两个接收窗口RX1和RX2
-    TimerSetValue( &MacCtx.RxWindowTimer1, MacCtx.RxWindow1Delay);
+    // The windows are relative to the end of the transmission, not to now
+    elapsed = TimerGetElapsedTimeUs( TxDoneParams.CurTimeUs );
+    TimerSetValueUs( &MacCtx.RxWindowTimer1, ( MacCtx.RxWindow1DelayUs > elapsed ) ? MacCtx.RxWindow1DelayUs - elapsed : 0 );
     TimerStart( &MacCtx.RxWindowTimer1 );
-    TimerSetValue( &MacCtx.RxWindowTimer2, MacCtx.RxWindow2Delay);
+    TimerSetValueUs( &MacCtx.RxWindowTimer2, ( MacCtx.RxWindow2DelayUs > elapsed ) ? MacCtx.RxWindow2DelayUs - elapsed : 0 );
     TimerStart( &MacCtx.RxWindowTimer2 );
 
     // printf("\n------<LM> [ProcessRadioTxDone] Rx1time = %d, Rx2time = %d------\n",MacCtx.RxWindow1Delay,MacCtx.RxWindow2Delay);
@@ -763,6 +808,7 @@ static void ProcessRadioTxDone( void )      // 发送完成中断处理程序
 
     // Update Aggregated last tx done time                  更新最新的Tx完成时间
     Nvm.MacGroup1.LastTxDoneTime = TxDoneParams.CurTime;
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
 
     // Update last tx done time for the current channel     更新一些发送完成后的参数
     txDone.Channel = MacCtx.Channel;
@@ -789,7 +835,7 @@ static void PrepareRxDoneAbort( void )
 
     if( MacCtx.NodeAckRequested == true )
     {
-        OnAckTimeoutTimerEvent( );
+        OnAckTimeoutTimerEvent( NULL );
     }
     // printf("\n\n---------------PrepareRxDoneAbort mod McpsInd = 1 -------------\n\n");
     MacCtx.MacFlags.Bits.McpsInd = 1;
@@ -856,13 +902,13 @@ static void ProcessRadioRxDone( void )
         if( LoRaMacClassBIsPingExpected( ) == true )
         {
             LoRaMacClassBSetPingSlotState( PINGSLOT_STATE_CALC_PING_OFFSET );
-            LoRaMacClassBPingSlotTimerEvent( );
+            LoRaMacClassBPingSlotTimerEvent( NULL );
             MacCtx.McpsIndication.RxSlot = RX_SLOT_WIN_CLASS_B_PING_SLOT;
         }
         else if( LoRaMacClassBIsMulticastExpected( ) == true )
         {
             LoRaMacClassBSetMulticastSlotState( PINGSLOT_STATE_CALC_PING_OFFSET );
-            LoRaMacClassBMulticastSlotTimerEvent( );
+            LoRaMacClassBMulticastSlotTimerEvent( NULL );
             MacCtx.McpsIndication.RxSlot = RX_SLOT_WIN_CLASS_B_MULTICAST_SLOT;
         }
     }
@@ -925,6 +971,7 @@ static void ProcessRadioRxDone( void )
                 RegionApplyCFList( Nvm.MacGroup2.Region, &applyCFList );
 
                 Nvm.MacGroup2.NetworkActivation = ACTIVATION_TYPE_OTAA;
+                LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
 
                 // MLME handling
                 if( LoRaMacConfirmQueueIsCmdActive( MLME_JOIN ) == true )
@@ -1026,6 +1073,7 @@ static void ProcessRadioRxDone( void )
                     if( ( Nvm.MacGroup2.Version.Fields.Minor == 0 ) && ( macHdr.Bits.MType == FRAME_TYPE_DATA_CONFIRMED_DOWN ) && ( Nvm.MacGroup1.LastRxMic == macMsgData.MIC ) )
                     {
                         Nvm.MacGroup1.SrvAckRequested = true;
+                        LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
                     }
                 }
                 else if( macCryptoStatus == LORAMAC_CRYPTO_FAIL_MAX_GAP_FCNT )
@@ -1083,6 +1131,9 @@ static void ProcessRadioRxDone( void )
             MacCtx.McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
             MacCtx.McpsConfirm.AckReceived = macMsgData.FHDR.FCtrl.Bits.Ack;
 
+            // The ADR ACK counter and the ack request state are updated below
+            LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
+
             // Reset ADR ACK Counter only, when RX1 or RX2 slot
             if( ( MacCtx.McpsIndication.RxSlot == RX_SLOT_WIN_1 ) ||
                 ( MacCtx.McpsIndication.RxSlot == RX_SLOT_WIN_2 ) )
@@ -1207,7 +1258,7 @@ static void ProcessRadioRxDone( void )
         if( MacCtx.McpsConfirm.AckReceived == true )
         {
             // printf("\n\n---------------ProcessRadioRxDone step14-------------\n\n");
-            OnAckTimeoutTimerEvent( );
+            OnAckTimeoutTimerEvent( NULL );
         }
     }
     else
@@ -1215,7 +1266,7 @@ static void ProcessRadioRxDone( void )
         if( Nvm.MacGroup2.DeviceClass == CLASS_C )
         {
             // printf("\n\n---------------ProcessRadioRxDone step15-------------\n\n");
-            OnAckTimeoutTimerEvent( );
+            OnAckTimeoutTimerEvent( NULL );
         }
     }
     MacCtx.MacFlags.Bits.MacDone = 1;
@@ -1253,7 +1304,7 @@ static void HandleRadioRxErrorTimeout( LoRaMacEventInfoStatus_t rx1EventInfoStat
     if( LoRaMacClassBIsBeaconExpected( ) == true )
     {
         LoRaMacClassBSetBeaconState( BEACON_STATE_TIMEOUT );
-        LoRaMacClassBBeaconTimerEvent( );
+        LoRaMacClassBBeaconTimerEvent( NULL );
         classBRx = true;
     }
     if( Nvm.MacGroup2.DeviceClass == CLASS_B )
@@ -1261,13 +1312,13 @@ static void HandleRadioRxErrorTimeout( LoRaMacEventInfoStatus_t rx1EventInfoStat
         if( LoRaMacClassBIsPingExpected( ) == true )
         {
             LoRaMacClassBSetPingSlotState( PINGSLOT_STATE_CALC_PING_OFFSET );
-            LoRaMacClassBPingSlotTimerEvent( );
+            LoRaMacClassBPingSlotTimerEvent( NULL );
             classBRx = true;
         }
         if( LoRaMacClassBIsMulticastExpected( ) == true )
         {
             LoRaMacClassBSetMulticastSlotState( PINGSLOT_STATE_CALC_PING_OFFSET );
-            LoRaMacClassBMulticastSlotTimerEvent( );
+            LoRaMacClassBMulticastSlotTimerEvent( NULL );
             classBRx = true;
         }
     }
@@ -1324,6 +1375,29 @@ static void ProcessRadioRxTimeout( void )
     rxtimeoutflag++;
 }
 
+static void ProcessRadioFault( void )
+{
+    // The radio may have missed a command: the events of the current TX or
+    // RX may never come, end it now with an error
+    TimerStop( &MacCtx.RxWindowTimer1 );
+    TimerStop( &MacCtx.RxWindowTimer2 );
+    TimerStop( &MacCtx.AckTimeoutTimer );
+    if( Nvm.MacGroup2.DeviceClass != CLASS_C )
+    {
+        Radio.Sleep( );
+    }
+    UpdateRxSlotIdleState( );
+
+    if( ( MacCtx.MacState & LORAMAC_TX_RUNNING ) == LORAMAC_TX_RUNNING )
+    {
+        MacCtx.McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+        LoRaMacConfirmQueueSetStatusCmn( LORAMAC_EVENT_INFO_STATUS_ERROR );
+        MacCtx.RadioFault = true;
+        MacCtx.MacState |= LORAMAC_RX_ABORT;
+        MacCtx.MacFlags.Bits.MacDone = 1;
+    }
+}
+
 static void LoRaMacHandleIrqEvents( void )
 {
     //printf("\n------ LoRaMacHandleIrqEvents [START] ---- MacCtx.MacState = %d ------\n", GetMacState());
@@ -1361,6 +1435,10 @@ static void LoRaMacHandleIrqEvents( void )
             //printf("\n\n------<LM> ProcessRadioRxTimeout------\n\n");
             ProcessRadioRxTimeout( );       // 接收超时中断处理程序
         }
+        if( events.Events.Fault == 1 )
+        {
+            ProcessRadioFault( );           // 无线电故障处理程序
+        }
     }
     //printf("\n------ LoRaMacHandleIrqEvents [END] ---- MacCtx.MacState = %d ------\n", GetMacState());
 }
@@ -1486,7 +1564,11 @@ static void LoRaMacHandleMcpsRequest( void )
         bool stopRetransmission = false;
         bool waitForRetransmission = false;
 
-        if( ( MacCtx.McpsConfirm.McpsRequest == MCPS_UNCONFIRMED ) ||
+        if( MacCtx.RadioFault == true )
+        {
+            stopRetransmission = true;
+        }
+        else if( ( MacCtx.McpsConfirm.McpsRequest == MCPS_UNCONFIRMED ) ||
             ( MacCtx.McpsConfirm.McpsRequest == MCPS_PROPRIETARY ) )
         {
             stopRetransmission = CheckRetransUnconfirmedUplink( );
@@ -1532,7 +1614,7 @@ static void LoRaMacHandleMcpsRequest( void )
             //printf("\n---waitForRetransmission--- set MacCtx.AckTimeoutRetry = false---\n");
             MacCtx.AckTimeoutRetry = false;
             // Sends the same frame again
-            OnTxDelayedTimerEvent( );
+            OnTxDelayedTimerEvent( NULL );
             //printf("\n\n---------------LoRaMacHandleMcpsRequest step5 MacCtx.MacState = %d-------------\n\n", MacCtx.MacState);
         }
     }
@@ -1586,6 +1668,7 @@ static void LoRaMacCheckForRxAbort( void )
 static void LoRaMacHandleNvm( LoRaMacNvmData_t* nvmData )
 {
     uint32_t crc = 0;
+    uint16_t dirtyFlags;
     uint16_t notifyFlags = LORAMAC_NVM_NOTIFY_FLAG_NONE;
 
     if( MacCtx.MacState != LORAMAC_IDLE )
@@ -1593,71 +1676,104 @@ static void LoRaMacHandleNvm( LoRaMacNvmData_t* nvmData )
         return;
     }
 
+    dirtyFlags = ( uint16_t )__atomic_exchange_n( &NvmDirtyFlags, LORAMAC_NVM_NOTIFY_FLAG_NONE, __ATOMIC_ACQ_REL );
+
+    if( dirtyFlags == LORAMAC_NVM_NOTIFY_FLAG_NONE )
+    {
+        return;
+    }
+
     // Crypto
-    crc = Crc32( ( uint8_t* ) &nvmData->Crypto, sizeof( nvmData->Crypto ) -
-                                                sizeof( nvmData->Crypto.Crc32 ) );
-    if( crc != nvmData->Crypto.Crc32 )
+    if( ( dirtyFlags & LORAMAC_NVM_NOTIFY_FLAG_CRYPTO ) != 0 )
     {
-        nvmData->Crypto.Crc32 = crc;
-        notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_CRYPTO;
+        crc = Crc32( ( uint8_t* ) &nvmData->Crypto, sizeof( nvmData->Crypto ) -
+                                                    sizeof( nvmData->Crypto.Crc32 ) );
+        if( crc != nvmData->Crypto.Crc32 )
+        {
+            nvmData->Crypto.Crc32 = crc;
+            notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_CRYPTO;
+        }
     }
 
     // MacGroup1
-    crc = Crc32( ( uint8_t* ) &nvmData->MacGroup1, sizeof( nvmData->MacGroup1 ) -
-                                                   sizeof( nvmData->MacGroup1.Crc32 ) );
-    if( crc != nvmData->MacGroup1.Crc32 )
+    if( ( dirtyFlags & LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 ) != 0 )
     {
-        nvmData->MacGroup1.Crc32 = crc;
-        notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1;
+        crc = Crc32( ( uint8_t* ) &nvmData->MacGroup1, sizeof( nvmData->MacGroup1 ) -
+                                                       sizeof( nvmData->MacGroup1.Crc32 ) );
+        if( crc != nvmData->MacGroup1.Crc32 )
+        {
+            nvmData->MacGroup1.Crc32 = crc;
+            notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1;
+        }
     }
 
     // MacGroup2
-    crc = Crc32( ( uint8_t* ) &nvmData->MacGroup2, sizeof( nvmData->MacGroup2 ) -
-                                                   sizeof( nvmData->MacGroup2.Crc32 ) );
-    if( crc != nvmData->MacGroup2.Crc32 )
+    if( ( dirtyFlags & LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 ) != 0 )
     {
-        nvmData->MacGroup2.Crc32 = crc;
-        notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2;
+        crc = Crc32( ( uint8_t* ) &nvmData->MacGroup2, sizeof( nvmData->MacGroup2 ) -
+                                                       sizeof( nvmData->MacGroup2.Crc32 ) );
+        if( crc != nvmData->MacGroup2.Crc32 )
+        {
+            nvmData->MacGroup2.Crc32 = crc;
+            notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2;
+        }
     }
 
     // Secure Element
-    crc = Crc32( ( uint8_t* ) &nvmData->SecureElement, sizeof( nvmData->SecureElement ) -
-                                                       sizeof( nvmData->SecureElement.Crc32 ) );
-    if( crc != nvmData->SecureElement.Crc32 )
+    if( ( dirtyFlags & LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT ) != 0 )
     {
-        nvmData->SecureElement.Crc32 = crc;
-        notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT;
+        crc = Crc32( ( uint8_t* ) &nvmData->SecureElement, sizeof( nvmData->SecureElement ) -
+                                                           sizeof( nvmData->SecureElement.Crc32 ) );
+        if( crc != nvmData->SecureElement.Crc32 )
+        {
+            nvmData->SecureElement.Crc32 = crc;
+            notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT;
+        }
     }
 
     // Region
-    crc = Crc32( ( uint8_t* ) &nvmData->RegionGroup1, sizeof( nvmData->RegionGroup1 ) -
-                                                sizeof( nvmData->RegionGroup1.Crc32 ) );
-    if( crc != nvmData->RegionGroup1.Crc32 )
+    if( ( dirtyFlags & LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 ) != 0 )
     {
-        nvmData->RegionGroup1.Crc32 = crc;
-        notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1;
+        crc = Crc32( ( uint8_t* ) &nvmData->RegionGroup1, sizeof( nvmData->RegionGroup1 ) -
+                                                    sizeof( nvmData->RegionGroup1.Crc32 ) );
+        if( crc != nvmData->RegionGroup1.Crc32 )
+        {
+            nvmData->RegionGroup1.Crc32 = crc;
+            notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1;
+        }
     }
 
-    crc = Crc32( ( uint8_t* ) &nvmData->RegionGroup2, sizeof( nvmData->RegionGroup2 ) -
-                                                sizeof( nvmData->RegionGroup2.Crc32 ) );
-    if( crc != nvmData->RegionGroup2.Crc32 )
+    if( ( dirtyFlags & LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2 ) != 0 )
     {
-        nvmData->RegionGroup2.Crc32 = crc;
-        notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2;
+        crc = Crc32( ( uint8_t* ) &nvmData->RegionGroup2, sizeof( nvmData->RegionGroup2 ) -
+                                                    sizeof( nvmData->RegionGroup2.Crc32 ) );
+        if( crc != nvmData->RegionGroup2.Crc32 )
+        {
+            nvmData->RegionGroup2.Crc32 = crc;
+            notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2;
+        }
     }
 
     // ClassB
-    crc = Crc32( ( uint8_t* ) &nvmData->ClassB, sizeof( nvmData->ClassB ) -
-                                                sizeof( nvmData->ClassB.Crc32 ) );
-    if( crc != nvmData->ClassB.Crc32 )
+    if( ( dirtyFlags & LORAMAC_NVM_NOTIFY_FLAG_CLASS_B ) != 0 )
     {
-        nvmData->ClassB.Crc32 = crc;
-        notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_CLASS_B;
+        crc = Crc32( ( uint8_t* ) &nvmData->ClassB, sizeof( nvmData->ClassB ) -
+                                                    sizeof( nvmData->ClassB.Crc32 ) );
+        if( crc != nvmData->ClassB.Crc32 )
+        {
+            nvmData->ClassB.Crc32 = crc;
+            notifyFlags |= LORAMAC_NVM_NOTIFY_FLAG_CLASS_B;
+        }
     }
 
     CallNvmDataChangeCallback( notifyFlags );
 }
 
+void LoRaMacNvmSetDirty( uint16_t notifyFlags )
+{
+    __atomic_fetch_or( &NvmDirtyFlags, notifyFlags, __ATOMIC_RELEASE );
+}
+
 
 void LoRaMacProcess( void )
 {
@@ -1689,6 +1805,7 @@ void LoRaMacProcess( void )
             LoRaMacHandleMlmeRequest( );
             LoRaMacHandleMcpsRequest( );
         }
+        MacCtx.RadioFault = false;
         // printf("\n\n---------------LoRaMacProcess step8-------------\n\n");
         LoRaMacHandleRequestEvents( );
         // printf("\n\n---------------LoRaMacProcess step9-------------\n\n");
@@ -1710,7 +1827,7 @@ void LoRaMacProcess( void )
     //printf("\n------ LoRaMacProcess [END] ---- MacCtx.MacState = %d ------\n", GetMacState());
 }
 
-static void OnTxDelayedTimerEvent( void )
+static void OnTxDelayedTimerEvent( void* context )
 {
     TimerStop( &MacCtx.TxDelayedTimer );
     MacCtx.MacState &= ~LORAMAC_TX_DELAYED;
@@ -1736,7 +1853,7 @@ static void OnTxDelayedTimerEvent( void )
     }
 }
 
-static void OnRxWindow1TimerEvent( void )
+static void OnRxWindow1TimerEvent( void* context )
 {
     MacCtx.RxWindow1Config.Channel = MacCtx.Channel;
     MacCtx.RxWindow1Config.DrOffset = Nvm.MacGroup2.MacParams.Rx1DrOffset;
@@ -1747,7 +1864,7 @@ static void OnRxWindow1TimerEvent( void )
     RxWindowSetup( &MacCtx.RxWindowTimer1, &MacCtx.RxWindow1Config );
 }
 
-static void OnRxWindow2TimerEvent( void )
+static void OnRxWindow2TimerEvent( void* context )
 {
     // Check if we are processing Rx1 window.
     // If yes, we don't setup the Rx2 window.
@@ -1764,7 +1881,7 @@ static void OnRxWindow2TimerEvent( void )
     RxWindowSetup( &MacCtx.RxWindowTimer2, &MacCtx.RxWindow2Config );
 }
 
-static void OnAckTimeoutTimerEvent( void )
+static void OnAckTimeoutTimerEvent( void* context )
 {
     TimerStop( &MacCtx.AckTimeoutTimer );
 
@@ -1835,6 +1952,8 @@ static LoRaMacStatus_t SwitchClass( DeviceClass_t deviceClass )
 {
     LoRaMacStatus_t status = LORAMAC_STATUS_PARAMETER_INVALID;
 
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
+
     switch( Nvm.MacGroup2.DeviceClass )     // 先判断当前模式
     {
         case CLASS_A:
@@ -1958,6 +2077,9 @@ static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t comm
     bool adrBlockFound = false;
     uint8_t macCmdPayload[2] = { 0x00, 0x00 };
 
+    // Most of the commands answered below update the MAC parameters
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 | LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
+
     while( macIndex < commandsSize )
     {
         // Make sure to parse only complete MAC commands
@@ -2295,6 +2417,7 @@ LoRaMacStatus_t Send( LoRaMacHeader_t* macHdr, uint8_t fPort, void* fBuffer, uin
     {
         return LORAMAC_STATUS_NO_NETWORK_JOINED;
     }
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
     if( Nvm.MacGroup2.MaxDCycle == 0 )
     {
         Nvm.MacGroup1.AggregatedTimeOff = 0;
@@ -2447,11 +2570,15 @@ static void ComputeRxWindowParameters( void )
     // Default setup, in case the device joined
     MacCtx.RxWindow1Delay = Nvm.MacGroup2.MacParams.ReceiveDelay1 + MacCtx.RxWindow1Config.WindowOffset;
     MacCtx.RxWindow2Delay = Nvm.MacGroup2.MacParams.ReceiveDelay2 + MacCtx.RxWindow2Config.WindowOffset;
+    MacCtx.RxWindow1DelayUs = Nvm.MacGroup2.MacParams.ReceiveDelay1 * 1000 + MacCtx.RxWindow1Config.WindowOffsetUs;
+    MacCtx.RxWindow2DelayUs = Nvm.MacGroup2.MacParams.ReceiveDelay2 * 1000 + MacCtx.RxWindow2Config.WindowOffsetUs;
 
     if( Nvm.MacGroup2.NetworkActivation == ACTIVATION_TYPE_NONE )
     {
         MacCtx.RxWindow1Delay = Nvm.MacGroup2.MacParams.JoinAcceptDelay1 + MacCtx.RxWindow1Config.WindowOffset;
         MacCtx.RxWindow2Delay = Nvm.MacGroup2.MacParams.JoinAcceptDelay2 + MacCtx.RxWindow2Config.WindowOffset;
+        MacCtx.RxWindow1DelayUs = Nvm.MacGroup2.MacParams.JoinAcceptDelay1 * 1000 + MacCtx.RxWindow1Config.WindowOffsetUs;
+        MacCtx.RxWindow2DelayUs = Nvm.MacGroup2.MacParams.JoinAcceptDelay2 * 1000 + MacCtx.RxWindow2Config.WindowOffsetUs;
     }
 }
 
@@ -2545,6 +2672,7 @@ static LoRaMacStatus_t ScheduleTx( bool allowDelayedTx )
 
     // Select channel
     status = RegionNextChannel( Nvm.MacGroup2.Region, &nextChan, &MacCtx.Channel, &MacCtx.DutyCycleWaitTime, &Nvm.MacGroup1.AggregatedTimeOff );
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
     // printf("ScheduleTx--------------channel = %d\n", MacCtx.Channel);
 
     if( status != LORAMAC_STATUS_OK )
@@ -2634,6 +2762,7 @@ static void CalculateBackOff( void )
         // Update aggregated time-off. This must be an assignment and no incremental        更新聚合回退时间。这必须是赋值，不能是增量
         // update as we do only calculate the time-off based on the last transmission       更新，因为我们只根据最后一次传输计算时间间隔
         Nvm.MacGroup1.AggregatedTimeOff = ( MacCtx.TxTimeOnAir * Nvm.MacGroup2.AggregatedDCycle - MacCtx.TxTimeOnAir );         
+        LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
     }
 }
 
@@ -2663,6 +2792,8 @@ static void ResetMacParameters( void )
     LoRaMacClassBCallback_t classBCallbacks;
     LoRaMacClassBParams_t classBParams;
 
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 | LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
+
     Nvm.MacGroup2.NetworkActivation = ACTIVATION_TYPE_NONE;
 
     // ADR counter
@@ -3026,6 +3157,10 @@ LoRaMacStatus_t RestoreNvmData( LoRaMacNvmData_t* nvm )
         MacCtx.RxWindowCConfig.DownlinkDwellTime = Nvm.MacGroup2.MacParams.DownlinkDwellTime;
         MacCtx.RxWindowCConfig.RxContinuous = true;
         MacCtx.RxWindowCConfig.RxSlot = RX_SLOT_WIN_CLASS_C;
+
+        // The multicast contexts point to the counters of the crypto module, the
+        // restored addresses may be those of another firmware
+        LoRaMacCryptoSetMulticastReference( Nvm.MacGroup2.MulticastChannelList );
     }
 
     // Secure Element
@@ -3046,6 +3181,14 @@ LoRaMacStatus_t RestoreNvmData( LoRaMacNvmData_t* nvm )
                  sizeof( Nvm.RegionGroup1 ) );
     }
 
+    crc = Crc32( ( uint8_t* ) &nvm->RegionGroup2, sizeof( nvm->RegionGroup2 ) -
+                                            sizeof( nvm->RegionGroup2.Crc32 ) );
+    if( crc == nvm->RegionGroup2.Crc32 )
+    {
+        memcpy1( ( uint8_t* ) &Nvm.RegionGroup2,( uint8_t* ) &nvm->RegionGroup2,
+                 sizeof( Nvm.RegionGroup2 ) );
+    }
+
     crc = Crc32( ( uint8_t* ) &nvm->ClassB, sizeof( nvm->ClassB ) -
                                             sizeof( nvm->ClassB.Crc32 ) );
     if( crc == nvm->ClassB.Crc32 )
@@ -3163,6 +3306,7 @@ static bool StopRetransmission( void )
         if( Nvm.MacGroup2.AdrCtrlOn == true )
         {
             Nvm.MacGroup1.AdrAckCounter++;
+            LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
         }
     }
 
@@ -3199,6 +3343,7 @@ static void AckTimeoutRetriesProcess( void )
             getPhy.Datarate = Nvm.MacGroup1.ChannelsDatarate;
             phyParam = RegionGetPhyParam( Nvm.MacGroup2.Region, &getPhy );
             Nvm.MacGroup1.ChannelsDatarate = phyParam.Value;
+            LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
         }
     }
 }
@@ -3264,6 +3409,10 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
         // Initialize the module context with zeros  清空模块上下文
         memset1( ( uint8_t* ) &Nvm, 0x00, sizeof( LoRaMacNvmData_t ) );
         memset1( ( uint8_t* ) &MacCtx, 0x00, sizeof( LoRaMacCtx_t ) );
+        LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO | LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 |
+                            LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 | LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT |
+                            LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 | LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2 |
+                            LORAMAC_NVM_NOTIFY_FLAG_CLASS_B );
 
         // Set non zero variables to its default value  将非零变量设置为默认值
         MacCtx.AckTimeoutRetriesCounter = 1;
@@ -3347,7 +3496,9 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
 
         // Init parameters which are not set in function ResetMacParameters    设置一些在ResetMacParameters函数中没有设置的默认值
         Nvm.MacGroup2.MacParamsDefaults.ChannelsNbTrans = 1;
-        Nvm.MacGroup2.MacParamsDefaults.SystemMaxRxError = 10;
+        // The timers run on the microsecond clock and the reception windows
+        // are timed from the TxDone interrupt, so the error margin can be small
+        Nvm.MacGroup2.MacParamsDefaults.SystemMaxRxError = 3;
         Nvm.MacGroup2.MacParamsDefaults.MinRxSymbols = 6;
 
         Nvm.MacGroup2.MacParams.SystemMaxRxError = Nvm.MacGroup2.MacParamsDefaults.SystemMaxRxError;
@@ -3390,6 +3541,7 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
 
     // Store the current initialization time    存储当前的初始化时间
     Nvm.MacGroup2.InitializationTime = SysTimeGetMcuTime( );
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
 
     // Initialize Radio driver  初始化天线驱动
     MacCtx.RadioEvents.TxDone = OnRadioTxDone;
@@ -3397,6 +3549,7 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     MacCtx.RadioEvents.RxError = OnRadioRxError;
     MacCtx.RadioEvents.TxTimeout = OnRadioTxTimeout;
     MacCtx.RadioEvents.RxTimeout = OnRadioRxTimeout;
+    MacCtx.RadioEvents.Fault = OnRadioFault;
     Radio.Init( &MacCtx.RadioEvents );
 
     if(Nvm.MacGroup2.NetworkActivation == ACTIVATION_TYPE_NONE)         // 没有入网才初始化以下模块
@@ -3517,6 +3670,166 @@ LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
     }
 }
 
+LoRaMacStatus_t LoRaMacQueryTimeOnAir( uint8_t size, TimerTime_t* timeOnAir )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    size_t macCmdsSize = 0;
+
+    if( timeOnAir == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    if( LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS )
+    {
+        return LORAMAC_STATUS_MAC_COMMAD_ERROR;
+    }
+    if( macCmdsSize > LORA_MAC_COMMAND_MAX_FOPTS_LENGTH )
+    {
+        macCmdsSize = 0;
+    }
+
+    getPhy.Attribute = PHY_TIME_ON_AIR;
+    getPhy.Datarate = Nvm.MacGroup1.ChannelsDatarate;
+    getPhy.PktLen = LORAMAC_FRAME_PAYLOAD_OVERHEAD_SIZE + macCmdsSize + size;
+    phyParam = RegionGetPhyParam( Nvm.MacGroup2.Region, &getPhy );
+
+    *timeOnAir = phyParam.Value;
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacQueryTxDelay( uint8_t size, TimerTime_t* delay )
+{
+    NextChanParams_t nextChan;
+    RegionNvmDataGroup1_t regionGroup1;
+    uint16_t channelsMask[REGION_NVM_CHANNELS_MASK_SIZE];
+    TimerTime_t aggregatedTimeOff = Nvm.MacGroup1.AggregatedTimeOff;
+    size_t macCmdsSize = 0;
+    uint8_t channel = 0;
+    LoRaMacStatus_t status;
+
+    if( delay == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    if( LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS )
+    {
+        return LORAMAC_STATUS_MAC_COMMAD_ERROR;
+    }
+    if( macCmdsSize > LORA_MAC_COMMAND_MAX_FOPTS_LENGTH )
+    {
+        macCmdsSize = 0;
+    }
+
+    // Same back-off as CalculateBackOff, without storing it
+    if( aggregatedTimeOff == 0 )
+    {
+        aggregatedTimeOff = MacCtx.TxTimeOnAir * Nvm.MacGroup2.AggregatedDCycle - MacCtx.TxTimeOnAir;
+    }
+
+    nextChan.AggrTimeOff = aggregatedTimeOff;
+    nextChan.Datarate = Nvm.MacGroup1.ChannelsDatarate;
+    nextChan.DutyCycleEnabled = Nvm.MacGroup2.DutyCycleOn;
+    nextChan.ElapsedTimeSinceStartUp = SysTimeSub( SysTimeGetMcuTime( ), Nvm.MacGroup2.InitializationTime );
+    nextChan.LastAggrTx = Nvm.MacGroup1.LastTxDoneTime;
+    nextChan.LastTxIsJoinRequest = false;
+    nextChan.Joined = true;
+    nextChan.PktLen = LORAMAC_FRAME_PAYLOAD_OVERHEAD_SIZE + macCmdsSize + size;
+
+    if( Nvm.MacGroup2.NetworkActivation == ACTIVATION_TYPE_NONE )
+    {
+        nextChan.LastTxIsJoinRequest = true;
+        nextChan.Joined = false;
+    }
+
+    // The channel selection updates the band credits and the remaining
+    // channels, run it on the live data and put everything back afterwards.
+    memcpy1( ( uint8_t* )&regionGroup1, ( uint8_t* )&Nvm.RegionGroup1, sizeof( regionGroup1 ) );
+    memcpy1( ( uint8_t* )channelsMask, ( uint8_t* )Nvm.RegionGroup2.ChannelsMask, sizeof( channelsMask ) );
+
+    *delay = 0;
+    status = RegionNextChannel( Nvm.MacGroup2.Region, &nextChan, &channel, delay, &aggregatedTimeOff );
+
+    memcpy1( ( uint8_t* )&Nvm.RegionGroup1, ( uint8_t* )&regionGroup1, sizeof( regionGroup1 ) );
+    memcpy1( ( uint8_t* )Nvm.RegionGroup2.ChannelsMask, ( uint8_t* )channelsMask, sizeof( channelsMask ) );
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        *delay = 0;
+    }
+    else if( ( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED ) && ( *delay != TIMERTIME_T_MAX ) )
+    {
+        status = LORAMAC_STATUS_OK;
+    }
+    else
+    {
+        *delay = TIMERTIME_T_MAX;
+        status = LORAMAC_STATUS_NO_CHANNEL_FOUND;
+    }
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacQueryBandCount( uint8_t* count )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    if( count == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    getPhy.Attribute = PHY_MAX_NB_BANDS;
+    phyParam = RegionGetPhyParam( Nvm.MacGroup2.Region, &getPhy );
+    *count = ( uint8_t )MIN( phyParam.Value, REGION_NVM_MAX_NB_BANDS );
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacQueryBandBudget( uint8_t band, LoRaMacBandBudget_t* budget )
+{
+    Band_t* bandPtr;
+    uint8_t bandCount = 0;
+
+    LoRaMacQueryBandCount( &bandCount );
+    if( ( budget == NULL ) || ( band >= bandCount ) )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    bandPtr = &Nvm.RegionGroup1.Bands[band];
+
+    budget->DCycle = ( bandPtr->DCycle == 0 ) ? 1 : bandPtr->DCycle;
+    budget->MaxTimeCredits = bandPtr->MaxTimeCredits;
+    budget->TimeCredits = bandPtr->TimeCredits;
+
+    // The credits keep accumulating since the last synchronization of the band
+    if( Nvm.MacGroup2.NetworkActivation != ACTIVATION_TYPE_NONE )
+    {
+        TimerTime_t elapsed = TimerGetElapsedTime( bandPtr->LastBandUpdateTime );
+
+        if( ( budget->TimeCredits >= budget->MaxTimeCredits ) ||
+            ( elapsed >= ( budget->MaxTimeCredits - budget->TimeCredits ) ) )
+        {
+            budget->TimeCredits = budget->MaxTimeCredits;
+        }
+        else
+        {
+            budget->TimeCredits += elapsed;
+        }
+    }
+
+    if( ( Nvm.MacGroup2.DutyCycleOn == false ) && ( Nvm.MacGroup2.NetworkActivation != ACTIVATION_TYPE_NONE ) )
+    {
+        budget->AirTime = TIMERTIME_T_MAX;
+    }
+    else
+    {
+        budget->AirTime = budget->TimeCredits / budget->DCycle;
+    }
+    return LORAMAC_STATUS_OK;
+}
+
 LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet )
 {
     LoRaMacStatus_t status = LORAMAC_STATUS_OK;
@@ -3729,6 +4042,9 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
 
     // printf("----------------8------------------\n");
 
+    // Keys, counters and region settings are marked by the modules holding them
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 | LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
+
     switch( mibSet->Type )
     {
         case MIB_DEVICE_CLASS:
@@ -4412,6 +4728,7 @@ LoRaMacStatus_t LoRaMacMcChannelSetup( McChannelParams_t *channel )
     }
 
     Nvm.MacGroup2.MulticastChannelList[channel->GroupID].ChannelParams = *channel;
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
 
     if( channel->IsRemotelySetup == true )
     {
@@ -4448,6 +4765,7 @@ LoRaMacStatus_t LoRaMacMcChannelSetup( McChannelParams_t *channel )
 
     // Reset multicast channel downlink counter to initial value.
     *Nvm.MacGroup2.MulticastChannelList[channel->GroupID].DownLinkCounter = FCNT_DOWN_INITAL_VALUE;
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
     return LORAMAC_STATUS_OK;
 }
 
@@ -4471,6 +4789,7 @@ LoRaMacStatus_t LoRaMacMcChannelDelete( AddressIdentifier_t groupID )
     memset1( ( uint8_t* )&channel, 0, sizeof( McChannelParams_t ) );
 
     Nvm.MacGroup2.MulticastChannelList[groupID].ChannelParams = channel;
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
     return LORAMAC_STATUS_OK;
 }
 
@@ -4544,6 +4863,7 @@ LoRaMacStatus_t LoRaMacMcChannelSetupRxParams( AddressIdentifier_t groupID, McRx
     {
         // Apply parameters
         Nvm.MacGroup2.MulticastChannelList[groupID].ChannelParams.RxParams = *rxParams;
+        LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
     }
     return LORAMAC_STATUS_OK;
 }
@@ -4594,6 +4914,7 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t* mlmeRequest )
             ResetMacParameters( );
 
             Nvm.MacGroup1.ChannelsDatarate = RegionAlternateDr( Nvm.MacGroup2.Region, mlmeRequest->Req.Join.Datarate, ALTERNATE_DR );
+            LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
 
             queueElement.Status = LORAMAC_EVENT_INFO_STATUS_JOIN_FAIL;
 
@@ -4603,6 +4924,7 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t* mlmeRequest )
             {
                 // Revert back the previous datarate ( mainly used for US915 like regions )
                 Nvm.MacGroup1.ChannelsDatarate = RegionAlternateDr( Nvm.MacGroup2.Region, mlmeRequest->Req.Join.Datarate, ALTERNATE_DR_RESTORE );
+                LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
             }
             break;
         }
@@ -4673,7 +4995,7 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t* mlmeRequest )
             {
                 // Start class B algorithm
                 LoRaMacClassBSetBeaconState( BEACON_STATE_ACQUISITION );
-                LoRaMacClassBBeaconTimerEvent( );
+                LoRaMacClassBBeaconTimerEvent( NULL );
 
                 status = LORAMAC_STATUS_OK;
             }
@@ -4803,6 +5125,7 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t* mcpsRequest )
             if( RegionVerify( Nvm.MacGroup2.Region, &verify, PHY_TX_DR ) == true )
             {
                 Nvm.MacGroup1.ChannelsDatarate = verify.DatarateParams.Datarate;
+                LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 );
             }
             else
             {
@@ -4837,6 +5160,7 @@ void LoRaMacTestSetDutyCycleOn( bool enable )
     if( RegionVerify( Nvm.MacGroup2.Region, &verify, PHY_DUTY_CYCLE ) == true )
     {
         Nvm.MacGroup2.DutyCycleOn = enable;
+        LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
     }
 }
 
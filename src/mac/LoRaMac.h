@@ -75,6 +75,7 @@ extern "C"
 #include <stdbool.h>
 
 #include "boards/mcu/timer.h"
+#include "radio/radio.h"
 #include "system/systime.h"
 #include "LoRaMacTypes.h"
 
@@ -2086,7 +2087,8 @@ typedef union uMibParam
     float DefaultAntennaGain;
     /*!
      * Returns a pointer to the structure holding all data which shall be stored
-     * in the NVM.
+     * in the NVM. Groups modified through it must be marked with
+     * \ref LoRaMacNvmSetDirty.
      *
      * Related MIB type: \ref MIB_NVM_CTXS
      */
@@ -2221,6 +2223,29 @@ typedef struct sLoRaMacTxInfo
     uint8_t CurrentPossiblePayloadSize;
 }LoRaMacTxInfo_t;
 
+/*!
+ * LoRaMAC duty-cycle budget of a band
+ */
+typedef struct sLoRaMacBandBudget
+{
+    /*!
+     * Duty cycle of the band, 100 stands for 1%
+     */
+    uint16_t DCycle;
+    /*!
+     * Time credits available now [ms]
+     */
+    TimerTime_t TimeCredits;
+    /*!
+     * Maximum time credits of the band [ms]
+     */
+    TimerTime_t MaxTimeCredits;
+    /*!
+     * Time-on-air which can be spent now without waiting [ms]
+     */
+    TimerTime_t AirTime;
+}LoRaMacBandBudget_t;
+
 /*!
  * LoRaMAC Status
  */
@@ -2402,6 +2427,13 @@ typedef struct sLoRaMacCallback
      *\warning  Runs in a IRQ context. Should only change variables state.        在IRQ上下文中运行。应该只改变变量的状态。
      */
     void ( *MacProcessNotify )( void );
+    /*!
+     *\brief    Will be called when the radio reports a fault. The request in
+     *          progress ends with LORAMAC_EVENT_INFO_STATUS_ERROR.
+     *
+     *\param    fault Radio fault
+     */
+    void ( *MacRadioFault )( RadioFault_t fault );
 }LoRaMacCallback_t;
 
 
@@ -2466,6 +2498,19 @@ bool LoRaMacIsBusy( void );
  */
 void LoRaMacProcess( void );
 
+/*!
+ * \brief Marks NVM groups as modified
+ *
+ * \details The CRC of a group is only recomputed, and a change only notified
+ *          through \ref LoRaMacCallback_t::NvmDataChange, after the group
+ *          has been marked. The MAC layer marks the groups it modifies
+ *          itself; code writing through the \ref MIB_NVM_CTXS pointer must
+ *          call this function. It may be called from any task.
+ *
+ * \param [IN] notifyFlags Bitmap of the modified groups, LORAMAC_NVM_NOTIFY_FLAG_XXX
+ */
+void LoRaMacNvmSetDirty( uint16_t notifyFlags );
+
 /*!
  * \brief   Queries the LoRaMAC if it is possible to send the next frame with           查询LoRaMAC是否可以发送具有给定应用程序数据有效负载大小的下一帧。LoRaMAC考虑预定的MAC命令，并报告何时可以发送帧或不发送帧。
  *          a given application data payload size. The LoRaMAC takes scheduled
@@ -2498,6 +2543,64 @@ void LoRaMacProcess( void );
  */
 LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo );
 
+/*!
+ * \brief   Queries the LoRaMAC for the time-on-air of the next frame with a given
+ *          application data payload size, on the current datarate. Scheduled MAC
+ *          commands which fit into the FOpts field are taken into account.
+ *
+ * \param   [IN] size - Size of application data payload to be send next
+ *
+ * \param   [OUT] timeOnAir - Time-on-air of the frame [ms]
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. When the parameters are
+ *          not valid, the function returns \ref LORAMAC_STATUS_PARAMETER_INVALID.
+ */
+LoRaMacStatus_t LoRaMacQueryTimeOnAir( uint8_t size, TimerTime_t* timeOnAir );
+
+/*!
+ * \brief   Queries the LoRaMAC for the time to wait until the next frame with a
+ *          given application data payload size may be sent, according to the
+ *          duty-cycle restrictions. The state of the LoRaMAC is left untouched.
+ *
+ * \remark  The channel selection runs on the band and channel mask state of
+ *          the MAC and restores it afterwards, call it only from the task that
+ *          runs \ref LoRaMacProcess.
+ *
+ * \param   [IN] size - Size of application data payload to be send next
+ *
+ * \param   [OUT] delay - Time to wait [ms], 0 when the frame may be sent now
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. The function returns
+ *          \ref LORAMAC_STATUS_NO_CHANNEL_FOUND when no channel will ever
+ *          accept the frame, and \ref LORAMAC_STATUS_OK otherwise.
+ */
+LoRaMacStatus_t LoRaMacQueryTxDelay( uint8_t size, TimerTime_t* delay );
+
+/*!
+ * \brief   Queries the LoRaMAC for the number of duty-cycle bands of the
+ *          active region.
+ *
+ * \param   [OUT] count - Number of bands
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. When the parameters are
+ *          not valid, the function returns \ref LORAMAC_STATUS_PARAMETER_INVALID.
+ */
+LoRaMacStatus_t LoRaMacQueryBandCount( uint8_t* count );
+
+/*!
+ * \brief   Queries the LoRaMAC for the duty-cycle budget of a band. The state
+ *          of the LoRaMAC is left untouched.
+ *
+ * \param   [IN] band - Index of the band, below the count given by
+ *                      \ref LoRaMacQueryBandCount
+ *
+ * \param   [OUT] budget - Budget of the band
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. When the parameters are
+ *          not valid, the function returns \ref LORAMAC_STATUS_PARAMETER_INVALID.
+ */
+LoRaMacStatus_t LoRaMacQueryBandBudget( uint8_t band, LoRaMacBandBudget_t* budget );
+
 /*!
  * \brief   LoRaMAC channel add service
  *
@@ -410,6 +410,7 @@ static void InitClassB( void )
 
     // Init variables to default
     memset1( ( uint8_t* ) ClassBNvm, 0, sizeof( LoRaMacClassBNvmData_t ) );
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B );
     memset1( ( uint8_t* ) &Ctx.PingSlotCtx, 0, sizeof( PingSlotContext_t ) );
     memset1( ( uint8_t* ) &Ctx.BeaconCtx, 0, sizeof( BeaconContext_t ) );
 
@@ -445,6 +446,7 @@ static void InitClassBDefaults( void )
     ClassBNvm->PingSlotCtx.Ctrl.CustomFreq = pingSlotCtx.Ctrl.CustomFreq;
     ClassBNvm->PingSlotCtx.Frequency = pingSlotCtx.Frequency;
     ClassBNvm->PingSlotCtx.Datarate = pingSlotCtx.Datarate;
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B );
 }
 
 static void EnlargeWindowTimeout( void )
@@ -638,7 +640,7 @@ bool LoRaMacClassBIsAcquisitionInProgress( void )
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
-void LoRaMacClassBBeaconTimerEvent( void )
+void LoRaMacClassBBeaconTimerEvent( void* context )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
     Ctx.BeaconCtx.TimeStamp = TimerGetCurrentTime( );
@@ -902,7 +904,7 @@ static void LoRaMacClassBProcessBeacon( void )
 }
 #endif // LORAMAC_CLASSB_ENABLED
 
-void LoRaMacClassBPingSlotTimerEvent( void )
+void LoRaMacClassBPingSlotTimerEvent( void* context )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
     LoRaMacClassBEvents.Events.PingSlot = 1;
@@ -1012,7 +1014,7 @@ static void LoRaMacClassBProcessPingSlot( void )
 }
 #endif // LORAMAC_CLASSB_ENABLED
 
-void LoRaMacClassBMulticastSlotTimerEvent( void )
+void LoRaMacClassBMulticastSlotTimerEvent( void* context )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
     LoRaMacClassBEvents.Events.MulticastSlot = 1;
@@ -1259,14 +1261,14 @@ bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size )
                 ResetWindowTimeout( );
                 Ctx.BeaconState = BEACON_STATE_LOCKED;
 
-                LoRaMacClassBBeaconTimerEvent( );
+                LoRaMacClassBBeaconTimerEvent( NULL );
             }
         }
 
         if( Ctx.BeaconState == BEACON_STATE_RX )
         {
             Ctx.BeaconState = BEACON_STATE_TIMEOUT;
-            LoRaMacClassBBeaconTimerEvent( );
+            LoRaMacClassBBeaconTimerEvent( NULL );
         }
         // When the MAC listens for a beacon, it is not allowed to process any other
         // downlink except the beacon frame itself. The reason for this is that no valid downlink window is open.
@@ -1355,6 +1357,7 @@ void LoRaMacClassBSetPingSlotInfo( uint8_t periodicity )
 #ifdef LORAMAC_CLASSB_ENABLED
     ClassBNvm->PingSlotCtx.PingNb = CalcPingNb( periodicity );
     ClassBNvm->PingSlotCtx.PingPeriod = CalcPingPeriod( ClassBNvm->PingSlotCtx.PingNb );
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B );
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
@@ -1367,7 +1370,7 @@ void LoRaMacClassBHaltBeaconing( void )
             ( Ctx.BeaconState == BEACON_STATE_LOST ) )
         {
             // Update the state machine before halt
-            LoRaMacClassBBeaconTimerEvent( );
+            LoRaMacClassBBeaconTimerEvent( NULL );
         }
 
         CRITICAL_SECTION_BEGIN( );
@@ -1402,7 +1405,7 @@ void LoRaMacClassBResumeBeaconing( void )
             Ctx.BeaconState = BEACON_STATE_REACQUISITION;
         }
 
-        LoRaMacClassBBeaconTimerEvent( );
+        LoRaMacClassBBeaconTimerEvent( NULL );
     }
 #endif // LORAMAC_CLASSB_ENABLED
 }
@@ -1466,6 +1469,7 @@ LoRaMacStatus_t LoRaMacMibClassBSetRequestConfirm( MibRequestConfirm_t *mibSet )
         case MIB_PING_SLOT_DATARATE:
         {
             ClassBNvm->PingSlotCtx.Datarate = mibSet->Param.PingSlotDatarate;
+            LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B );
             break;
         }
         default:
@@ -1487,6 +1491,7 @@ void LoRaMacClassBPingSlotInfoAns( void )
     {
         LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_PING_SLOT_INFO );
         ClassBNvm->PingSlotCtx.Ctrl.Assigned = 1;
+        LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B );
     }
 #endif // LORAMAC_CLASSB_ENABLED
 }
@@ -1529,6 +1534,7 @@ uint8_t LoRaMacClassBPingSlotChannelReq( uint8_t datarate, uint32_t frequency )
             ClassBNvm->PingSlotCtx.Frequency = 0;
         }
         ClassBNvm->PingSlotCtx.Datarate = datarate;
+        LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B );
     }
 
     return status;
@@ -1615,12 +1621,14 @@ bool LoRaMacClassBBeaconFreqReq( uint32_t frequency )
         {
             ClassBNvm->BeaconCtx.Ctrl.CustomFreq = 1;
             ClassBNvm->BeaconCtx.Frequency = frequency;
+            LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B );
             return true;
         }
     }
     else
     {
         ClassBNvm->BeaconCtx.Ctrl.CustomFreq = 0;
+        LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B );
         return true;
     }
     return false;
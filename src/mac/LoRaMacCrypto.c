@@ -40,6 +40,7 @@
 #include "LoRaMacParser.h"
 #include "LoRaMacSerializer.h"
 #include "LoRaMacCrypto.h"
+#include "LoRaMac.h"
 #include <Arduino.h>
 #include "system/crypto/aes.h"
 
@@ -681,6 +682,7 @@ static LoRaMacCryptoStatus_t GetLastFcntDown( FCntIdentifier_t fCntID, uint32_t*
     {
         return LORAMAC_CRYPTO_ERROR_NPE;
     }
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
     switch( fCntID )
     {
         case N_FCNT_DOWN:
@@ -758,6 +760,7 @@ static bool CheckFCntDown( FCntIdentifier_t fCntID, uint32_t currentDown )
  */
 static void UpdateFCntDown( FCntIdentifier_t fCntID, uint32_t currentDown )
 {
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
     switch( fCntID )
     {
         case N_FCNT_DOWN:
@@ -799,6 +802,7 @@ static void UpdateFCntDown( FCntIdentifier_t fCntID, uint32_t currentDown )
  */
 static void ResetFCnts( void )
 {
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
     CryptoNvm->FCntList.FCntUp = 0;
     CryptoNvm->FCntList.NFCntDown = FCNT_DOWN_INITAL_VALUE;
     CryptoNvm->FCntList.AFCntDown = FCNT_DOWN_INITAL_VALUE;
@@ -826,6 +830,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoInit( LoRaMacCryptoNvmData_t* nvm )
 
     // Initialize with default
     memset1( ( uint8_t* )CryptoNvm, 0, sizeof( LoRaMacCryptoNvmData_t ) );
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
 
     // Set default LoRaWAN version
     CryptoNvm->LrWanVersion.Fields.Major = 1;
@@ -842,6 +847,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoInit( LoRaMacCryptoNvmData_t* nvm )
 LoRaMacCryptoStatus_t LoRaMacCryptoSetLrWanVersion( Version_t version )
 {
     CryptoNvm->LrWanVersion = version;
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
     return LORAMAC_CRYPTO_SUCCESS;
 }
 
@@ -944,6 +950,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoSetMulticastReference( MulticastCtx_t* multic
     {
         multicastList[i].DownLinkCounter = &CryptoNvm->FCntList.McFCntDown[i];
     }
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 );
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
@@ -985,6 +992,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoPrepareJoinRequest( LoRaMacMessageJoinRequest
 #else
     CryptoNvm->DevNonce++;
 #endif
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
     macMsg->DevNonce = CryptoNvm->DevNonce;
 
 #if( USE_LRWAN_1_1_X_CRYPTO == 1 )
@@ -1055,6 +1063,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoPrepareReJoinType1( LoRaMacMessageReJoinType1
 
     // Increment RJcount1
     CryptoNvm->FCntList.RJcount1++;
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
@@ -1164,6 +1173,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
 #endif
     {
         CryptoNvm->JoinNonce = currentJoinNonce;
+        LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
     }
     else
     {
@@ -1260,6 +1270,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
     CryptoNvm->FCntList.FCntDown = FCNT_DOWN_INITAL_VALUE;
     CryptoNvm->FCntList.NFCntDown = FCNT_DOWN_INITAL_VALUE;
     CryptoNvm->FCntList.AFCntDown = FCNT_DOWN_INITAL_VALUE;
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
@@ -1356,6 +1367,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoSecureMessage( uint32_t fCntUp, uint8_t txDr,
     }
 
     CryptoNvm->FCntList.FCntUp = fCntUp;
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
@@ -1538,15 +1550,26 @@ LoRaMacCryptoStatus_t LoRaMacCryptoDeriveMcSessionKeyPair( AddressIdentifier_t a
 }
 
 void LoRaMacPayloadEncrypt(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer)
+{
+    SoftSeAesKey_t aesKey;
+
+    memset1((uint8_t*)&aesKey, 0, sizeof(aesKey));
+    if(SoftSeAesSetKey(&aesKey, key) == false)
+    {
+        // Never hand the plain buffer back as the result
+        memset1(encBuffer, 0, size);
+        return;
+    }
+	LoRaMacPayloadEncryptPrekeyed(buffer, size, &aesKey, address, dir, sequenceCounter, encBuffer);
+    SoftSeAesFreeKey(&aesKey);
+}
+
+void LoRaMacPayloadEncryptPrekeyed(const uint8_t *buffer, uint16_t size, SoftSeAesKey_t *aesKey, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer)
 {
 	uint16_t i;
 	uint8_t bufferIndex = 0;
 	uint16_t ctr = 1;
 
-    aes_context AesContext;
-	memset1(AesContext.ksch, '\0', 240);
-	aes_set_key(key, 16, &AesContext);
-
     uint8_t aBlock[] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
     uint8_t sBlock[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
@@ -1566,7 +1589,7 @@ void LoRaMacPayloadEncrypt(const uint8_t *buffer, uint16_t size, const uint8_t *
 	{
 		aBlock[15] = ((ctr)&0xFF);
 		ctr++;
-		lora_aes_encrypt(aBlock, sBlock, &AesContext);
+		SoftSeAesEncrypt(aesKey, aBlock, sBlock);
 		for (i = 0; i < 16; i++)
 		{
 			encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
@@ -1578,7 +1601,7 @@ void LoRaMacPayloadEncrypt(const uint8_t *buffer, uint16_t size, const uint8_t *
 	if (size > 0)
 	{
 		aBlock[15] = ((ctr)&0xFF);
-		lora_aes_encrypt(aBlock, sBlock, &AesContext);
+		SoftSeAesEncrypt(aesKey, aBlock, sBlock);
 		for (i = 0; i < size; i++)
 		{
 			encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
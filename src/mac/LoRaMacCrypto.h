@@ -49,6 +49,7 @@ extern "C"
 #include "LoRaMacTypes.h"
 #include "LoRaMacMessageTypes.h"
 #include "LoRaMacCryptoNvm.h"
+#include "system/crypto/soft-se-aes.h"
 
 /*!
  * Indicates if LoRaWAN 1.1.x crypto scheme is enabled 表示是否为LoRaWAN 1.1。启用X加密方案
@@ -339,6 +340,21 @@ LoRaMacCryptoStatus_t LoRaMacCryptoDeriveMcSessionKeyPair( AddressIdentifier_t a
  */
 void LoRaMacPayloadEncrypt(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer);
 
+/*!
+ * Computes the LoRaMAC payload encryption with an already expanded key
+ *
+ * \remark buffer and encBuffer may be the same buffer
+ *
+ * \param   buffer          - Data buffer
+ * \param   size            - Data buffer size
+ * \param   aesKey          - AES key set up with SoftSeAesSetKey
+ * \param   address         - Frame address
+ * \param   dir             - Frame direction [0: uplink, 1: downlink]
+ * \param   sequenceCounter - Frame sequence counter
+ * \param   encBuffer       - Encrypted buffer
+ */
+void LoRaMacPayloadEncryptPrekeyed(const uint8_t *buffer, uint16_t size, SoftSeAesKey_t *aesKey, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer);
+
 /*!
  * Computes the LoRaMAC payload decryption
  *
@@ -200,6 +200,10 @@ typedef enum ePhyAttribute
      * Maximum number of supported channels
      */
     PHY_MAX_NB_CHANNELS,
+    /*!
+     * Number of duty-cycle bands
+     */
+    PHY_MAX_NB_BANDS,
     /*!
      * Channels.
      */
@@ -318,6 +322,10 @@ typedef enum ePhyAttribute
      * The equivalent bandwith index from datarate
      */
     PHY_BW_FROM_DR,
+    /*!
+     * The time-on-air of an uplink frame [ms]
+     */
+    PHY_TIME_ON_AIR,
 }PhyAttribute_t;
 
 /*!
@@ -418,7 +426,8 @@ typedef struct sGetPhyParams
     /*!
      * Datarate.
      * The parameter is needed for the following queries:
-     * PHY_MAX_PAYLOAD, PHY_NEXT_LOWER_TX_DR, PHY_SF_FROM_DR, PHY_BW_FROM_DR.
+     * PHY_MAX_PAYLOAD, PHY_NEXT_LOWER_TX_DR, PHY_SF_FROM_DR, PHY_BW_FROM_DR,
+     * PHY_TIME_ON_AIR.
      */
     int8_t Datarate;
     /*!
@@ -441,6 +450,12 @@ typedef struct sGetPhyParams
      * PHY_BEACON_CHANNEL_FREQ, PHY_PING_SLOT_CHANNEL_FREQ
      */
     uint8_t Channel;
+    /*!
+     * PHY payload length of the frame.
+     * The parameter is needed for the following queries:
+     * PHY_TIME_ON_AIR
+     */
+    uint16_t PktLen;
 }GetPhyParams_t;
 
 /*!
@@ -586,9 +601,13 @@ typedef struct sRxConfigParams
      */
      uint32_t WindowTimeout;
     /*!
-     * RX window offset
+     * RX window offset [ms]
      */
     int32_t WindowOffset;
+    /*!
+     * RX window offset [us]
+     */
+    int32_t WindowOffsetUs;
     /*!
      * Downlink dwell time.
      */
@@ -497,12 +497,13 @@ uint32_t RegionCommonComputeSymbolTimeFsk( uint8_t phyDrInKbps )
     return 8000 / ( uint32_t )phyDrInKbps; // 1 symbol equals 1 byte
 }
 
-void RegionCommonComputeRxWindowParameters( uint32_t tSymbolInUs, uint8_t minRxSymbols, uint32_t rxErrorInMs, uint32_t wakeUpTimeInMs, uint32_t* windowTimeoutInSymbols, int32_t* windowOffsetInMs )
+void RegionCommonComputeRxWindowParameters( uint32_t tSymbolInUs, uint8_t minRxSymbols, uint32_t rxErrorInMs, uint32_t wakeUpTimeInMs, uint32_t* windowTimeoutInSymbols, int32_t* windowOffsetInMs, int32_t* windowOffsetInUs )
 {
     *windowTimeoutInSymbols = MAX( DIV_CEIL( ( ( 2 * minRxSymbols - 8 ) * tSymbolInUs + 2 * ( rxErrorInMs * 1000 ) ),  tSymbolInUs ), minRxSymbols ); // Computed number of symbols
-    *windowOffsetInMs = ( int32_t )DIV_CEIL( ( int32_t )( 4 * tSymbolInUs ) -
-                                               ( int32_t )DIV_CEIL( ( *windowTimeoutInSymbols * tSymbolInUs ), 2 ) -
-                                               ( int32_t )( wakeUpTimeInMs * 1000 ), 1000 );
+    *windowOffsetInUs = ( int32_t )( 4 * tSymbolInUs ) -
+                        ( int32_t )DIV_CEIL( ( *windowTimeoutInSymbols * tSymbolInUs ), 2 ) -
+                        ( int32_t )( wakeUpTimeInMs * 1000 );
+    *windowOffsetInMs = ( int32_t )DIV_CEIL( *windowOffsetInUs, 1000 );
 }
 
 int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float antennaGain )
@@ -668,3 +669,49 @@ uint32_t RegionCommonGetBandwidth( uint32_t drIndex, const uint32_t* bandwidths
             return 2;
     }
 }
+
+#if( REGION_COMMON_TOA_TABLE_ENABLE == 1 )
+/*!
+ * Time-on-air table [ms], 0 marks an entry not computed yet. 8 KB of .bss
+ * with the default sizes, see REGION_COMMON_TOA_TABLE_ENABLE.
+ */
+static uint16_t TimeOnAirTable[REGION_COMMON_TOA_TABLE_DATARATES][REGION_COMMON_TOA_TABLE_PKT_LEN];
+
+/*!
+ * Region function the table entries were computed with
+ */
+static RegionCommonComputeTimeOnAir_t TimeOnAirTableOwner = NULL;
+
+TimerTime_t RegionCommonGetTimeOnAir( int8_t datarate, uint16_t pktLen, RegionCommonComputeTimeOnAir_t computeTimeOnAir )
+{
+    TimerTime_t timeOnAir;
+
+    if( ( datarate < 0 ) || ( datarate >= REGION_COMMON_TOA_TABLE_DATARATES ) ||
+        ( pktLen >= REGION_COMMON_TOA_TABLE_PKT_LEN ) )
+    {
+        return computeTimeOnAir( datarate, pktLen );
+    }
+
+    if( TimeOnAirTableOwner != computeTimeOnAir )
+    {
+        memset1( ( uint8_t* )TimeOnAirTable, 0, sizeof( TimeOnAirTable ) );
+        TimeOnAirTableOwner = computeTimeOnAir;
+    }
+
+    timeOnAir = TimeOnAirTable[datarate][pktLen];
+    if( timeOnAir == 0 )
+    {
+        timeOnAir = computeTimeOnAir( datarate, pktLen );
+        if( timeOnAir <= UINT16_MAX )
+        {
+            TimeOnAirTable[datarate][pktLen] = ( uint16_t )timeOnAir;
+        }
+    }
+    return timeOnAir;
+}
+#else
+TimerTime_t RegionCommonGetTimeOnAir( int8_t datarate, uint16_t pktLen, RegionCommonComputeTimeOnAir_t computeTimeOnAir )
+{
+    return computeTimeOnAir( datarate, pktLen );
+}
+#endif
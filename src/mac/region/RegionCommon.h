@@ -511,8 +511,10 @@ uint32_t RegionCommonComputeSymbolTimeFsk( uint8_t phyDrInKbps );
  * \param [OUT] windowTimeoutInSymbols RX window timeout.
  *
  * \param [OUT] windowOffsetInMs RX window time offset to be applied to the RX delay.
+ *
+ * \param [OUT] windowOffsetInUs Same offset in microseconds, not rounded.
  */
-void RegionCommonComputeRxWindowParameters( uint32_t tSymbolInUs, uint8_t minRxSymbols, uint32_t rxErrorInMs, uint32_t wakeUpTimeInMs, uint32_t* windowTimeoutInSymbols, int32_t* windowOffsetInMs );
+void RegionCommonComputeRxWindowParameters( uint32_t tSymbolInUs, uint8_t minRxSymbols, uint32_t rxErrorInMs, uint32_t wakeUpTimeInMs, uint32_t* windowTimeoutInSymbols, int32_t* windowOffsetInMs, int32_t* windowOffsetInUs );
 
 /*!
  * \brief Computes the txPower, based on the max EIRP and the antenna gain.
@@ -611,6 +613,49 @@ int8_t RegionCommonLimitTxPower( int8_t txPower, int8_t maxBandTxPower );
  */
 uint32_t RegionCommonGetBandwidth( uint32_t drIndex, const uint32_t* bandwidths );
 
+/*!
+ * Enables the time-on-air table. It takes REGION_COMMON_TOA_TABLE_DATARATES *
+ * REGION_COMMON_TOA_TABLE_PKT_LEN 16-bit entries of static RAM, 8 KB with the
+ * default sizes. Define it to 0 on builds short of RAM, the time-on-air is
+ * then computed on every call.
+ */
+#ifndef REGION_COMMON_TOA_TABLE_ENABLE
+#define REGION_COMMON_TOA_TABLE_ENABLE              1
+#endif
+
+/*!
+ * Number of datarates covered by the time-on-air table
+ */
+#define REGION_COMMON_TOA_TABLE_DATARATES           16
+
+/*!
+ * Number of PHY payload lengths covered by the time-on-air table
+ */
+#define REGION_COMMON_TOA_TABLE_PKT_LEN             256
+
+/*!
+ * Region function computing the time-on-air of a frame [ms]
+ */
+typedef TimerTime_t ( *RegionCommonComputeTimeOnAir_t )( int8_t datarate, uint16_t pktLen );
+
+/*!
+ * \brief Gets the time-on-air of a frame from the time-on-air table.
+ *
+ * \remark The table holds one entry per datarate and PHY payload length. Each
+ *         entry is computed once on first use, the table is cleared when
+ *         another region starts using it. Without REGION_COMMON_TOA_TABLE_ENABLE
+ *         the region function is called every time.
+ *
+ * \param [IN] datarate Datarate of the frame.
+ *
+ * \param [IN] pktLen PHY payload length of the frame.
+ *
+ * \param [IN] computeTimeOnAir Region function computing missing entries.
+ *
+ * \retval Time-on-air [ms].
+ */
+TimerTime_t RegionCommonGetTimeOnAir( int8_t datarate, uint16_t pktLen, RegionCommonComputeTimeOnAir_t computeTimeOnAir );
+
 /*! \} defgroup REGIONCOMMON */
 
 #ifdef __cplusplus
@@ -0,0 +1,175 @@
+/*!
+ * \file      radio-latency.c
+ *
+ * \brief     Latency histograms of the radio interrupt path
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "system/utilities.h"
+#include "boards/mcu/board.h"
+#include "boards/rtc-board.h"
+#include "radio/radio-latency.h"
+
+#if RADIO_LATENCY_ENABLE
+
+/*!
+ * Four buckets per power of two, the bucket width is at most a quarter of its
+ * lower bound. Latencies above 2^24 us go to the last bucket.
+ */
+#define RADIO_LATENCY_SUB_BUCKETS                   4
+#define RADIO_LATENCY_MAX_US                        ( ( 1UL << 24 ) - 1 )
+#define RADIO_LATENCY_BUCKETS                       ( 23 * RADIO_LATENCY_SUB_BUCKETS )
+
+typedef struct
+{
+    uint32_t Count;
+    uint32_t Min;
+    uint32_t Max;
+    uint64_t Sum;
+    uint32_t Histogram[RADIO_LATENCY_BUCKETS];
+} RadioLatencyStage_t;
+
+static RadioLatencyStage_t Stages[RADIO_LATENCY_STAGE_MAX];
+
+/*!
+ * Time of the last interrupt and the stages not reached since, written by the
+ * ISR and the LoRa task inside BoardDisableIrq
+ */
+static uint32_t IrqTimeUs = 0;
+static uint8_t PendingStages = 0;
+
+static uint8_t RadioLatencyBucket( uint32_t us )
+{
+    uint8_t exponent;
+
+    if( us < RADIO_LATENCY_SUB_BUCKETS )
+    {
+        return us;
+    }
+    if( us > RADIO_LATENCY_MAX_US )
+    {
+        us = RADIO_LATENCY_MAX_US;
+    }
+    exponent = 31 - __builtin_clz( us );
+    return ( exponent - 1 ) * RADIO_LATENCY_SUB_BUCKETS + ( ( us >> ( exponent - 2 ) ) & ( RADIO_LATENCY_SUB_BUCKETS - 1 ) );
+}
+
+/*!
+ * \brief Largest latency held by a bucket
+ */
+static uint32_t RadioLatencyBucketTop( uint8_t bucket )
+{
+    uint8_t exponent;
+
+    if( bucket < RADIO_LATENCY_SUB_BUCKETS )
+    {
+        return bucket;
+    }
+    exponent = bucket / RADIO_LATENCY_SUB_BUCKETS + 1;
+    return ( ( ( RADIO_LATENCY_SUB_BUCKETS + ( bucket % RADIO_LATENCY_SUB_BUCKETS ) + 1 ) << ( exponent - 2 ) ) - 1 );
+}
+
+void IRAM_ATTR RadioLatencyIrq( void )
+{
+    BoardDisableIrq( );
+    IrqTimeUs = ( uint32_t )RtcGetTimeUs( );
+    PendingStages = ( 1 << RADIO_LATENCY_STAGE_MAX ) - 1;
+    BoardEnableIrq( );
+}
+
+void RadioLatencyMark( eRadioLatencyStage_t stage )
+{
+    uint32_t now = ( uint32_t )RtcGetTimeUs( );
+    uint32_t elapsed;
+    RadioLatencyStage_t *s = &Stages[stage];
+
+    BoardDisableIrq( );
+    if( ( PendingStages & ( 1 << stage ) ) == 0 )
+    {
+        BoardEnableIrq( );
+        return;
+    }
+    PendingStages &= ~( 1 << stage );
+    elapsed = now - IrqTimeUs;
+
+    if( ( s->Count == 0 ) || ( elapsed < s->Min ) )
+    {
+        s->Min = elapsed;
+    }
+    if( elapsed > s->Max )
+    {
+        s->Max = elapsed;
+    }
+    s->Count++;
+    s->Sum += elapsed;
+    s->Histogram[RadioLatencyBucket( elapsed )]++;
+    BoardEnableIrq( );
+}
+
+bool RadioLatencyGetStats( eRadioLatencyStage_t stage, sRadioLatencyStats_t *stats )
+{
+    RadioLatencyStage_t copy;
+    RadioLatencyStage_t *s = &copy;
+    uint32_t rank;
+    uint32_t seen = 0;
+    uint8_t i;
+
+    memset( stats, 0, sizeof( sRadioLatencyStats_t ) );
+    if( stage >= RADIO_LATENCY_STAGE_MAX )
+    {
+        return false;
+    }
+
+    // Copied with the interrupts masked, the 64-bit sum would tear otherwise
+    BoardDisableIrq( );
+    copy = Stages[stage];
+    BoardEnableIrq( );
+
+    stats->count = s->Count;
+    if( s->Count != 0 )
+    {
+        stats->minUs = s->Min;
+        stats->maxUs = s->Max;
+        stats->avgUs = ( uint32_t )( s->Sum / s->Count );
+
+        // Smallest latency at or above 99 % of the samples
+        rank = s->Count - s->Count / 100;
+        for( i = 0; i < RADIO_LATENCY_BUCKETS; i++ )
+        {
+            seen += s->Histogram[i];
+            if( seen >= rank )
+            {
+                break;
+            }
+        }
+        stats->p99Us = RadioLatencyBucketTop( i );
+        if( stats->p99Us > stats->maxUs )
+        {
+            stats->p99Us = stats->maxUs;
+        }
+    }
+    return true;
+}
+
+void RadioLatencyReset( void )
+{
+    BoardDisableIrq( );
+    memset( Stages, 0, sizeof( Stages ) );
+    PendingStages = 0;
+    BoardEnableIrq( );
+}
+
+#else
+
+bool RadioLatencyGetStats( eRadioLatencyStage_t stage, sRadioLatencyStats_t *stats )
+{
+    ( void )stage;
+    memset( stats, 0, sizeof( sRadioLatencyStats_t ) );
+    return false;
+}
+
+void RadioLatencyReset( void )
+{
+}
+
+#endif
@@ -0,0 +1,92 @@
+/*!
+ * \file      radio-latency.h
+ *
+ * \brief     Latency histograms of the radio interrupt path
+ *
+ * \remark    Each DIO1 interrupt is time stamped in the ISR. The first time
+ *            each later stage runs after it, the time since the interrupt is
+ *            added to the histogram of that stage:
+ *            ISR -> LoRa task woken -> IRQ status read -> TxDone/RxDone
+ *            delivered to the MAC or DFRobot_LoRaRadio.
+ *
+ *            The instrumentation is compiled out unless RADIO_LATENCY_ENABLE
+ *            is set to 1.
+ */
+#ifndef __RADIO_LATENCY_H__
+#define __RADIO_LATENCY_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef RADIO_LATENCY_ENABLE
+#define RADIO_LATENCY_ENABLE 0              ///< 1: time stamp the radio interrupt path
+#endif
+
+/*!
+ * Stages of the radio interrupt path, measured from the DIO1 interrupt
+ */
+typedef enum
+{
+    RADIO_LATENCY_TASK_WAKE = 0,            /**<LoRa task woken by the interrupt>*/
+    RADIO_LATENCY_IRQ_STATUS,               /**<IRQ status read from the radio>*/
+    RADIO_LATENCY_EVENT,                    /**<TxDone or RxDone handed to the radio user>*/
+    RADIO_LATENCY_STAGE_MAX,
+} eRadioLatencyStage_t;
+
+/*!
+ * Latency summary of one stage, in microseconds
+ */
+typedef struct
+{
+    uint32_t count;                         /**<Interrupts measured>*/
+    uint32_t minUs;                         /**<Shortest latency>*/
+    uint32_t avgUs;                         /**<Average latency>*/
+    uint32_t p99Us;                         /**<99th percentile, upper bound of its histogram bucket>*/
+    uint32_t maxUs;                         /**<Longest latency>*/
+} sRadioLatencyStats_t;
+
+#if RADIO_LATENCY_ENABLE
+/*!
+ * \brief Time stamps a radio interrupt, called from the DIO1 ISR
+ */
+void RadioLatencyIrq( void );
+
+/*!
+ * \brief Records the time since the last interrupt when the stage runs first after it
+ *
+ * \param [IN] stage Stage reached
+ */
+void RadioLatencyMark( eRadioLatencyStage_t stage );
+
+#define RADIO_LATENCY_IRQ( )                RadioLatencyIrq( )
+#define RADIO_LATENCY_MARK( stage )         RadioLatencyMark( stage )
+#else
+#define RADIO_LATENCY_IRQ( )
+#define RADIO_LATENCY_MARK( stage )
+#endif
+
+/*!
+ * \brief Gets the latency summary of a stage
+ *
+ * \param [IN]  stage Stage
+ * \param [OUT] stats Summary, zeroed when nothing was measured
+ *
+ * \retval false when the instrumentation is compiled out or stage is invalid
+ */
+bool RadioLatencyGetStats( eRadioLatencyStage_t stage, sRadioLatencyStats_t *stats );
+
+/*!
+ * \brief Clears the histograms of all the stages
+ */
+void RadioLatencyReset( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RADIO_LATENCY_H__
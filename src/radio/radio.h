@@ -51,6 +51,14 @@ typedef enum
     RF_CAD,        //!< The radio is doing channel activity detection   正在进行信道活动探测
 }RadioState_t;
 
+/*!
+ * Radio driver faults reported through RadioEvents_t::Fault   天线驱动故障
+ */
+typedef enum
+{
+    RADIO_FAULT_BUSY_TIMEOUT = 0, //!< The radio kept its BUSY line high too long   BUSY超时
+}RadioFault_t;
+
 /*!
  * \brief Radio driver callback functions   天线驱动回调函数
  */
@@ -111,6 +119,13 @@ typedef struct
      * \brief Preamble detected callback prototype.     前导码检测回调原型
      */
 	void (*PreAmpDetect)(void);
+
+    /*!
+     * \brief Radio fault callback prototype.           无线电故障回调原型
+     *
+     * \param [IN] fault Detected fault
+     */
+    void    ( *Fault )( RadioFault_t fault );
 }RadioEvents_t;
 
 /*!
@@ -404,8 +419,8 @@ struct Radio_s
      *
      * \remark Available on SX126x radios only.
      *
-     * \param [in]  rxTime        Structure describing reception timeout value
-     * \param [in]  sleepTime     Structure describing sleep timeout value
+     * \param [in]  rxTime        Reception window [15.625 us steps]
+     * \param [in]  sleepTime     Sleep period between windows [15.625 us steps]
      */
     void ( *SetRxDutyCycle ) ( uint32_t rxTime, uint32_t sleepTime );
 	/*!
@@ -429,6 +444,12 @@ struct Radio_s
       * \brief Process radio irq after CPU wakeup from deep sleep
      */
 	void (*IrqProcessAfterDeepSleep)(void);
+    /*!
+     * \brief Gets the time of the last radio interrupt, stamped in the ISR    获取最近一次中断的时间
+     *
+     * \retval time Interrupt time on the RtcGetTimeUs clock [us]
+     */
+	uint64_t (*GetIrqTimeUs)(void);
 	
 };
 
@@ -28,7 +28,9 @@
 // #include "delay.h"   用esp32内置延迟函数delay代替
 #include "radio/radio.h"
 #include "boards/sx126x-board.h"
+#include "radio/radio-latency.h"
 #include "boards/mcu/board.h"
+#include "boards/rtc-board.h"
 
 /*!
  * \brief Initializes the radio
@@ -370,6 +372,11 @@ void RadioBgIrqProcess(void);
  */
 void RadioIrqProcessAfterDeepSleep(void);
 
+/*!
+ * \brief Gets the time of the last DIO1 interrupt
+ */
+uint64_t RadioGetIrqTimeUs(void);
+
 /*!
  * Radio driver structure initialization
  */
@@ -406,7 +413,8 @@ const struct Radio_s Radio =
     RadioBgIrqProcess,
     RadioReInit,
     RadioSetCadParams,
-    RadioIrqProcessAfterDeepSleep
+    RadioIrqProcessAfterDeepSleep,
+    RadioGetIrqTimeUs
 };
 
 const struct Radio_s Radio2 =
@@ -442,7 +450,8 @@ const struct Radio_s Radio2 =
     RadioBgIrqProcess,
     RadioReInit,
     RadioSetCadParams,
-    RadioIrqProcessAfterDeepSleep
+    RadioIrqProcessAfterDeepSleep,
+    RadioGetIrqTimeUs
 };
 
 /*
@@ -509,8 +518,18 @@ bool DRAM_ATTR IrqFired = false;
 bool IrqFired = false;
 #endif
 
+/*!
+ * Time of the last DIO1 interrupt [us], written with IrqFired
+ */
+#if defined(ESP32)
+static uint64_t DRAM_ATTR IrqTimeUs = 0;
+#else
+static uint64_t IrqTimeUs = 0;
+#endif
+
 bool TimerRxTimeout = false;
 bool TimerTxTimeout = false;
+bool BusyTimeoutFired = false;
 /*
  * SX126x DIO IRQ callback functions prototype
  */
@@ -520,15 +539,20 @@ bool TimerTxTimeout = false;
  */
 void RadioOnDioIrq( void );
 
+/*!
+ * \brief BUSY wait timeout callback
+ */
+void RadioOnBusyTimeout( void );
+
 /*!
  * \brief Tx timeout timer callback
  */
-void RadioOnTxTimeoutIrq( void );
+void RadioOnTxTimeoutIrq( void* context );
 
 /*!
  * \brief Rx timeout timer callback
  */
-void RadioOnRxTimeoutIrq( void );
+void RadioOnRxTimeoutIrq( void* context );
 
 /*
  * Private global variables
@@ -596,6 +620,7 @@ void RadioInit( RadioEvents_t *events )
 {
     RadioEvents = events;
 
+    SX126xIoFaultInit( RadioOnBusyTimeout );
     SX126xInit( RadioOnDioIrq );
     SX126xSetStandby( STDBY_RC );
     SX126xSetRegulatorMode( USE_DCDC );
@@ -617,6 +642,7 @@ void RadioInit2( RadioEvents_t *events )
 {
     RadioEvents = events;
 
+    SX126xIoFaultInit( RadioOnBusyTimeout );
     SX126xInit2( RadioOnDioIrq );
     SX126xSetStandby( STDBY_RC );
     SX126xSetRegulatorMode( USE_DCDC );
@@ -637,6 +663,7 @@ void RadioInit2( RadioEvents_t *events )
 void RadioReInit(RadioEvents_t *events)
 {
 	RadioEvents = events;
+	SX126xIoFaultInit(RadioOnBusyTimeout);
 	SX126xReInit(RadioOnDioIrq);
 
 	// Initialize driver timeout timers
@@ -1144,6 +1171,8 @@ uint32_t RadioTimeOnAir( RadioModems_t modem, uint32_t bandwidth,
 
 void RadioSend( uint8_t *buffer, uint8_t size )
 {
+    SX126xSpiAccount_t spiAccount = SX126xSetSpiAccount( SX126X_SPI_ACCOUNT_SEND );
+
     SX126xTXena();  // mating new add
     SX126xSetDioIrqParams( IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT,
                            IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT,
@@ -1163,6 +1192,8 @@ void RadioSend( uint8_t *buffer, uint8_t size )
     SX126xSendPayload( buffer, size, 0 );
     TimerSetValue( &TxTimeoutTimer, TxTimeout );
     TimerStart( &TxTimeoutTimer );
+
+    SX126xSetSpiAccount( spiAccount );
 }
 
 void RadioSleep( void )
@@ -1230,6 +1261,7 @@ void RadioRxBoosted( uint32_t timeout )
 
 void RadioSetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime )
 {   // mating new add
+	SX126xRXena();
 	SX126xSetDioIrqParams(IRQ_RADIO_ALL | IRQ_RX_TX_TIMEOUT,
 						  IRQ_RADIO_ALL | IRQ_RX_TX_TIMEOUT,
 						  IRQ_RADIO_NONE, IRQ_RADIO_NONE);
@@ -1336,7 +1368,7 @@ uint32_t RadioGetWakeupTime( void )
     return (RADIO_TCXO_SETUP_TIME + RADIO_WAKEUP_TIME);
 }
 
-void RadioOnTxTimeoutIrq( void )
+void RadioOnTxTimeoutIrq( void* context )
 {// mating mod
 	// if ((RadioEvents != NULL) && (RadioEvents->TxTimeout != NULL))
 	// {
@@ -1348,7 +1380,7 @@ void RadioOnTxTimeoutIrq( void )
 	TimerStop(&TxTimeoutTimer);
 }
 
-void RadioOnRxTimeoutIrq( void )
+void RadioOnRxTimeoutIrq( void* context )
 {// mating mod
 	// if ((RadioEvents != NULL) && (RadioEvents->RxTimeout != NULL))
 	// {
@@ -1371,12 +1403,37 @@ static BaseType_t xHigherPriorityTaskWoken = pdTRUE;
 void IRAM_ATTR RadioOnDioIrq( void )    // add IRAM_ATTR mating
 {// mating mod
 	BoardDisableIrq();
+	IrqTimeUs = RtcGetTimeUs();
 	IrqFired = true;
 	BoardEnableIrq();
+	RADIO_LATENCY_IRQ();
 	// Wake up LoRa event handler on nRF52 and ESP32
 	xSemaphoreGiveFromISR(loraIntSem, &xHigherPriorityTaskWoken);
 }
 
+void RadioOnBusyTimeout( void )
+{
+	BusyTimeoutFired = true;
+	// The radio may have missed a configuration command
+	SX126xClearShadow();
+	// Let the LoRa task report it even when no DIO interrupt follows
+	if (loraIntSem != NULL)
+	{
+		xSemaphoreGive(loraIntSem);
+	}
+}
+
+uint64_t RadioGetIrqTimeUs(void)
+{
+	uint64_t time;
+
+	// 64-bit, read it whole
+	BoardDisableIrq();
+	time = IrqTimeUs;
+	BoardEnableIrq();
+	return time;
+}
+
 void RadioIrqProcess( void )
 {
     if( IrqFired == true )
@@ -1387,6 +1444,7 @@ void RadioIrqProcess( void )
         CRITICAL_SECTION_END( );
 
         uint16_t irqRegs = SX126xGetIrqStatus( );
+        RADIO_LATENCY_MARK( RADIO_LATENCY_IRQ_STATUS );
         SX126xClearIrqStatus( irqRegs );
 
         if( ( irqRegs & IRQ_TX_DONE ) == IRQ_TX_DONE )
@@ -1396,6 +1454,7 @@ void RadioIrqProcess( void )
             SX126xSetOperatingMode( MODE_STDBY_RC );
             if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
             {
+                RADIO_LATENCY_MARK( RADIO_LATENCY_EVENT );
                 RadioEvents->TxDone( );
             }
         }
@@ -1435,6 +1494,7 @@ void RadioIrqProcess( void )
                 SX126xGetPacketStatus( &RadioPktStatus );
                 if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
                 {
+                    RADIO_LATENCY_MARK( RADIO_LATENCY_EVENT );
                     RadioEvents->RxDone( RadioRxPayload, size, RadioPktStatus.Params.LoRa.RssiPkt, RadioPktStatus.Params.LoRa.SnrPkt );
                 }
             }
@@ -1509,6 +1569,7 @@ void RadioBgIrqProcess(void)
 {
 	bool rx_timeout_handled = false;
 	bool tx_timeout_handled = false;
+	SX126xSpiAccount_t spiAccount = SX126xSetSpiAccount(SX126X_SPI_ACCOUNT_IRQ);
 	if (IrqFired == true)
 	{
 		BoardDisableIrq();
@@ -1516,6 +1577,7 @@ void RadioBgIrqProcess(void)
 		BoardEnableIrq();
         //获取中断状态
 		uint16_t irqRegs = SX126xGetIrqStatus();
+		RADIO_LATENCY_MARK(RADIO_LATENCY_IRQ_STATUS);
 		//清楚中断状态
 		//printf("irqreg=0x%x\r\n",irqRegs);
 		SX126xClearIrqStatus(IRQ_RADIO_ALL);
@@ -1530,6 +1592,7 @@ void RadioBgIrqProcess(void)
 			SX126xSetOperatingMode(MODE_STDBY_RC);
 			if ((RadioEvents != NULL) && (RadioEvents->TxDone != NULL))
 			{
+				RADIO_LATENCY_MARK(RADIO_LATENCY_EVENT);
 				RadioEvents->TxDone();
 			}
 		}
@@ -1552,7 +1615,6 @@ void RadioBgIrqProcess(void)
 				SX126xWriteRegister(0x0944, SX126xReadRegister(0x0944) | (1 << 1));
 				// WORKAROUND END
 			}
-			memset(RadioRxPayload, 0, 255);
 
 			if ((irqRegs & IRQ_CRC_ERROR) == IRQ_CRC_ERROR)
 			{
@@ -1575,6 +1637,7 @@ void RadioBgIrqProcess(void)
 				//printf("size=%d\n",size);
 				if ((RadioEvents != NULL) && (RadioEvents->RxDone != NULL))
 				{
+					RADIO_LATENCY_MARK(RADIO_LATENCY_EVENT);
 					RadioEvents->RxDone(RadioRxPayload, size, RadioPktStatus.Params.LoRa.RssiPkt, RadioPktStatus.Params.LoRa.SnrPkt);
 				}
 			}
@@ -1678,12 +1741,22 @@ void RadioBgIrqProcess(void)
 			}
 		}
 	}
+	if (BusyTimeoutFired)
+	{
+		BusyTimeoutFired = false;
+		if ((RadioEvents != NULL) && (RadioEvents->Fault != NULL))
+		{
+			RadioEvents->Fault(RADIO_FAULT_BUSY_TIMEOUT);
+		}
+	}
+	SX126xSetSpiAccount(spiAccount);
 }
 
 
 void RadioIrqProcessAfterDeepSleep(void)
 {
 	BoardDisableIrq();
+	IrqTimeUs = RtcGetTimeUs();
 	IrqFired = true;
 	BoardEnableIrq();
 	RadioBgIrqProcess();
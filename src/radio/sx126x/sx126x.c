@@ -77,6 +77,71 @@ volatile uint32_t FrequencyError = 0;
  */
 static bool ImageCalibrated = false;
 
+/*!
+ * \brief Configuration commands kept in \ref Shadow
+ */
+typedef enum
+{
+    SX126X_SHADOW_PACKET_TYPE,
+    SX126X_SHADOW_MODULATION_PARAMS,
+    SX126X_SHADOW_PACKET_PARAMS,
+    SX126X_SHADOW_DIO_IRQ_PARAMS,
+    SX126X_SHADOW_RF_FREQUENCY,
+    SX126X_SHADOW_PA_CONFIG,
+    SX126X_SHADOW_TX_PARAMS,
+    SX126X_SHADOW_COUNT
+}SX126xShadowId_t;
+
+/*!
+ * \brief Last arguments written with a configuration command
+ */
+typedef struct
+{
+    bool    Valid;
+    uint8_t Size;
+    uint8_t Value[9];
+}SX126xShadow_t;
+
+/*!
+ * \brief Copy of the radio configuration, used to drop commands that would
+ *        not change anything
+ */
+static SX126xShadow_t Shadow[SX126X_SHADOW_COUNT];
+
+/*!
+ * \brief Counters of the configuration commands sent and dropped
+ */
+static SX126xShadowStats_t ShadowStats;
+
+/*!
+ * \brief Sends a configuration command unless the radio already holds the
+ *        same arguments
+ *
+ * \param [in]  id            Shadow entry of the command
+ * \param [in]  command       Command opcode
+ * \param [in]  buffer        Command arguments
+ * \param [in]  size          Size of the arguments
+ *
+ * \retval sent               true when the command went out on SPI
+ */
+static bool SX126xWriteConfigCommand( SX126xShadowId_t id, RadioCommands_t command, uint8_t *buffer, uint8_t size )
+{
+    SX126xShadow_t *shadow = &Shadow[id];
+
+    if( ( shadow->Valid == true ) && ( shadow->Size == size ) && ( memcmp( shadow->Value, buffer, size ) == 0 ) )
+    {
+        ShadowStats.Skipped++;
+        return false;
+    }
+    // Update the copy first, a BUSY timeout while writing clears it again
+    memcpy( shadow->Value, buffer, size );
+    shadow->Size = size;
+    shadow->Valid = true;
+    ShadowStats.Sent++;
+    SX126xWriteCommand( command, buffer, size );
+    return true;
+}
+
 /*!
  * \brief Get the number of PLL steps for a given frequency in Hertz
  *
@@ -113,6 +178,7 @@ void SX126xProcessIrqs( void );
 void SX126xInit( DioIrqHandler dioIrq )
 {
     SX126xReset( );
+    SX126xClearShadow( );
 
     SX126xIoIrqInit( dioIrq );
 
@@ -136,6 +202,7 @@ void SX126xInit( DioIrqHandler dioIrq )
 void SX126xInit2( DioIrqHandler dioIrq )
 {
     SX126xReset( );
+    SX126xClearShadow( );
 
     SX126xIoIrqInit( dioIrq );
 
@@ -301,6 +368,8 @@ void SX126xSetSleep( SleepParams_t sleepConfig )
     {
         // Force image calibration
         ImageCalibrated = false;
+        // A cold start loses the whole configuration
+        SX126xClearShadow( );
     }
     SX126xWriteCommand( RADIO_SET_SLEEP, &value, 1 );
     SX126xSetOperatingMode( MODE_SLEEP );
@@ -483,7 +552,7 @@ void SX126xSetPaConfig( uint8_t paDutyCycle, uint8_t hpMax, uint8_t deviceSel, u
     buf[1] = hpMax;
     buf[2] = deviceSel;
     buf[3] = paLut;
-    SX126xWriteCommand( RADIO_SET_PACONFIG, buf, 4 );
+    SX126xWriteConfigCommand( SX126X_SHADOW_PA_CONFIG, RADIO_SET_PACONFIG, buf, 4 );
 }
 
 void SX126xSetRxTxFallbackMode( uint8_t fallbackMode )
@@ -503,7 +572,7 @@ void SX126xSetDioIrqParams( uint16_t irqMask, uint16_t dio1Mask, uint16_t dio2Ma
     buf[5] = ( uint8_t )( dio2Mask & 0x00FF );
     buf[6] = ( uint8_t )( ( dio3Mask >> 8 ) & 0x00FF );
     buf[7] = ( uint8_t )( dio3Mask & 0x00FF );
-    SX126xWriteCommand( RADIO_CFG_DIOIRQ, buf, 8 );
+    SX126xWriteConfigCommand( SX126X_SHADOW_DIO_IRQ_PARAMS, RADIO_CFG_DIOIRQ, buf, 8 );
 }
 
 uint16_t SX126xGetIrqStatus( void )
@@ -574,14 +643,21 @@ void SX126xSetRfFrequency( uint32_t frequency )     // mating mod
     buf[1] = ( uint8_t )( ( freqInPllSteps >> 16 ) & 0xFF );
     buf[2] = ( uint8_t )( ( freqInPllSteps >> 8 ) & 0xFF );
     buf[3] = ( uint8_t )( freqInPllSteps & 0xFF );
-    SX126xWriteCommand( RADIO_SET_RFFREQUENCY, buf, 4 );
+    SX126xWriteConfigCommand( SX126X_SHADOW_RF_FREQUENCY, RADIO_SET_RFFREQUENCY, buf, 4 );
 }
 
 void SX126xSetPacketType( RadioPacketTypes_t packetType )
 {
+    uint8_t value = ( uint8_t )packetType;
+
     // Save packet type internally to avoid questioning the radio
     PacketType = packetType;
-    SX126xWriteCommand( RADIO_SET_PACKETTYPE, ( uint8_t* )&packetType, 1 );
+    if( SX126xWriteConfigCommand( SX126X_SHADOW_PACKET_TYPE, RADIO_SET_PACKETTYPE, &value, 1 ) == true )
+    {
+        // The modem parameters have to be written again for the new packet type
+        Shadow[SX126X_SHADOW_MODULATION_PARAMS].Valid = false;
+        Shadow[SX126X_SHADOW_PACKET_PARAMS].Valid = false;
+    }
 }
 
 RadioPacketTypes_t SX126xGetPacketType( void )
@@ -631,7 +707,7 @@ void SX126xSetTxParams( int8_t power, RadioRampTimes_t rampTime )
     }
     buf[0] = power;
     buf[1] = ( uint8_t )rampTime;
-    SX126xWriteCommand( RADIO_SET_TXPARAMS, buf, 2 );
+    SX126xWriteConfigCommand( SX126X_SHADOW_TX_PARAMS, RADIO_SET_TXPARAMS, buf, 2 );
 }
 
 void SX126xSetModulationParams( ModulationParams_t *modulationParams )
@@ -661,7 +737,7 @@ void SX126xSetModulationParams( ModulationParams_t *modulationParams )
         buf[5] = ( tempVal >> 16 ) & 0xFF;
         buf[6] = ( tempVal >> 8 ) & 0xFF;
         buf[7] = ( tempVal& 0xFF );
-        SX126xWriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
+        SX126xWriteConfigCommand( SX126X_SHADOW_MODULATION_PARAMS, RADIO_SET_MODULATIONPARAMS, buf, n );
         break;
     case PACKET_TYPE_LORA:
         n = 4;
@@ -670,7 +746,7 @@ void SX126xSetModulationParams( ModulationParams_t *modulationParams )
         buf[2] = modulationParams->Params.LoRa.CodingRate;
         buf[3] = modulationParams->Params.LoRa.LowDatarateOptimize;
 
-        SX126xWriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
+        SX126xWriteConfigCommand( SX126X_SHADOW_MODULATION_PARAMS, RADIO_SET_MODULATIONPARAMS, buf, n );
 
         break;
     default:
@@ -735,7 +811,7 @@ void SX126xSetPacketParams( PacketParams_t *packetParams )
     case PACKET_TYPE_NONE:
         return;
     }
-    SX126xWriteCommand( RADIO_SET_PACKETPARAMS, buf, n );
+    SX126xWriteConfigCommand( SX126X_SHADOW_PACKET_PARAMS, RADIO_SET_PACKETPARAMS, buf, n );
 }
 
 void SX126xSetCadParams( RadioLoRaCadSymbols_t cadSymbolNum, uint8_t cadDetPeak, uint8_t cadDetMin, RadioCadExitModes_t cadExitMode, uint32_t cadTimeout )
@@ -852,6 +928,16 @@ RadioError_t SX126xGetDeviceErrors( void )
     return error;
 }
 
+void SX126xClearShadow( void )
+{
+    memset( Shadow, 0, sizeof( Shadow ) );
+}
+
+void SX126xGetShadowStats( SX126xShadowStats_t *stats )
+{
+    *stats = ShadowStats;
+}
+
 void SX126xClearDeviceErrors( void )
 {
     uint8_t buf[2] = { 0x00, 0x00 };
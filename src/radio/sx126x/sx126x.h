@@ -699,6 +699,15 @@ typedef struct SX126x_s
  */
 typedef void ( DioIrqHandler )( void );
 
+/*!
+ * \brief Counters of the configuration shadow, see \ref SX126xGetShadowStats
+ */
+typedef struct
+{
+    uint32_t Sent;                                  //!< Configuration commands written to the radio
+    uint32_t Skipped;                               //!< Commands dropped because the radio already had the same values
+}SX126xShadowStats_t;
+
 /*
  * SX126x definitions
  */
@@ -1125,6 +1134,22 @@ RadioError_t SX126xGetDeviceErrors( void );
  */
 void SX126xClearDeviceErrors( void );
 
+/*!
+ * \brief Forgets the configuration copy so that every configuration command
+ *        is written again
+ *
+ * \remark Needed whenever the radio may have lost its configuration (reset,
+ *         cold start sleep, command lost on a BUSY timeout)
+ */
+void SX126xClearShadow( void );
+
+/*!
+ * \brief Gets the counters of the configuration copy
+ *
+ * \param [out] stats         Configuration commands sent and skipped
+ */
+void SX126xGetShadowStats( SX126xShadowStats_t *stats );
+
 /*!
  * \brief Clears the IRQs
  *
@@ -0,0 +1,753 @@
+/*!
+ * \file      radio-virtual.c
+ *
+ * \brief     Software SX126x for the host (POSIX) build
+ *
+ * \remark    Replaces radio/sx126x/radio.c, sx126x.c and sx126x-board.cpp
+ *            when LORAWAN_HOST is defined. Events are raised the same way
+ *            as on the chip: the radio latches IRQ flags and the callbacks
+ *            run from BgIrqProcess, called by LmHandlerProcess.
+ */
+#if defined( LORAWAN_HOST )
+#include <stdlib.h>
+#include <string.h>
+#include "system/utilities.h"
+#include "boards/mcu/timer.h"
+#include "boards/mcu/board.h"
+#include "radio/radio.h"
+#include "radio/sx126x/sx126x.h"
+#include "radio/virtual/radio-virtual.h"
+#include "radio/radio-latency.h"
+
+/*!
+ * Size of the virtual register file, covers every SX126x register address
+ */
+#define VIRTUAL_RADIO_REGISTER_SPACE                0x1000
+
+/*!
+ * Modulation and packet parameters, as given to SetTxConfig / SetRxConfig
+ */
+typedef struct
+{
+    RadioModems_t Modem;
+    uint32_t Bandwidth;
+    uint32_t Datarate;
+    uint8_t Coderate;
+    uint16_t PreambleLen;
+    bool FixLen;
+    uint8_t PayloadLen;
+    bool CrcOn;
+    bool IqInverted;
+    uint16_t SymbTimeout;
+    bool RxContinuous;
+    uint32_t Timeout;
+}VirtualRadioConfig_t;
+
+/*!
+ * Frame waiting for a reception window
+ */
+typedef struct
+{
+    uint8_t Payload[255];
+    uint8_t Size;
+    int16_t Rssi;
+    int8_t Snr;
+}VirtualRadioFrame_t;
+
+/*!
+ * LoRa bandwidths in Hz, indexed like the SetTxConfig/SetRxConfig bandwidth
+ * argument (see Bandwidths[] in radio/sx126x/radio.c)
+ */
+static const uint32_t LoRaBandwidthsInHz[] = { 125000, 250000, 500000, 62500, 41667, 31250, 20833, 15625, 10417, 7812 };
+
+static RadioEvents_t* RadioEvents;
+
+static RadioState_t State = RF_IDLE;
+static uint32_t Frequency = 0;
+static VirtualRadioConfig_t TxConfig;
+static VirtualRadioConfig_t RxConfig;
+static uint8_t MaxPayloadLength = 0xFF;
+static uint8_t Registers[VIRTUAL_RADIO_REGISTER_SPACE];
+
+static VirtualRadioFrame_t RxQueue[VIRTUAL_RADIO_RX_QUEUE_SIZE];
+static uint8_t RxQueueHead = 0;
+static uint8_t RxQueueCount = 0;
+static bool RxReceiving = false;
+static bool CrcErrorPending = false;
+static bool TxTimeoutPending = false;
+
+static uint8_t RadioRxPayload[255];
+static VirtualRadioFrame_t RxFrame;
+
+static uint16_t IrqFlags = IRQ_RADIO_NONE;
+static bool IrqFired = false;
+static uint64_t IrqTimeUs = 0;
+
+static VirtualRadioTxHook_t TxHook = NULL;
+static void *TxHookContext = NULL;
+
+static VirtualRadioStats_t Stats;
+
+/*!
+ * TX end of frame, RX window and RX end of frame timers
+ */
+static TimerEvent_t TxTimer;
+static TimerEvent_t RxWindowTimer;
+static TimerEvent_t RxFrameTimer;
+
+static void RadioInit( RadioEvents_t *events );
+static RadioState_t RadioGetStatus( void );
+static void RadioSetModem( RadioModems_t modem );
+static void RadioSetChannel( uint32_t freq );
+static bool RadioIsChannelFree( uint32_t freq, uint32_t rxBandwidth, int16_t rssiThresh, uint32_t maxCarrierSenseTime );
+static uint32_t RadioRandom( void );
+static void RadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
+                              uint32_t datarate, uint8_t coderate,
+                              uint32_t bandwidthAfc, uint16_t preambleLen,
+                              uint16_t symbTimeout, bool fixLen,
+                              uint8_t payloadLen,
+                              bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                              bool iqInverted, bool rxContinuous );
+static void RadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
+                              uint32_t bandwidth, uint32_t datarate,
+                              uint8_t coderate, uint16_t preambleLen,
+                              bool fixLen, bool crcOn, bool freqHopOn,
+                              uint8_t hopPeriod, bool iqInverted, uint32_t timeout );
+static bool RadioCheckRfFrequency( uint32_t frequency );
+static uint32_t RadioTimeOnAir( RadioModems_t modem, uint32_t bandwidth,
+                                uint32_t datarate, uint8_t coderate,
+                                uint16_t preambleLen, bool fixLen, uint8_t payloadLen,
+                                bool crcOn );
+static void RadioSend( uint8_t *buffer, uint8_t size );
+static void RadioSleep( void );
+static void RadioStandby( void );
+static void RadioRx( uint32_t timeout );
+static void RadioStartCad( void );
+static void RadioSetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time );
+static int16_t RadioRssi( RadioModems_t modem );
+static void RadioWrite( uint32_t addr, uint8_t data );
+static uint8_t RadioRead( uint32_t addr );
+static void RadioWriteBuffer( uint32_t addr, uint8_t *buffer, uint8_t size );
+static void RadioReadBuffer( uint32_t addr, uint8_t *buffer, uint8_t size );
+static void RadioSetMaxPayloadLength( RadioModems_t modem, uint8_t max );
+static void RadioSetPublicNetwork( bool enable );
+static uint32_t RadioGetWakeupTime( void );
+static void RadioBgIrqProcess( void );
+static void RadioRxBoosted( uint32_t timeout );
+static void RadioSetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime );
+static void RadioReInit( RadioEvents_t *events );
+static void RadioSetCadParams( uint8_t cadSymbolNum, uint8_t cadDetPeak, uint8_t cadDetMin, uint8_t cadExitMode, uint32_t cadTimeout );
+static void RadioIrqProcessAfterDeepSleep( void );
+static uint64_t RadioGetIrqTimeUs( void );
+
+/*!
+ * Radio driver structure initialization
+ */
+const struct Radio_s Radio =
+{
+    RadioInit,
+    RadioGetStatus,
+    RadioSetModem,
+    RadioSetChannel,
+    RadioIsChannelFree,
+    RadioRandom,
+    RadioSetRxConfig,
+    RadioSetTxConfig,
+    RadioCheckRfFrequency,
+    RadioTimeOnAir,
+    RadioSend,
+    RadioSleep,
+    RadioStandby,
+    RadioRx,
+    RadioStartCad,
+    RadioSetTxContinuousWave,
+    RadioRssi,
+    RadioWrite,
+    RadioRead,
+    RadioWriteBuffer,
+    RadioReadBuffer,
+    RadioSetMaxPayloadLength,
+    RadioSetPublicNetwork,
+    RadioGetWakeupTime,
+    RadioBgIrqProcess,
+    // Available on SX126x only
+    RadioRxBoosted,
+    RadioSetRxDutyCycle,
+    RadioBgIrqProcess,
+    RadioReInit,
+    RadioSetCadParams,
+    RadioIrqProcessAfterDeepSleep,
+    RadioGetIrqTimeUs
+};
+
+const struct Radio_s Radio2 =
+{
+    RadioInit,
+    RadioGetStatus,
+    RadioSetModem,
+    RadioSetChannel,
+    RadioIsChannelFree,
+    RadioRandom,
+    RadioSetRxConfig,
+    RadioSetTxConfig,
+    RadioCheckRfFrequency,
+    RadioTimeOnAir,
+    RadioSend,
+    RadioSleep,
+    RadioStandby,
+    RadioRx,
+    RadioStartCad,
+    RadioSetTxContinuousWave,
+    RadioRssi,
+    RadioWrite,
+    RadioRead,
+    RadioWriteBuffer,
+    RadioReadBuffer,
+    RadioSetMaxPayloadLength,
+    RadioSetPublicNetwork,
+    RadioGetWakeupTime,
+    RadioBgIrqProcess,
+    // Available on SX126x only
+    RadioRxBoosted,
+    RadioSetRxDutyCycle,
+    RadioBgIrqProcess,
+    RadioReInit,
+    RadioSetCadParams,
+    RadioIrqProcessAfterDeepSleep,
+    RadioGetIrqTimeUs
+};
+
+/*!
+ * \brief Latches IRQ flags, the equivalent of the DIO1 interrupt
+ */
+static void RadioRaiseIrq( uint16_t irq )
+{
+    BoardDisableIrq( );
+    IrqFlags |= irq;
+    IrqFired = true;
+    IrqTimeUs = TimerGetCurrentTimeUs( );
+    BoardEnableIrq( );
+    RADIO_LATENCY_IRQ( );
+}
+
+static uint32_t RadioGetLoRaBandwidthInHz( uint32_t bandwidth )
+{
+    if( bandwidth >= ( sizeof( LoRaBandwidthsInHz ) / sizeof( LoRaBandwidthsInHz[0] ) ) )
+    {
+        return LoRaBandwidthsInHz[0];
+    }
+    return LoRaBandwidthsInHz[bandwidth];
+}
+
+/*!
+ * \brief Duration of a LoRa symbol, rounded up [ms]
+ */
+static uint32_t RadioGetSymbolsTime( const VirtualRadioConfig_t *config, uint32_t symbols )
+{
+    uint64_t numerator = ( ( uint64_t )symbols << config->Datarate ) * 1000;
+    uint32_t denominator = RadioGetLoRaBandwidthInHz( config->Bandwidth );
+
+    return ( uint32_t )( ( numerator + denominator - 1 ) / denominator );
+}
+
+static uint32_t RadioGetFrameTime( const VirtualRadioConfig_t *config, uint8_t size )
+{
+    return RadioTimeOnAir( config->Modem, config->Bandwidth, config->Datarate, config->Coderate,
+                           config->PreambleLen, config->FixLen, size, config->CrcOn );
+}
+
+/*!
+ * \brief Starts receiving the next queued frame if the radio is listening
+ */
+static void RadioStartReception( void )
+{
+    if( ( State != RF_RX_RUNNING ) || ( RxReceiving == true ) || ( RxQueueCount == 0 ) )
+    {
+        return;
+    }
+    RxFrame = RxQueue[RxQueueHead];
+    RxQueueHead = ( RxQueueHead + 1 ) % VIRTUAL_RADIO_RX_QUEUE_SIZE;
+    RxQueueCount--;
+
+    // Once the preamble is detected the symbol timeout does not apply anymore
+    RxReceiving = true;
+    TimerStop( &RxWindowTimer );
+    TimerSetValue( &RxFrameTimer, RadioGetFrameTime( &RxConfig, RxFrame.Size ) );
+    TimerStart( &RxFrameTimer );
+}
+
+static void RadioOnTxTimerEvent( void* context )
+{
+    TimerStop( &TxTimer );
+    if( State != RF_TX_RUNNING )
+    {
+        return;
+    }
+    if( TxTimeoutPending == true )
+    {
+        TxTimeoutPending = false;
+        RadioRaiseIrq( IRQ_RX_TX_TIMEOUT );
+    }
+    else
+    {
+        RadioRaiseIrq( IRQ_TX_DONE );
+    }
+}
+
+static void RadioOnRxWindowTimerEvent( void* context )
+{
+    TimerStop( &RxWindowTimer );
+    if( ( State == RF_RX_RUNNING ) && ( RxReceiving == false ) )
+    {
+        RadioRaiseIrq( IRQ_RX_TX_TIMEOUT );
+    }
+}
+
+static void RadioOnRxFrameTimerEvent( void* context )
+{
+    TimerStop( &RxFrameTimer );
+    if( ( State != RF_RX_RUNNING ) || ( RxReceiving == false ) )
+    {
+        return;
+    }
+    RxReceiving = false;
+    if( CrcErrorPending == true )
+    {
+        CrcErrorPending = false;
+        RadioRaiseIrq( IRQ_RX_DONE | IRQ_CRC_ERROR );
+    }
+    else
+    {
+        RadioRaiseIrq( IRQ_RX_DONE );
+    }
+}
+
+static void RadioInit( RadioEvents_t *events )
+{
+    RadioEvents = events;
+
+    TxTimer.oneShot = true;
+    RxWindowTimer.oneShot = true;
+    RxFrameTimer.oneShot = true;
+    TimerInit( &TxTimer, RadioOnTxTimerEvent );
+    TimerInit( &RxWindowTimer, RadioOnRxWindowTimerEvent );
+    TimerInit( &RxFrameTimer, RadioOnRxFrameTimerEvent );
+
+    State = RF_IDLE;
+    RxReceiving = false;
+    IrqFlags = IRQ_RADIO_NONE;
+    IrqFired = false;
+}
+
+static void RadioReInit( RadioEvents_t *events )
+{
+    RadioInit( events );
+}
+
+void reInitEvent( RadioEvents_t *events )
+{
+    RadioEvents = events;
+}
+
+static RadioState_t RadioGetStatus( void )
+{
+    return State;
+}
+
+static void RadioSetModem( RadioModems_t modem )
+{
+    TxConfig.Modem = modem;
+    RxConfig.Modem = modem;
+}
+
+static void RadioSetChannel( uint32_t freq )
+{
+    Frequency = freq;
+}
+
+static bool RadioIsChannelFree( uint32_t freq, uint32_t rxBandwidth, int16_t rssiThresh, uint32_t maxCarrierSenseTime )
+{
+    return true;
+}
+
+static uint32_t RadioRandom( void )
+{
+    return ( ( uint32_t )rand( ) << 16 ) ^ ( uint32_t )rand( );
+}
+
+static void RadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
+                              uint32_t datarate, uint8_t coderate,
+                              uint32_t bandwidthAfc, uint16_t preambleLen,
+                              uint16_t symbTimeout, bool fixLen,
+                              uint8_t payloadLen,
+                              bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                              bool iqInverted, bool rxContinuous )
+{
+    RadioStandby( );
+    RxConfig.Modem = modem;
+    RxConfig.Bandwidth = bandwidth;
+    RxConfig.Datarate = datarate;
+    RxConfig.Coderate = coderate;
+    RxConfig.PreambleLen = preambleLen;
+    RxConfig.FixLen = fixLen;
+    RxConfig.PayloadLen = payloadLen;
+    RxConfig.CrcOn = crcOn;
+    RxConfig.IqInverted = iqInverted;
+    RxConfig.SymbTimeout = ( rxContinuous == true ) ? 0 : symbTimeout;
+    RxConfig.RxContinuous = rxContinuous;
+    MaxPayloadLength = ( fixLen == true ) ? payloadLen : 0xFF;
+}
+
+static void RadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
+                              uint32_t bandwidth, uint32_t datarate,
+                              uint8_t coderate, uint16_t preambleLen,
+                              bool fixLen, bool crcOn, bool freqHopOn,
+                              uint8_t hopPeriod, bool iqInverted, uint32_t timeout )
+{
+    RadioStandby( );
+    TxConfig.Modem = modem;
+    TxConfig.Bandwidth = bandwidth;
+    TxConfig.Datarate = datarate;
+    TxConfig.Coderate = coderate;
+    TxConfig.PreambleLen = preambleLen;
+    TxConfig.FixLen = fixLen;
+    TxConfig.CrcOn = crcOn;
+    TxConfig.IqInverted = iqInverted;
+    TxConfig.Timeout = timeout;
+}
+
+static bool RadioCheckRfFrequency( uint32_t frequency )
+{
+    return true;
+}
+
+static uint32_t RadioTimeOnAir( RadioModems_t modem, uint32_t bandwidth,
+                                uint32_t datarate, uint8_t coderate,
+                                uint16_t preambleLen, bool fixLen, uint8_t payloadLen,
+                                bool crcOn )
+{
+    if( modem == MODEM_FSK )
+    {
+        uint32_t bits = ( preambleLen << 3 ) + ( ( fixLen == false ) ? 8 : 0 ) + ( 3 << 3 ) +
+                        ( ( payloadLen + ( ( crcOn == true ) ? 2 : 0 ) ) << 3 );
+
+        return ( 1000U * bits + datarate - 1 ) / datarate;
+    }
+
+    // Same integral computation as the SX126x driver
+    int32_t crDenom = coderate + 4;
+    bool lowDatareOptimize = ( ( bandwidth == 0 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
+                             ( ( bandwidth == 1 ) && ( datarate == 12 ) );
+
+    if( ( ( datarate == 5 ) || ( datarate == 6 ) ) && ( preambleLen < 12 ) )
+    {
+        preambleLen = 12;
+    }
+
+    int32_t ceilDenominator = 4 * datarate;
+    int32_t ceilNumerator = ( payloadLen << 3 ) + ( crcOn ? 16 : 0 ) - ( 4 * datarate ) + ( fixLen ? 0 : 20 );
+
+    if( datarate > 6 )
+    {
+        ceilNumerator += 8;
+        if( lowDatareOptimize == true )
+        {
+            ceilDenominator = 4 * ( datarate - 2 );
+        }
+    }
+    if( ceilNumerator < 0 )
+    {
+        ceilNumerator = 0;
+    }
+
+    int32_t intermediate = ( ( ceilNumerator + ceilDenominator - 1 ) / ceilDenominator ) * crDenom + preambleLen + 12;
+    if( datarate <= 6 )
+    {
+        intermediate += 2;
+    }
+
+    uint32_t numerator = 1000U * ( uint32_t )( ( 4 * intermediate + 1 ) * ( 1 << ( datarate - 2 ) ) );
+    uint32_t denominator = RadioGetLoRaBandwidthInHz( bandwidth );
+
+    return ( numerator + denominator - 1 ) / denominator;
+}
+
+static void RadioSend( uint8_t *buffer, uint8_t size )
+{
+    uint32_t airTime = RadioGetFrameTime( &TxConfig, size );
+
+    TimerStop( &RxWindowTimer );
+    TimerStop( &RxFrameTimer );
+    RxReceiving = false;
+    State = RF_TX_RUNNING;
+    Stats.AirTime += airTime;
+
+    if( TxHook != NULL )
+    {
+        TxHook( buffer, size, Frequency, TxConfig.Datarate, airTime, TxHookContext );
+    }
+
+    TimerSetValue( &TxTimer, ( TxTimeoutPending == true ) ? TxConfig.Timeout : airTime );
+    TimerStart( &TxTimer );
+}
+
+static void RadioSleep( void )
+{
+    RadioStandby( );
+}
+
+static void RadioStandby( void )
+{
+    TimerStop( &TxTimer );
+    TimerStop( &RxWindowTimer );
+    TimerStop( &RxFrameTimer );
+    RxReceiving = false;
+    State = RF_IDLE;
+}
+
+static void RadioRx( uint32_t timeout )
+{
+    uint32_t window = timeout;
+
+    TimerStop( &TxTimer );
+    State = RF_RX_RUNNING;
+    RxReceiving = false;
+
+    if( ( RxConfig.RxContinuous == false ) && ( RxConfig.SymbTimeout != 0 ) && ( RxConfig.Modem == MODEM_LORA ) )
+    {
+        uint32_t symbWindow = RadioGetSymbolsTime( &RxConfig, RxConfig.SymbTimeout );
+
+        if( ( window == 0 ) || ( symbWindow < window ) )
+        {
+            window = symbWindow;
+        }
+    }
+    if( window != 0 )
+    {
+        TimerSetValue( &RxWindowTimer, window );
+        TimerStart( &RxWindowTimer );
+    }
+    RadioStartReception( );
+}
+
+static void RadioRxBoosted( uint32_t timeout )
+{
+    RadioRx( timeout );
+}
+
+static void RadioSetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime )
+{
+    RadioRx( 0 );
+}
+
+static void RadioSetCadParams( uint8_t cadSymbolNum, uint8_t cadDetPeak, uint8_t cadDetMin, uint8_t cadExitMode, uint32_t cadTimeout )
+{
+}
+
+static void RadioStartCad( void )
+{
+    State = RF_CAD;
+    RadioRaiseIrq( IRQ_CAD_DONE );
+}
+
+static void RadioSetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time )
+{
+    Frequency = freq;
+    State = RF_TX_RUNNING;
+    TimerSetValue( &TxTimer, ( uint32_t )time * 1000 );
+    TimerStart( &TxTimer );
+}
+
+static int16_t RadioRssi( RadioModems_t modem )
+{
+    return -120;
+}
+
+static void RadioWrite( uint32_t addr, uint8_t data )
+{
+    Registers[addr % VIRTUAL_RADIO_REGISTER_SPACE] = data;
+}
+
+static uint8_t RadioRead( uint32_t addr )
+{
+    return Registers[addr % VIRTUAL_RADIO_REGISTER_SPACE];
+}
+
+static void RadioWriteBuffer( uint32_t addr, uint8_t *buffer, uint8_t size )
+{
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        RadioWrite( addr + i, buffer[i] );
+    }
+}
+
+static void RadioReadBuffer( uint32_t addr, uint8_t *buffer, uint8_t size )
+{
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        buffer[i] = RadioRead( addr + i );
+    }
+}
+
+static void RadioSetMaxPayloadLength( RadioModems_t modem, uint8_t max )
+{
+    MaxPayloadLength = max;
+}
+
+static void RadioSetPublicNetwork( bool enable )
+{
+    uint16_t syncWord = ( enable == true ) ? LORA_MAC_PUBLIC_SYNCWORD : LORA_MAC_PRIVATE_SYNCWORD;
+
+    RadioWrite( REG_LR_SYNCWORD, ( syncWord >> 8 ) & 0xFF );
+    RadioWrite( REG_LR_SYNCWORD + 1, syncWord & 0xFF );
+}
+
+static uint32_t RadioGetWakeupTime( void )
+{
+    return ( RADIO_TCXO_SETUP_TIME + RADIO_WAKEUP_TIME );
+}
+
+static void RadioBgIrqProcess( void )
+{
+    uint16_t irqRegs;
+
+    if( IrqFired == false )
+    {
+        return;
+    }
+    BoardDisableIrq( );
+    IrqFired = false;
+    irqRegs = IrqFlags;
+    IrqFlags = IRQ_RADIO_NONE;
+    BoardEnableIrq( );
+    RADIO_LATENCY_MARK( RADIO_LATENCY_IRQ_STATUS );
+
+    if( ( irqRegs & IRQ_TX_DONE ) == IRQ_TX_DONE )
+    {
+        State = RF_IDLE;
+        Stats.TxDone++;
+        if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
+        {
+            RADIO_LATENCY_MARK( RADIO_LATENCY_EVENT );
+            RadioEvents->TxDone( );
+        }
+    }
+
+    if( ( irqRegs & IRQ_RX_DONE ) == IRQ_RX_DONE )
+    {
+        if( RxConfig.RxContinuous == false )
+        {
+            State = RF_IDLE;
+        }
+        if( ( irqRegs & IRQ_CRC_ERROR ) == IRQ_CRC_ERROR )
+        {
+            Stats.RxError++;
+            if( ( RadioEvents != NULL ) && ( RadioEvents->RxError != NULL ) )
+            {
+                RadioEvents->RxError( );
+            }
+        }
+        else
+        {
+            Stats.RxDone++;
+            memcpy( RadioRxPayload, RxFrame.Payload, RxFrame.Size );
+            if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
+            {
+                RADIO_LATENCY_MARK( RADIO_LATENCY_EVENT );
+                RadioEvents->RxDone( RadioRxPayload, RxFrame.Size, RxFrame.Rssi, RxFrame.Snr );
+            }
+        }
+        // Continuous reception goes on with the next queued frame
+        RadioStartReception( );
+    }
+
+    if( ( irqRegs & IRQ_CAD_DONE ) == IRQ_CAD_DONE )
+    {
+        State = RF_IDLE;
+        if( ( RadioEvents != NULL ) && ( RadioEvents->CadDone != NULL ) )
+        {
+            RadioEvents->CadDone( RxQueueCount != 0 );
+        }
+    }
+
+    if( ( irqRegs & IRQ_RX_TX_TIMEOUT ) == IRQ_RX_TX_TIMEOUT )
+    {
+        if( State == RF_TX_RUNNING )
+        {
+            State = RF_IDLE;
+            Stats.TxTimeout++;
+            if( ( RadioEvents != NULL ) && ( RadioEvents->TxTimeout != NULL ) )
+            {
+                RadioEvents->TxTimeout( );
+            }
+        }
+        else if( State == RF_RX_RUNNING )
+        {
+            State = RF_IDLE;
+            Stats.RxTimeout++;
+            if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
+            {
+                RadioEvents->RxTimeout( );
+            }
+        }
+    }
+}
+
+static void RadioIrqProcessAfterDeepSleep( void )
+{
+    RadioBgIrqProcess( );
+}
+
+static uint64_t RadioGetIrqTimeUs( void )
+{
+    return IrqTimeUs;
+}
+
+void VirtualRadioSetTxHook( VirtualRadioTxHook_t hook, void *context )
+{
+    TxHook = hook;
+    TxHookContext = context;
+}
+
+bool VirtualRadioInjectRx( const uint8_t *buffer, uint8_t size, int16_t rssi, int8_t snr )
+{
+    if( RxQueueCount >= VIRTUAL_RADIO_RX_QUEUE_SIZE )
+    {
+        Stats.RxDropped++;
+        return false;
+    }
+    VirtualRadioFrame_t *frame = &RxQueue[( RxQueueHead + RxQueueCount ) % VIRTUAL_RADIO_RX_QUEUE_SIZE];
+
+    memcpy( frame->Payload, buffer, size );
+    frame->Size = size;
+    frame->Rssi = rssi;
+    frame->Snr = snr;
+    RxQueueCount++;
+
+    RadioStartReception( );
+    return true;
+}
+
+void VirtualRadioInjectCrcError( void )
+{
+    CrcErrorPending = true;
+}
+
+void VirtualRadioInjectTxTimeout( void )
+{
+    TxTimeoutPending = true;
+}
+
+void VirtualRadioFlushRx( void )
+{
+    Stats.RxDropped += RxQueueCount;
+    RxQueueHead = 0;
+    RxQueueCount = 0;
+}
+
+void VirtualRadioGetStats( VirtualRadioStats_t *stats )
+{
+    *stats = Stats;
+}
+
+#endif
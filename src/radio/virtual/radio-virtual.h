@@ -0,0 +1,104 @@
+/*!
+ * \file      radio-virtual.h
+ *
+ * \brief     Software SX126x for the host (POSIX) build
+ *
+ * \remark    The virtual radio fills in the \ref Radio_s driver table. Air
+ *            time is simulated with timer objects, so a transmission ends
+ *            with TxDone after the real time on air, and a reception window
+ *            ends with RxDone, RxError or RxTimeout depending on what was
+ *            injected beforehand.
+ */
+#ifndef __RADIO_VIRTUAL_H__
+#define __RADIO_VIRTUAL_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radio/radio.h"
+
+/*!
+ * Maximum number of frames waiting for a reception window
+ */
+#define VIRTUAL_RADIO_RX_QUEUE_SIZE                 4
+
+/*!
+ * \brief Transmission hook, called when the radio starts sending a frame
+ *
+ * \param [IN] buffer   Frame on air
+ * \param [IN] size     Frame size
+ * \param [IN] freq     Channel frequency [Hz]
+ * \param [IN] datarate Spreading factor (LoRa) or bitrate (FSK)
+ * \param [IN] airTime  Time on air [ms]
+ * \param [IN] context  User context given to \ref VirtualRadioSetTxHook
+ */
+typedef void ( *VirtualRadioTxHook_t )( const uint8_t *buffer, uint8_t size, uint32_t freq,
+                                        uint32_t datarate, uint32_t airTime, void *context );
+
+/*!
+ * Virtual radio counters
+ */
+typedef struct VirtualRadioStats_s
+{
+    uint32_t TxDone;
+    uint32_t TxTimeout;
+    uint32_t RxDone;
+    uint32_t RxError;
+    uint32_t RxTimeout;
+    uint32_t RxDropped;
+    uint32_t AirTime;
+}VirtualRadioStats_t;
+
+/*!
+ * \brief Sets the hook called on every transmission
+ *
+ * \param [IN] hook    Transmission hook, NULL to disable
+ * \param [IN] context User context passed back to the hook
+ */
+void VirtualRadioSetTxHook( VirtualRadioTxHook_t hook, void *context );
+
+/*!
+ * \brief Queues a frame to be received
+ *
+ * \remark The frame is delivered in the reception window currently open,
+ *         or in the next one if the radio is not receiving.
+ *
+ * \param [IN] buffer Frame to receive
+ * \param [IN] size   Frame size
+ * \param [IN] rssi   Reported RSSI [dBm]
+ * \param [IN] snr    Reported SNR [dB]
+ * \retval queued     false if the reception queue is full
+ */
+bool VirtualRadioInjectRx( const uint8_t *buffer, uint8_t size, int16_t rssi, int8_t snr );
+
+/*!
+ * \brief Makes the next received frame fail its CRC check
+ */
+void VirtualRadioInjectCrcError( void );
+
+/*!
+ * \brief Makes the next transmission end with a timeout instead of TxDone
+ */
+void VirtualRadioInjectTxTimeout( void );
+
+/*!
+ * \brief Drops every frame waiting in the reception queue
+ */
+void VirtualRadioFlushRx( void );
+
+/*!
+ * \brief Reads the virtual radio counters
+ *
+ * \param [OUT] stats Counters
+ */
+void VirtualRadioGetStats( VirtualRadioStats_t *stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RADIO_VIRTUAL_H__
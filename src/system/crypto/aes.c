@@ -62,6 +62,25 @@
 #  define VERSION_1
 #endif
 
+/* define to encrypt with four 1 KB tables of 32-bit words that merge the
+   byte substitution, row shift and column mix of a round (T-tables) */
+#if 0
+#  define AES_T_TABLES
+#endif
+
+#if defined( AES_T_TABLES ) && !defined( USE_TABLES )
+#  error "AES_T_TABLES needs USE_TABLES"
+#endif
+
+/* the byte oriented rounds are still needed by the other modes */
+#if !defined( AES_T_TABLES ) || defined( AES_ENC_128_OTFK ) || defined( AES_ENC_256_OTFK )
+#  define AES_BYTE_ENCRYPT
+#endif
+#if defined( AES_BYTE_ENCRYPT ) || defined( AES_DEC_PREKEYED ) || \
+    defined( AES_DEC_128_OTFK ) || defined( AES_DEC_256_OTFK )
+#  define AES_BYTE_ROUNDS
+#endif
+
 #include "aes.h"
 
 //#if defined( HAVE_UINT_32T )
@@ -197,8 +216,23 @@ static const uint8_t sbox[256]  =  sb_data(f1);
 static const uint8_t isbox[256] = isb_data(f1);
 #endif
 
+#if defined( AES_BYTE_ENCRYPT )
 static const uint8_t gfm2_sbox[256] = sb_data(f2);
 static const uint8_t gfm3_sbox[256] = sb_data(f3);
+#endif
+
+#if defined( AES_T_TABLES )
+
+/* column of MixColumns applied to the substituted byte of row 0, 1, 2 or 3,
+   row 0 in the least significant byte */
+#define t0_w(x) ((uint32_t)f2(x) | ((uint32_t)(x) << 8) | ((uint32_t)(x) << 16) | ((uint32_t)f3(x) << 24))
+#define t1_w(x) ((uint32_t)f3(x) | ((uint32_t)f2(x) << 8) | ((uint32_t)(x) << 16) | ((uint32_t)(x) << 24))
+#define t2_w(x) ((uint32_t)(x) | ((uint32_t)f3(x) << 8) | ((uint32_t)f2(x) << 16) | ((uint32_t)(x) << 24))
+#define t3_w(x) ((uint32_t)(x) | ((uint32_t)(x) << 8) | ((uint32_t)f3(x) << 16) | ((uint32_t)f2(x) << 24))
+
+static const uint32_t t_fn[4][256] = { sb_data(t0_w), sb_data(t1_w), sb_data(t2_w), sb_data(t3_w) };
+
+#endif
 
 #if defined( AES_DEC_PREKEYED )
 static const uint8_t gfmul_9[256] = mm_data(f9);
@@ -373,6 +407,8 @@ static void xor_block( void *d, const void *s )
 #endif
 }
 
+#if defined( AES_BYTE_ROUNDS )
+
 static void copy_and_key( void *d, const void *s, const void *k )
 {
 #if defined( HAVE_UINT_32T )
@@ -408,6 +444,10 @@ static void add_round_key( uint8_t d[N_BLOCK], const uint8_t k[N_BLOCK] )
     xor_block(d, k);
 }
 
+#endif
+
+#if defined( AES_BYTE_ENCRYPT )
+
 static void shift_sub_rows( uint8_t st[N_BLOCK] )
 {   uint8_t tt;
 
@@ -424,6 +464,8 @@ static void shift_sub_rows( uint8_t st[N_BLOCK] )
     st[ 7] = s_box(st[ 3]); st[ 3] = s_box( tt );
 }
 
+#endif
+
 #if defined( AES_DEC_PREKEYED )
 
 static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
@@ -444,6 +486,8 @@ static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
 
 #endif
 
+#if defined( AES_BYTE_ENCRYPT )
+
 #if defined( VERSION_1 )
   static void mix_sub_columns( uint8_t dt[N_BLOCK] )
   { uint8_t st[N_BLOCK];
@@ -473,6 +517,8 @@ static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
     dt[15] = gfm3_sb(st[12]) ^ s_box(st[1]) ^ s_box(st[6]) ^ gfm2_sb(st[11]);
   }
 
+#endif
+
 #if defined( AES_DEC_PREKEYED )
 
 #if defined( VERSION_1 )
@@ -565,6 +611,60 @@ return_type aes_set_key( const uint8_t key[], length_type keylen, aes_context ct
 
 /*  Encrypt a single block of 16 bytes */
 
+#if defined( AES_T_TABLES )
+
+/* column c of the state is word c, row 0 in the least significant byte */
+#define load_word(p)    ((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | \
+                         ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+
+/* output column of a round: row r comes from column c + r */
+#define t_round(w0, w1, w2, w3, k) \
+    (t_fn[0][(w0) & 0xff] ^ t_fn[1][((w1) >> 8) & 0xff] ^ \
+     t_fn[2][((w2) >> 16) & 0xff] ^ t_fn[3][(w3) >> 24] ^ load_word(k))
+
+/* output column of the last round, which has no column mix */
+#define t_last(p, w0, w1, w2, w3, k) \
+    (p)[0] = s_box((w0) & 0xff) ^ (k)[0];         \
+    (p)[1] = s_box(((w1) >> 8) & 0xff) ^ (k)[1];  \
+    (p)[2] = s_box(((w2) >> 16) & 0xff) ^ (k)[2]; \
+    (p)[3] = s_box((w3) >> 24) ^ (k)[3]
+
+return_type lora_aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const aes_context ctx[1] )
+{
+    if( ctx->rnd )
+    {
+        const uint8_t *k = ctx->ksch;
+        uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+        uint8_t r;
+
+        s0 = load_word(in     ) ^ load_word(k     );
+        s1 = load_word(in +  4) ^ load_word(k +  4);
+        s2 = load_word(in +  8) ^ load_word(k +  8);
+        s3 = load_word(in + 12) ^ load_word(k + 12);
+
+        for( r = 1 ; r < ctx->rnd ; ++r )
+        {
+            k += N_BLOCK;
+            t0 = t_round(s0, s1, s2, s3, k     );
+            t1 = t_round(s1, s2, s3, s0, k +  4);
+            t2 = t_round(s2, s3, s0, s1, k +  8);
+            t3 = t_round(s3, s0, s1, s2, k + 12);
+            s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+        }
+
+        k += N_BLOCK;
+        t_last(out     , s0, s1, s2, s3, k     );
+        t_last(out +  4, s1, s2, s3, s0, k +  4);
+        t_last(out +  8, s2, s3, s0, s1, k +  8);
+        t_last(out + 12, s3, s0, s1, s2, k + 12);
+    }
+    else
+        return ( uint8_t )-1;
+    return 0;
+}
+
+#else
+
 return_type lora_aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const aes_context ctx[1] )
 {
     if( ctx->rnd )
@@ -592,6 +692,8 @@ return_type lora_aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK],
     return 0;
 }
 
+#endif
+
 /* CBC encrypt a number of blocks (input and return an IV) */
 
 return_type aes_cbc_encrypt( const uint8_t *in, uint8_t *out,
@@ -32,6 +32,7 @@ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
 DEALINGS WITH THE SOFTWARE
 
 *****************************************************************************/
+#include <stddef.h>
 #include <stdint.h>
 #include "aes.h"
 #include "cmac.h"
@@ -56,13 +57,44 @@ DEALINGS WITH THE SOFTWARE
         }                                   \
     } while( 0 )
 
+#define SUBKEY( v, r )                \
+    do                                \
+    {                                 \
+        if( ( v )[0] & 0x80 )         \
+        {                             \
+            LSHIFT( v, r );           \
+            ( r )[15] ^= 0x87;        \
+        }                             \
+        else                          \
+            LSHIFT( v, r );           \
+    } while( 0 )
+
 void AES_CMAC_Init( AES_CMAC_CTX* ctx )
 {
     memset1( ctx->X, 0, sizeof ctx->X );
     ctx->M_n = 0;
+    ctx->key = NULL;
     memset1( ctx->rijndael.ksch, '\0', 240 );
 }
 
+void AES_CMAC_ExpandKey( AES_CMAC_KEY* key, const uint8_t k[AES_CMAC_KEY_LENGTH] )
+{
+    aes_set_key( k, AES_CMAC_KEY_LENGTH, &key->rijndael );
+
+    /* generate subkeys K1 and K2 */
+    memset1( key->K1, '\0', 16 );
+    lora_aes_encrypt( key->K1, key->K1, &key->rijndael );
+    SUBKEY( key->K1, key->K1 );
+    SUBKEY( key->K1, key->K2 );
+}
+
+void AES_CMAC_InitExpanded( AES_CMAC_CTX* ctx, const AES_CMAC_KEY* key )
+{
+    memset1( ctx->X, 0, sizeof ctx->X );
+    ctx->M_n = 0;
+    ctx->key = key;
+}
+
 void AES_CMAC_SetKey( AES_CMAC_CTX* ctx, const uint8_t key[AES_CMAC_KEY_LENGTH] )
 {
     aes_set_key( key, AES_CMAC_KEY_LENGTH, &ctx->rijndael );
@@ -70,6 +102,7 @@ void AES_CMAC_SetKey( AES_CMAC_CTX* ctx, const uint8_t key[AES_CMAC_KEY_LENGTH]
 
 void AES_CMAC_Update( AES_CMAC_CTX* ctx, const uint8_t* data, uint32_t len )
 {
+    const aes_context* rijndael = ( ctx->key != NULL ) ? &ctx->key->rijndael : &ctx->rijndael;
     uint32_t mlen;
     uint8_t  in[16];
 
@@ -83,7 +116,7 @@ void AES_CMAC_Update( AES_CMAC_CTX* ctx, const uint8_t* data, uint32_t len )
         XOR( ctx->M_last, ctx->X );
 
         memcpy1( in, &ctx->X[0], 16 );  // Otherwise it does not look good
-        lora_aes_encrypt( in, in, &ctx->rijndael );
+        lora_aes_encrypt( in, in, rijndael );
         memcpy1( &ctx->X[0], in, 16 );
 
         data += mlen;
@@ -95,7 +128,7 @@ void AES_CMAC_Update( AES_CMAC_CTX* ctx, const uint8_t* data, uint32_t len )
         XOR( data, ctx->X );
 
         memcpy1( in, &ctx->X[0], 16 );  // Otherwise it does not look good
-        lora_aes_encrypt( in, in, &ctx->rijndael );
+        lora_aes_encrypt( in, in, rijndael );
         memcpy1( &ctx->X[0], in, 16 );
 
         data += 16;
@@ -108,47 +141,41 @@ void AES_CMAC_Update( AES_CMAC_CTX* ctx, const uint8_t* data, uint32_t len )
 
 void AES_CMAC_Final( uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX* ctx )
 {
+    const aes_context* rijndael = ( ctx->key != NULL ) ? &ctx->key->rijndael : &ctx->rijndael;
     uint8_t K[16];
     uint8_t in[16];
-    /* generate subkey K1 */
-    memset1( K, '\0', 16 );
-
-    lora_aes_encrypt( K, K, &ctx->rijndael );
-
-    if( K[0] & 0x80 )
-    {
-        LSHIFT( K, K );
-        K[15] ^= 0x87;
-    }
-    else
-        LSHIFT( K, K );
 
-    if( ctx->M_n == 16 )
+    if( ctx->key != NULL )
     {
-        /* last block was a complete block */
-        XOR( K, ctx->M_last );
+        /* subkeys computed by AES_CMAC_ExpandKey */
+        memcpy1( K, ( ctx->M_n == 16 ) ? ctx->key->K1 : ctx->key->K2, 16 );
     }
     else
     {
-        /* generate subkey K2 */
-        if( K[0] & 0x80 )
+        /* generate subkey K1 */
+        memset1( K, '\0', 16 );
+        lora_aes_encrypt( K, K, rijndael );
+        SUBKEY( K, K );
+
+        if( ctx->M_n != 16 )
         {
-            LSHIFT( K, K );
-            K[15] ^= 0x87;
+            /* generate subkey K2 */
+            SUBKEY( K, K );
         }
-        else
-            LSHIFT( K, K );
+    }
 
+    if( ctx->M_n != 16 )
+    {
         /* padding(M_last) */
         ctx->M_last[ctx->M_n] = 0x80;
         while( ++ctx->M_n < 16 )
             ctx->M_last[ctx->M_n] = 0;
-
-        XOR( K, ctx->M_last );
     }
+    /* last block XOR K1 if it was a complete block, K2 otherwise */
+    XOR( K, ctx->M_last );
     XOR( ctx->M_last, ctx->X );
 
     memcpy1( in, &ctx->X[0], 16 );  // Otherwise it does not look good
-    lora_aes_encrypt( in, digest, &ctx->rijndael );
+    lora_aes_encrypt( in, digest, rijndael );
     memset1( K, 0, sizeof K );
 }
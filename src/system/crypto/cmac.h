@@ -45,8 +45,16 @@ extern "C" {
 #define AES_CMAC_KEY_LENGTH     16
 #define AES_CMAC_DIGEST_LENGTH  16
  
+/* Key schedule and subkeys of a key, computed once by AES_CMAC_ExpandKey */
+typedef struct _AES_CMAC_KEY {
+            aes_context    rijndael;
+            uint8_t        K1[16];
+            uint8_t        K2[16];
+    } AES_CMAC_KEY;
+
 typedef struct _AES_CMAC_CTX {
             aes_context    rijndael;
+            const AES_CMAC_KEY *key;    /* NULL when keyed by AES_CMAC_SetKey */
             uint8_t        X[16];
             uint8_t        M_last[16];
             uint32_t       M_n;
@@ -61,6 +69,8 @@ void     AES_CMAC_Update(AES_CMAC_CTX * ctx, const uint8_t * data, uint32_t len)
           //          __attribute__((__bounded__(__string__,2,3)));
 void     AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX  * ctx);
             //     __attribute__((__bounded__(__minbytes__,1,AES_CMAC_DIGEST_LENGTH)));
+void     AES_CMAC_ExpandKey(AES_CMAC_KEY * key, const uint8_t k[AES_CMAC_KEY_LENGTH]);
+void     AES_CMAC_InitExpanded(AES_CMAC_CTX * ctx, const AES_CMAC_KEY * key);
 //__END_DECLS
 
 #ifdef __cplusplus
@@ -0,0 +1,251 @@
+/*!
+ * \file      soft-se-aes.c
+ *
+ * \brief     AES-128 backend of the soft secure element
+ */
+#include <stddef.h>
+#include <string.h>
+
+#include "system/utilities.h"
+#include "soft-se-aes.h"
+
+#if( SOFT_SE_AES_BACKEND == SOFT_SE_AES_SOFTWARE )
+
+bool SoftSeAesSetKey( SoftSeAesKey_t* key, const uint8_t* value )
+{
+    AES_CMAC_ExpandKey( &key->Cmac, value );
+    return true;
+}
+
+void SoftSeAesFreeKey( SoftSeAesKey_t* key )
+{
+    memset1( ( uint8_t* ) key, 0, sizeof( SoftSeAesKey_t ) );
+}
+
+void SoftSeAesEncrypt( SoftSeAesKey_t* key, const uint8_t* in, uint8_t* out )
+{
+    lora_aes_encrypt( in, out, &key->Cmac.rijndael );
+}
+
+void SoftSeAesCmac( SoftSeAesKey_t* key, const uint8_t* bx, const uint8_t* buffer, uint16_t size, uint8_t* cmac )
+{
+    AES_CMAC_CTX aesCmacCtx[1];
+
+    AES_CMAC_InitExpanded( aesCmacCtx, &key->Cmac );
+    if( bx != NULL )
+    {
+        AES_CMAC_Update( aesCmacCtx, bx, SOFT_SE_AES_BLOCK_SIZE );
+    }
+    AES_CMAC_Update( aesCmacCtx, buffer, size );
+    AES_CMAC_Final( cmac, aesCmacCtx );
+}
+
+const char* SoftSeAesGetBackendName( void )
+{
+    return "software";
+}
+
+#else
+
+void SoftSeAesEncrypt( SoftSeAesKey_t* key, const uint8_t* in, uint8_t* out )
+{
+#if( SOFT_SE_AES_BACKEND == SOFT_SE_AES_ESP32 )
+    esp_aes_crypt_ecb( &key->Context, ESP_AES_ENCRYPT, in, out );
+#else
+    mbedtls_aes_crypt_ecb( &key->Context, MBEDTLS_AES_ENCRYPT, in, out );
+#endif
+}
+
+/*!
+ * \brief Doubles a block in GF(2^128), RFC 4493 section 2.3
+ */
+static void SoftSeAesCmacSubkey( uint8_t* out, const uint8_t* in )
+{
+    uint8_t msb = in[0] & 0x80;
+
+    for( uint8_t i = 0; i < ( SOFT_SE_AES_BLOCK_SIZE - 1 ); i++ )
+    {
+        out[i] = ( uint8_t )( ( in[i] << 1 ) | ( in[i + 1] >> 7 ) );
+    }
+    out[SOFT_SE_AES_BLOCK_SIZE - 1] = ( uint8_t )( in[SOFT_SE_AES_BLOCK_SIZE - 1] << 1 );
+    if( msb != 0 )
+    {
+        out[SOFT_SE_AES_BLOCK_SIZE - 1] ^= 0x87;
+    }
+}
+
+void SoftSeAesFreeKey( SoftSeAesKey_t* key )
+{
+    if( key->Initialized == true )
+    {
+#if( SOFT_SE_AES_BACKEND == SOFT_SE_AES_ESP32 )
+        esp_aes_free( &key->Context );
+#else
+        mbedtls_aes_free( &key->Context );
+#endif
+    }
+    memset1( ( uint8_t* ) key, 0, sizeof( SoftSeAesKey_t ) );
+}
+
+bool SoftSeAesSetKey( SoftSeAesKey_t* key, const uint8_t* value )
+{
+    uint8_t l[SOFT_SE_AES_BLOCK_SIZE] = { 0 };
+    int status;
+
+    SoftSeAesFreeKey( key );
+#if( SOFT_SE_AES_BACKEND == SOFT_SE_AES_ESP32 )
+    esp_aes_init( &key->Context );
+    key->Initialized = true;
+    status = esp_aes_setkey( &key->Context, value, 128 );
+#else
+    mbedtls_aes_init( &key->Context );
+    key->Initialized = true;
+    status = mbedtls_aes_setkey_enc( &key->Context, value, 128 );
+#endif
+    if( status != 0 )
+    {
+        SoftSeAesFreeKey( key );
+        return false;
+    }
+    SoftSeAesEncrypt( key, l, l );
+    SoftSeAesCmacSubkey( key->K1, l );
+    SoftSeAesCmacSubkey( key->K2, key->K1 );
+    memset1( l, 0, sizeof( l ) );
+    return true;
+}
+
+void SoftSeAesCmac( SoftSeAesKey_t* key, const uint8_t* bx, const uint8_t* buffer, uint16_t size, uint8_t* cmac )
+{
+    uint8_t x[SOFT_SE_AES_BLOCK_SIZE] = { 0 };
+    const uint8_t* subkey = key->K1;
+
+    // A Bx block alone is the last block of the message
+    if( bx != NULL )
+    {
+        if( size == 0 )
+        {
+            buffer = bx;
+            size = SOFT_SE_AES_BLOCK_SIZE;
+        }
+        else
+        {
+            memcpy1( x, bx, SOFT_SE_AES_BLOCK_SIZE );
+            SoftSeAesEncrypt( key, x, x );
+        }
+    }
+
+    while( size > SOFT_SE_AES_BLOCK_SIZE )
+    {
+        for( uint8_t i = 0; i < SOFT_SE_AES_BLOCK_SIZE; i++ )
+        {
+            x[i] ^= buffer[i];
+        }
+        SoftSeAesEncrypt( key, x, x );
+        buffer += SOFT_SE_AES_BLOCK_SIZE;
+        size -= SOFT_SE_AES_BLOCK_SIZE;
+    }
+
+    // Last block XOR K1 if it is complete, padded and XOR K2 otherwise
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        x[i] ^= buffer[i];
+    }
+    if( size != SOFT_SE_AES_BLOCK_SIZE )
+    {
+        x[size] ^= 0x80;
+        subkey = key->K2;
+    }
+    for( uint8_t i = 0; i < SOFT_SE_AES_BLOCK_SIZE; i++ )
+    {
+        x[i] ^= subkey[i];
+    }
+    SoftSeAesEncrypt( key, x, cmac );
+}
+
+const char* SoftSeAesGetBackendName( void )
+{
+#if( SOFT_SE_AES_BACKEND == SOFT_SE_AES_ESP32 )
+    return "esp32";
+#else
+    return "mbedtls";
+#endif
+}
+
+#endif
+
+/*!
+ * RFC 4493 section 4 example: key, message and the CMAC of its first 0, 16,
+ * 40 and 64 bytes
+ */
+static const uint8_t SelfTestCmacKey[16] =
+{
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+static const uint8_t SelfTestCmacMessage[64] =
+{
+    0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+    0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+    0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+    0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10
+};
+
+static const uint8_t SelfTestCmacSizes[4] = { 0, 16, 40, 64 };
+
+static const uint8_t SelfTestCmac[4][16] =
+{
+    { 0xBB, 0x1D, 0x69, 0x29, 0xE9, 0x59, 0x37, 0x28, 0x7F, 0xA3, 0x7D, 0x12, 0x9B, 0x75, 0x67, 0x46 },
+    { 0x07, 0x0A, 0x16, 0xB4, 0x6B, 0x4D, 0x41, 0x44, 0xF7, 0x9B, 0xDD, 0x9D, 0xD0, 0x4A, 0x28, 0x7C },
+    { 0xDF, 0xA6, 0x67, 0x47, 0xDE, 0x9A, 0xE6, 0x30, 0x30, 0xCA, 0x32, 0x61, 0x14, 0x97, 0xC8, 0x27 },
+    { 0x51, 0xF0, 0xBE, 0xBF, 0x7E, 0x3B, 0x9D, 0x92, 0xFC, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3C, 0xFE }
+};
+
+bool SoftSeAesSelfTest( void )
+{
+    // FIPS-197 appendix C.1
+    static const uint8_t key[16] =
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+    };
+    static const uint8_t plain[16] =
+    {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+    };
+    static const uint8_t cipher[16] =
+    {
+        0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A
+    };
+    static SoftSeAesKey_t aesKey;
+    uint8_t out[16];
+    bool ok;
+
+    if( SoftSeAesSetKey( &aesKey, key ) == false )
+    {
+        return false;
+    }
+    SoftSeAesEncrypt( &aesKey, plain, out );
+    ok = ( memcmp( out, cipher, sizeof( out ) ) == 0 );
+
+    if( SoftSeAesSetKey( &aesKey, SelfTestCmacKey ) == false )
+    {
+        SoftSeAesFreeKey( &aesKey );
+        return false;
+    }
+    for( uint8_t i = 0; i < sizeof( SelfTestCmacSizes ); i++ )
+    {
+        uint8_t size = SelfTestCmacSizes[i];
+
+        SoftSeAesCmac( &aesKey, NULL, SelfTestCmacMessage, size, out );
+        ok = ok && ( memcmp( out, SelfTestCmac[i], sizeof( out ) ) == 0 );
+
+        // Same message with its first block passed as the Bx block
+        if( size >= SOFT_SE_AES_BLOCK_SIZE )
+        {
+            SoftSeAesCmac( &aesKey, SelfTestCmacMessage, SelfTestCmacMessage + SOFT_SE_AES_BLOCK_SIZE,
+                           size - SOFT_SE_AES_BLOCK_SIZE, out );
+            ok = ok && ( memcmp( out, SelfTestCmac[i], sizeof( out ) ) == 0 );
+        }
+    }
+    SoftSeAesFreeKey( &aesKey );
+    return ok;
+}
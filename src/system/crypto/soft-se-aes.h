@@ -0,0 +1,141 @@
+/*!
+ * \file      soft-se-aes.h
+ *
+ * \brief     AES-128 backend of the soft secure element
+ *
+ * \remark    The secure element and the payload encryption only need a key
+ *            setup, one block encryption and an AES-CMAC. SOFT_SE_AES_BACKEND
+ *            selects at build time which implementation provides them:
+ *
+ *            - SOFT_SE_AES_SOFTWARE : aes.c and cmac.c, portable, the default
+ *            - SOFT_SE_AES_ESP32    : AES peripheral of the ESP32 (esp_aes)
+ *            - SOFT_SE_AES_MBEDTLS  : mbedtls_aes, also builds on a Linux host
+ *                                     against libmbedcrypto
+ *
+ *            All of them pass the vectors of \ref SoftSeAesSelfTest.
+ *
+ *            The software backend is the default on every target. The ESP32
+ *            backend locks the shared AES peripheral for every block, select
+ *            it after timing both with the CryptoBenchmark example.
+ */
+#ifndef __SOFT_SE_AES_H__
+#define __SOFT_SE_AES_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SOFT_SE_AES_SOFTWARE                        0
+#define SOFT_SE_AES_ESP32                           1
+#define SOFT_SE_AES_MBEDTLS                         2
+
+#ifndef SOFT_SE_AES_BACKEND
+#define SOFT_SE_AES_BACKEND                         SOFT_SE_AES_SOFTWARE
+#endif
+
+#if( SOFT_SE_AES_BACKEND == SOFT_SE_AES_SOFTWARE )
+#include "cmac.h"
+#elif( SOFT_SE_AES_BACKEND == SOFT_SE_AES_ESP32 )
+#if defined( __has_include ) && __has_include( "aes/esp_aes.h" )
+#include "aes/esp_aes.h"
+#else
+#include "hwcrypto/aes.h"
+#endif
+#elif( SOFT_SE_AES_BACKEND == SOFT_SE_AES_MBEDTLS )
+#include "mbedtls/aes.h"
+#else
+#error "Unknown SOFT_SE_AES_BACKEND"
+#endif
+
+#define SOFT_SE_AES_BLOCK_SIZE                      16
+
+/*!
+ * AES-128 key prepared by \ref SoftSeAesSetKey: key schedule of the backend
+ * and CMAC subkeys. A key must be zeroed, static storage is, before it is
+ * prepared for the first time.
+ */
+typedef struct sSoftSeAesKey
+{
+#if( SOFT_SE_AES_BACKEND == SOFT_SE_AES_SOFTWARE )
+    AES_CMAC_KEY Cmac;
+#else
+#if( SOFT_SE_AES_BACKEND == SOFT_SE_AES_ESP32 )
+    esp_aes_context Context;
+#else
+    mbedtls_aes_context Context;
+#endif
+    /*!
+     * Context initialized by the backend, freed before the next key setup
+     */
+    bool Initialized;
+    /*!
+     * CMAC subkeys, RFC 4493 section 2.3
+     */
+    uint8_t K1[SOFT_SE_AES_BLOCK_SIZE];
+    uint8_t K2[SOFT_SE_AES_BLOCK_SIZE];
+#endif
+}SoftSeAesKey_t;
+
+/*!
+ * \brief Prepares a key for encryption and CMAC, releasing what a previous
+ *        setup of the same key holds
+ *
+ * \remark The prepared key holds pointers into itself with some backends, it
+ *         must not be copied
+ *
+ * \param [OUT] key   Key to prepare
+ * \param [IN]  value 16 bytes AES-128 key
+ *
+ * \retval true when the backend accepted the key
+ */
+bool SoftSeAesSetKey( SoftSeAesKey_t* key, const uint8_t* value );
+
+/*!
+ * \brief Releases a prepared key and wipes it
+ *
+ * \param [IN] key Key to release
+ */
+void SoftSeAesFreeKey( SoftSeAesKey_t* key );
+
+/*!
+ * \brief Encrypts one block
+ *
+ * \param [IN]  key Prepared key
+ * \param [IN]  in  16 bytes plain block
+ * \param [OUT] out 16 bytes encrypted block, may be the same buffer as in
+ */
+void SoftSeAesEncrypt( SoftSeAesKey_t* key, const uint8_t* in, uint8_t* out );
+
+/*!
+ * \brief Computes the AES-CMAC of a message, optionally preceded by a block
+ *
+ * \param [IN]  key    Prepared key
+ * \param [IN]  bx     16 bytes block processed before the buffer, NULL for none
+ * \param [IN]  buffer Message
+ * \param [IN]  size   Message size
+ * \param [OUT] cmac   16 bytes CMAC
+ */
+void SoftSeAesCmac( SoftSeAesKey_t* key, const uint8_t* bx, const uint8_t* buffer, uint16_t size, uint8_t* cmac );
+
+/*!
+ * \brief Gets the name of the backend selected at build time
+ *
+ * \retval name "software", "esp32" or "mbedtls"
+ */
+const char* SoftSeAesGetBackendName( void );
+
+/*!
+ * \brief Checks the backend against the FIPS-197 and RFC 4493 vectors
+ *
+ * \retval ok true when every vector matches
+ */
+bool SoftSeAesSelfTest( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SOFT_SE_AES_H__
@@ -25,25 +25,78 @@
  */
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "system/utilities.h"
-#include "aes.h"
-#include "cmac.h"
+#include "soft-se-aes.h"
 
 #include "mac/LoRaMacHeaderTypes.h"
 
 #include "mac/secure-element.h"
 #include "mac/secure-element-nvm.h"
+#include "mac/LoRaMac.h"
 #include "se-identity.h"
 #include "soft-se-hal.h"
 #include <Arduino.h>
 
 RTC_DATA_ATTR static SecureElementNvmData_t* SeNvm;
 
+/*
+ * Key schedule and CMAC subkeys of a key of the key list
+ */
+typedef struct sSoftSeKeyCache
+{
+    /*
+     * Key the schedule was expanded from
+     */
+    uint8_t KeyValue[SE_KEY_SIZE];
+    /*
+     * Set once Expanded holds the schedule of KeyValue
+     */
+    bool IsValid;
+    SoftSeAesKey_t Expanded;
+}SoftSeKeyCache_t;
+
+/*
+ * Expanded keys, same index as SeNvm->KeyList. Not kept over deep sleep, the
+ * schedules are expanded again on first use.
+ */
+static SoftSeKeyCache_t KeyCache[NUM_OF_KEYS];
+
 /*
  * Local functions
  */
 
+/*
+ * Gets the position of a key in the key list, which follows the order of
+ * KeyIdentifier_t with the multicast keys packed after MC_ROOT_KEY.
+ *
+ * \param[IN]  keyID          - Key identifier
+ * \param[OUT] index          - Key list index
+ * \retval                    - Status of the operation
+ */
+static SecureElementStatus_t GetKeyIndex( KeyIdentifier_t keyID, uint8_t* index )
+{
+    if( keyID <= MC_ROOT_KEY )
+    {
+        *index = ( uint8_t )keyID;
+    }
+    else if( ( keyID >= MC_KE_KEY ) && ( keyID <= SLOT_RAND_ZERO_KEY ) )
+    {
+        *index = ( uint8_t )( keyID - MC_KE_KEY + MC_ROOT_KEY + 1 );
+    }
+    else
+    {
+        return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+    }
+
+    if( ( *index >= NUM_OF_KEYS ) || ( SeNvm->KeyList[*index].KeyID != keyID ) )
+    {
+        return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+    }
+    return SECURE_ELEMENT_SUCCESS;
+}
+
 /*
  * Gets key item from key list.
  *
@@ -53,15 +106,66 @@ RTC_DATA_ATTR static SecureElementNvmData_t* SeNvm;
  */
 static SecureElementStatus_t GetKeyByID( KeyIdentifier_t keyID, Key_t** keyItem )
 {
-    for( uint8_t i = 0; i < NUM_OF_KEYS; i++ )
+    uint8_t index;
+    SecureElementStatus_t retval = GetKeyIndex( keyID, &index );
+
+    if( retval == SECURE_ELEMENT_SUCCESS )
     {
-        if( SeNvm->KeyList[i].KeyID == keyID )
+        *keyItem = &( SeNvm->KeyList[index] );
+    }
+    return retval;
+}
+
+/*
+ * Gets the key schedule and CMAC subkeys of a key, expanding them on first use.
+ *
+ * \remark The key value is compared as well, the key list may be overwritten
+ *         by a context restore without going through SecureElementSetKey.
+ *
+ * \param[IN]  keyID          - Key identifier
+ * \param[OUT] expanded       - Expanded key reference
+ * \retval                    - Status of the operation
+ */
+static SecureElementStatus_t GetExpandedKey( KeyIdentifier_t keyID, SoftSeAesKey_t** expanded )
+{
+    uint8_t index;
+    SecureElementStatus_t retval = GetKeyIndex( keyID, &index );
+
+    if( retval != SECURE_ELEMENT_SUCCESS )
+    {
+        return retval;
+    }
+
+    SoftSeKeyCache_t* cache = &KeyCache[index];
+    uint8_t* keyValue = SeNvm->KeyList[index].KeyValue;
+
+    if( ( cache->IsValid == false ) || ( memcmp( cache->KeyValue, keyValue, SE_KEY_SIZE ) != 0 ) )
+    {
+        cache->IsValid = false;
+        if( SoftSeAesSetKey( &cache->Expanded, keyValue ) == false )
         {
-            *keyItem = &( SeNvm->KeyList[i] );
-            return SECURE_ELEMENT_SUCCESS;
+            return SECURE_ELEMENT_ERROR;
         }
+        memcpy1( cache->KeyValue, keyValue, SE_KEY_SIZE );
+        cache->IsValid = true;
+    }
+    *expanded = &cache->Expanded;
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+/*
+ * Drops the expanded schedule of a key
+ *
+ * \param[IN]  keyID          - Key identifier
+ */
+static void InvalidateExpandedKey( KeyIdentifier_t keyID )
+{
+    uint8_t index;
+
+    if( GetKeyIndex( keyID, &index ) == SECURE_ELEMENT_SUCCESS )
+    {
+        KeyCache[index].IsValid = false;
     }
-    return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
 }
 
 /*
@@ -85,33 +189,13 @@ static SecureElementStatus_t ComputeCmac( uint8_t* micBxBuffer, uint8_t* buffer,
     }
 
     uint8_t Cmac[16];
-    AES_CMAC_CTX aesCmacCtx[1];
-
-    AES_CMAC_Init( aesCmacCtx );
-
-    Key_t*                keyItem;
-    SecureElementStatus_t retval = GetKeyByID( keyID, &keyItem );
 
-    // uint8_t * temp_Key = keyItem->KeyValue;
-    // printf("keyItem->KeyValue = ");
-    // for(uint8_t i = 0; i < 16; i++)
-    // {   
-    //     printf("%02X", temp_Key[i]);
-    // }
-    // printf("\n");
+    SoftSeAesKey_t*       expanded;
+    SecureElementStatus_t retval = GetExpandedKey( keyID, &expanded );
 
     if( retval == SECURE_ELEMENT_SUCCESS )
     {
-        AES_CMAC_SetKey( aesCmacCtx, keyItem->KeyValue );
-
-        if( micBxBuffer != NULL )
-        {
-            AES_CMAC_Update( aesCmacCtx, micBxBuffer, 16 );
-        }
-
-        AES_CMAC_Update( aesCmacCtx, buffer, size );
-
-        AES_CMAC_Final( Cmac, aesCmacCtx );
+        SoftSeAesCmac( expanded, micBxBuffer, buffer, size, Cmac );
 
         // Bring into the required format
         *cmac = ( uint32_t )( ( uint32_t ) Cmac[3] << 24 | ( uint32_t ) Cmac[2] << 16 | ( uint32_t ) Cmac[1] << 8 |
@@ -161,6 +245,8 @@ SecureElementStatus_t SecureElementInit( SecureElementNvmData_t* nvm )
 
     // Initialize data
     memcpy1( ( uint8_t* )SeNvm, ( uint8_t* )&seNvmInit, sizeof( seNvmInit ) );
+    memset1( ( uint8_t* )KeyCache, 0, sizeof( KeyCache ) );
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT );
 
 #if !defined( SECURE_ELEMENT_PRE_PROVISIONED )
 #if( STATIC_DEVICE_EUI == 0 )
@@ -178,29 +264,29 @@ SecureElementStatus_t SecureElementSetKey( KeyIdentifier_t keyID, uint8_t* key )
         return SECURE_ELEMENT_ERROR_NPE;
     }
 
-    for( uint8_t i = 0; i < NUM_OF_KEYS; i++ )
+    Key_t*                keyItem;
+    SecureElementStatus_t retval = GetKeyByID( keyID, &keyItem );
+
+    if( retval != SECURE_ELEMENT_SUCCESS )
     {
-        if( SeNvm->KeyList[i].KeyID == keyID )
-        {
-            if( ( keyID == MC_KEY_0 ) || ( keyID == MC_KEY_1 ) || ( keyID == MC_KEY_2 ) || ( keyID == MC_KEY_3 ) )
-            {  // Decrypt the key if its a Mckey
-                SecureElementStatus_t retval           = SECURE_ELEMENT_ERROR;
-                uint8_t               decryptedKey[16] = { 0 };
-
-                retval = SecureElementAesEncrypt( key, 16, MC_KE_KEY, decryptedKey );
-
-                memcpy1( SeNvm->KeyList[i].KeyValue, decryptedKey, SE_KEY_SIZE );
-                return retval;
-            }
-            else
-            {
-                memcpy1( SeNvm->KeyList[i].KeyValue, key, SE_KEY_SIZE );
-                return SECURE_ELEMENT_SUCCESS;
-            }
-        }
+        return retval;
     }
+    InvalidateExpandedKey( keyID );
+
+    if( ( keyID == MC_KEY_0 ) || ( keyID == MC_KEY_1 ) || ( keyID == MC_KEY_2 ) || ( keyID == MC_KEY_3 ) )
+    {  // Decrypt the key if its a Mckey
+        uint8_t decryptedKey[16] = { 0 };
+
+        retval = SecureElementAesEncrypt( key, 16, MC_KE_KEY, decryptedKey );
 
-    return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+        memcpy1( keyItem->KeyValue, decryptedKey, SE_KEY_SIZE );
+    }
+    else
+    {
+        memcpy1( keyItem->KeyValue, key, SE_KEY_SIZE );
+    }
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT );
+    return retval;
 }
 
 SecureElementStatus_t SecureElementComputeAesCmac( uint8_t* micBxBuffer, uint8_t* buffer, uint16_t size,
@@ -257,21 +343,16 @@ SecureElementStatus_t SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, K
         return SECURE_ELEMENT_ERROR_BUF_SIZE;
     }
 // printf("-----------SecureElementAesEncrypt 1  step------------\n");
-    aes_context aesContext;
-    memset1( aesContext.ksch, '\0', 240 );
-
-    Key_t*                pItem;
-    SecureElementStatus_t retval = GetKeyByID( keyID, &pItem );
+    SoftSeAesKey_t*       expanded;
+    SecureElementStatus_t retval = GetExpandedKey( keyID, &expanded );
 
     if( retval == SECURE_ELEMENT_SUCCESS )
     {
-        aes_set_key( pItem->KeyValue, 16, &aesContext );
-
         uint8_t block = 0;
 
         while( size != 0 )
         {
-            lora_aes_encrypt( &buffer[block], &encBuffer[block], &aesContext );
+            SoftSeAesEncrypt( expanded, &buffer[block], &encBuffer[block] );
             block = block + 16;
             size  = size - 16;
         }
@@ -445,6 +526,7 @@ SecureElementStatus_t SecureElementSetDevEui( uint8_t* devEui )
 
 
     memcpy1( SeNvm->DevEui, devEui, SE_EUI_SIZE );
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT );
     // printf("---------------- ------------------\n");
     return SECURE_ELEMENT_SUCCESS;
 }
@@ -461,6 +543,7 @@ SecureElementStatus_t SecureElementSetJoinEui( uint8_t* joinEui )
         return SECURE_ELEMENT_ERROR_NPE;
     }
     memcpy1( SeNvm->JoinEui, joinEui, SE_EUI_SIZE );
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT );
     return SECURE_ELEMENT_SUCCESS;
 }
 
@@ -477,6 +560,7 @@ SecureElementStatus_t SecureElementSetPin( uint8_t* pin )
     }
 
     memcpy1( SeNvm->Pin, pin, SE_PIN_SIZE );
+    LoRaMacNvmSetDirty( LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT );
     return SECURE_ELEMENT_SUCCESS;
 }
 